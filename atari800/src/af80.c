@@ -89,6 +89,7 @@ static void update_d6(void)
 	else if (not_enable_crtc_registers) {
 		memset(MEMORY_mem + 0xd600, 0xff, 0x100);
 	}
+	MEMORY_DirtyRange(0xd600, 0x100);
 }
 
 static void update_d5(void)
@@ -99,6 +100,7 @@ static void update_d5(void)
 	else {
 		memcpy(MEMORY_mem + 0xd500, af80_rom + (rom_bank_select<<8), 0x100);
 	}
+	MEMORY_DirtyRange(0xd500, 0x100);
 }
 
 static void update_8000_9fff(void)
@@ -113,6 +115,8 @@ static void update_8000_9fff(void)
 		memcpy(MEMORY_mem + 0x8000 + (i<<8), af80_rom + (rom_bank_select<<8), 0x100);
 		}
 	}
+	CPU_PredecodeInvalidate(0x8000, 0x2000);
+	MEMORY_DirtyRange(0x8000, 0x2000);
 }
 
 int AF80_Initialise(int *argc, char *argv[])
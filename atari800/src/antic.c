@@ -1004,7 +1004,6 @@ int ANTIC_Initialise(int *argc, char *argv[])
 	mode_e_an_lookup[2] = mode_e_an_lookup[8] = mode_e_an_lookup[0x20] = mode_e_an_lookup[0x80] = 1;
 	mode_e_an_lookup[3] = mode_e_an_lookup[12] = mode_e_an_lookup[0x30] = mode_e_an_lookup[0xc0] = 2;
 #ifdef NEW_CYCLE_EXACT
-	CYCLE_MAP_Create();
 	ANTIC_cpu2antic_ptr = &CYCLE_MAP_cpu2antic[0];
 	ANTIC_antic2cpu_ptr = &CYCLE_MAP_antic2cpu[0];
 #endif /* NEW_CYCLE_EXACT */
@@ -2861,6 +2860,7 @@ void ANTIC_Frame(int draw_display)
 	UBYTE no_jvb = TRUE;
 #ifndef NEW_CYCLE_EXACT
 	UBYTE need_load;
+	int skip_pixels;
 #endif
 
 #ifdef NEW_CYCLE_EXACT
@@ -3106,8 +3106,12 @@ void ANTIC_Frame(int draw_display)
 
 		ANTIC_xpos += ANTIC_DMAR;
 
+		/* Without players or missiles nothing on the line can collide. */
+		skip_pixels = draw_display == ANTIC_FRAME_NO_PIXELS && !GTIA_pm_dirty;
+
 		if (anticmode < 2 || (ANTIC_DMACTL & 3) == 0) {
-			draw_antic_0_ptr();
+			if (!skip_pixels)
+				draw_antic_0_ptr();
 			GOEOL;
 			YPOS_BREAK_FLICKER;
 			scrn_ptr += Screen_WIDTH / 2;
@@ -3134,10 +3138,16 @@ void ANTIC_Frame(int draw_display)
 				ANTIC_xpos -= extra_cycles[md];
 		}
 
-		draw_antic_ptr(chars_displayed[md],
-			antic_memory + ANTIC_margin + ch_offset[md],
-			scrn_ptr + x_min[md],
-			(ULONG *) &GTIA_pm_scanline[x_min[md]]);
+		if (skip_pixels) {
+			/* the font cycles that the drawing routine would add */
+			if (anticmode < 8 && draw_antic_ptr != draw_antic_2_gtia_bug)
+				ANTIC_xpos += font_cycles[md];
+		}
+		else
+			draw_antic_ptr(chars_displayed[md],
+				antic_memory + ANTIC_margin + ch_offset[md],
+				scrn_ptr + x_min[md],
+				(ULONG *) &GTIA_pm_scanline[x_min[md]]);
 
 		GOEOL;
 #endif /* NEW_CYCLE_EXACT */
@@ -3149,7 +3159,7 @@ void ANTIC_Frame(int draw_display)
 
 #ifndef NO_SIMPLE_PAL_BLENDING
 	/* Simple PAL blending, using only the base 256 color palette. */
-	if (ANTIC_pal_blending)
+	if (ANTIC_pal_blending && draw_display != ANTIC_FRAME_NO_PIXELS)
 	{
 		int ypos = ANTIC_ypos - 1;
 		/* Start at the last screen line (248). */
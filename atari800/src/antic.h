@@ -73,6 +73,11 @@ extern UBYTE ANTIC_PENV_input;
 
 int ANTIC_Initialise(int *argc, char *argv[]);
 void ANTIC_Reset(void);
+/* DRAW_DISPLAY is TRUE to draw the frame into Screen_atari, or FALSE to
+   skip drawing with approximate timing. ANTIC_FRAME_NO_PIXELS keeps the
+   timing and the collisions of a drawn frame but only draws the scanlines
+   with players or missiles (all of them with NEW_CYCLE_EXACT). */
+#define ANTIC_FRAME_NO_PIXELS 2
 void ANTIC_Frame(int draw_display);
 UBYTE ANTIC_GetByte(UWORD addr, int no_side_effects);
 void ANTIC_PutByte(UWORD addr, UBYTE byte);
@@ -65,13 +65,23 @@
 #include "cassette.h"
 #include "cfg.h"
 #include "cpu.h"
+#ifdef CPU_JIT
+#include "cpu_jit.h"
+#endif
 #include "devices.h"
 #include "esc.h"
 #include "gtia.h"
 #include "input.h"
+#include "iostats.h"
 #include "log.h"
 #include "memory.h"
 #include "monitor.h"
+#ifdef MONITOR_PROFILE
+#include "cpuprof.h"
+#endif
+#ifdef MONITOR_TRACE
+#include "cputrace.h"
+#endif
 #ifdef IDE
 #  include "ide.h"
 #endif
@@ -91,6 +101,7 @@
 #include "screen.h"
 #endif
 #ifndef BASIC
+#include "rewind.h"
 #include "statesav.h"
 #ifndef __PLUS
 #include "ui.h"
@@ -188,6 +199,7 @@ int Atari800_nframes = 0;
 int Atari800_refresh_rate = 1;
 int Atari800_collisions_in_skipped_frames = FALSE;
 int Atari800_turbo = FALSE;
+int Atari800_audio_only = FALSE;
 int Atari800_start_in_monitor = FALSE;
 int Atari800_auto_frameskip = FALSE;
 
@@ -381,6 +393,7 @@ int Atari800_InitialiseMachine(void)
 	Atari800_UpdateKeyboardDetached();
 	Atari800_UpdateJumper();
 	MEMORY_InitialiseMachine();
+	CARTRIDGE_UpdateD5Map();
 	Devices_UpdatePatches();
 	return have_roms;
 }
@@ -781,6 +794,17 @@ int Atari800_Initialise(int *argc, char *argv[])
 #endif
 		|| !Devices_Initialise(argc, argv)
 		|| !RTIME_Initialise(argc, argv)
+		|| !CPU_Initialise(argc, argv)
+		|| !IOSTATS_Initialise(argc, argv)
+#ifdef MONITOR_PROFILE
+		|| !CPUPROF_Initialise(argc, argv)
+#endif
+#ifdef MONITOR_TRACE
+		|| !CPUTRACE_Initialise(argc, argv)
+#endif
+#ifdef CPU_JIT
+		|| !CPU_JIT_Initialise(argc, argv)
+#endif
 #ifdef IDE
 		|| !IDE_Initialise(argc, argv)
 #endif
@@ -817,6 +841,8 @@ int Atari800_Initialise(int *argc, char *argv[])
 #endif
 #ifndef BASIC
 		|| !INPUT_Initialise(argc, argv)
+		|| !REWIND_Initialise(argc, argv)
+		|| !StateSav_Initialise(argc, argv)
 #endif
 #ifdef XEP80_EMULATION
 		|| !XEP80_Initialise(argc, argv)
@@ -977,6 +1003,8 @@ int Atari800_Initialise(int *argc, char *argv[])
 		if (Sound_Setup())
 			/* Start sound if opening audio output was successful. */
 				Sound_Continue();
+		else if (Atari800_audio_only)
+			return FALSE;
 	}
 #endif /* defined (SOUND) && defined(SOUND_THIN_API) */
 
@@ -1056,6 +1084,9 @@ int Atari800_Exit(int run_monitor)
 #ifdef SIDARI
 		SIDARI_Exit();
 #endif
+#if defined(SLIGHTSID) || defined(EVIE) || defined(SIDARI)
+		RESID_Exit();
+#endif
 #ifdef SONARI
 		SONARI_Exit();
 #endif
@@ -1067,6 +1098,7 @@ int Atari800_Exit(int run_monitor)
 #endif
 #ifndef BASIC
 		INPUT_Exit();	/* finish event recording */
+		REWIND_Exit();
 #endif
 		PBI_Exit();
 		CASSETTE_Exit(); /* Finish writing to the cassette file */
@@ -1078,6 +1110,13 @@ int Atari800_Exit(int run_monitor)
 #ifdef POKEYREC
 		POKEYREC_Exit();
 #endif
+#ifdef MONITOR_PROFILE
+		CPUPROF_Exit();
+#endif
+#ifdef MONITOR_TRACE
+		CPUTRACE_Exit();
+#endif
+		IOSTATS_Exit();
 		Devices_Exit();
 #ifdef R_IO_DEVICE
 		RDevice_Exit(); /* R: Device cleanup */
@@ -1150,6 +1189,9 @@ void Atari800_Sync(void)
 #endif
 	lasttime += deltatime;
 	curtime = Util_time();
+#if defined(SOUND) && !defined(__PLUS)
+	POKEYSND_GovernorFrame(deltatime, lasttime - curtime);
+#endif
 	if (Atari800_auto_frameskip)
 		autoframeskip(curtime, lasttime);
 	Util_sleep(lasttime - curtime);
@@ -1358,6 +1400,9 @@ void Atari800_Frame(void)
 		PBI_BB_Menu();
 #endif
 		break;
+	case AKEY_REWIND:
+		REWIND_Back();
+		break;
 	default:
 		break;
 	}
@@ -1378,6 +1423,13 @@ void Atari800_Frame(void)
 #ifdef BASIC
 	basic_frame();
 #else /* BASIC */
+#ifndef CURSES_BASIC
+	if (Atari800_audio_only) {
+		ANTIC_Frame(ANTIC_FRAME_NO_PIXELS);
+		Atari800_display_screen = FALSE;
+	}
+	else
+#endif
 	if (++refresh_counter >= Atari800_refresh_rate) {
 		refresh_counter = 0;
 #ifdef USE_CURSES
@@ -1410,6 +1462,14 @@ void Atari800_Frame(void)
 	POKEY_Frame();
 #ifdef SOUND
 	Sound_Update();
+#endif
+	CPU_IdleFrame();
+#ifdef MONITOR_TRACE
+	CPUTRACE_Frame();
+#endif
+	IOSTATS_Frame();
+#ifndef BASIC
+	REWIND_Frame();
 #endif
 	Atari800_nframes++;
 #ifdef BENCHMARK
@@ -1436,7 +1496,7 @@ void Atari800_Frame(void)
 			else
 				Atari800_display_screen = FALSE;
 		}
-		else
+		else if (!Atari800_audio_only)
 			Atari800_Sync();
 #endif /* BENCHMARK */
 }
@@ -1584,7 +1644,7 @@ void Atari800_SetTVMode(int mode)
 #ifdef SOUND
 #ifdef SOUND_THIN_API
 		if (Sound_enabled)
-			POKEYSND_Init(POKEYSND_FREQ_17_EXACT, Sound_out.freq, Sound_out.channels, Sound_out.sample_size == 2 ? POKEYSND_BIT16 : 0);
+			POKEYSND_Init(POKEYSND_FREQ_17_EXACT, Sound_out.freq, Sound_out.channels, Sound_out.sample_size >= 2 ? POKEYSND_BIT16 : 0);
 #elif defined(SUPPORTS_SOUND_REINIT)
 		Sound_Reinit();
 #endif /* defined(SUPPORTS_SOUND_REINIT) */
@@ -724,6 +724,9 @@ int PLATFORM_Keyboard(void)
 	case KEY_F0 + 10:
 		keycode = AKEY_SCREENSHOT;
 		break;
+	case KEY_F0 + 11:
+		keycode = AKEY_REWIND;
+		break;
 	case KEY_DOWN:
 		keycode = AKEY_DOWN;
 		break;
@@ -174,6 +174,24 @@ int BINLOAD_LoaderStart(UBYTE *buffer)
 	return 'C';
 }
 
+void BINLOAD_GetProgress(BINLOAD_Progress *progress)
+{
+	progress->instr_elapsed = instr_elapsed;
+	progress->from = from;
+	progress->to = to;
+	progress->init2e3 = init2e3;
+	progress->segfinished = segfinished;
+}
+
+void BINLOAD_SetProgress(const BINLOAD_Progress *progress)
+{
+	instr_elapsed = progress->instr_elapsed;
+	from = progress->from;
+	to = progress->to;
+	init2e3 = progress->init2e3;
+	segfinished = progress->segfinished;
+}
+
 /* Load BIN file, returns TRUE if ok */
 int BINLOAD_Loader(const char *filename)
 {
@@ -29,4 +29,17 @@ extern int BINLOAD_pause_loading;
 #define BINLOAD_LOADING_BASIC_RUN                8
 int BINLOAD_LoaderStart(UBYTE *buffer);
 
+/* Progress of the loader through BINLOAD_bin_file, which isn't in the
+   state save. */
+typedef struct {
+	unsigned int instr_elapsed;
+	UWORD from;
+	UWORD to;
+	int init2e3;
+	int segfinished;
+} BINLOAD_Progress;
+
+void BINLOAD_GetProgress(BINLOAD_Progress *progress);
+void BINLOAD_SetProgress(const BINLOAD_Progress *progress);
+
 #endif /* BINLOAD_H_ */
@@ -1071,119 +1071,226 @@ static void PutByte(CARTRIDGE_image_t *cart, UWORD addr, UBYTE byte)
 	}
 }
 
-/* a read from D500-D5FF area */
-UBYTE CARTRIDGE_GetByte(UWORD addr, int no_side_effects)
+/* Devices that respond in the D500-D5FF area. Which of them owns each
+   address is resolved by CARTRIDGE_UpdateD5Map, so an access is a single
+   table lookup. */
+typedef struct {
+	const char *name;
+	int (*get)(UWORD addr, int no_side_effects);
+	void (*put)(UWORD addr, UBYTE byte);
+} d5_device_t;
+
+static int CartGetByte(UWORD addr, int no_side_effects)
+{
+	/* In case 2 cartridges are inserted, reading a memory location would
+	   result in binary AND of both cartridges. */
+	return GetByte(&CARTRIDGE_main, addr, no_side_effects) & GetByte(&CARTRIDGE_piggyback, addr, no_side_effects);
+}
+
+static void CartPutByte(UWORD addr, UBYTE byte)
+{
+	PutByte(&CARTRIDGE_main, addr, byte);
+	PutByte(&CARTRIDGE_piggyback, addr, byte);
+}
+
+static int RtimeGetByte(UWORD addr, int no_side_effects)
 {
+	return RTIME_GetByte();
+}
+
+static void RtimePutByte(UWORD addr, UBYTE byte)
+{
+	RTIME_PutByte(byte);
+}
+
+#ifdef IDE
+static int IdeGetByte(UWORD addr, int no_side_effects)
+{
+	return IDE_GetByte(addr, no_side_effects);
+}
+
+static void IdePutByte(UWORD addr, UBYTE byte)
+{
+	IDE_PutByte(addr, byte);
+}
+#endif
+
+/* Listed in order of priority: a read is handled by the first device that
+   claims the address, a write goes to all of them. */
+enum {
 #ifdef SLIGHTSID
-	if ( ((SLIGHTSID_version == SLIGHTSID_MONO) && (addr <= 0xd57f))
-		|| ((SLIGHTSID_version == SLIGHTSID_STEREO) && (addr <= 0xd541)) ) {
-		return SLIGHTSID_D5GetByte(addr, no_side_effects);
-	}
+	D5_SLIGHTSID,
 #endif
 #ifdef SIDARI
-	if (SIDARI_InSlot(addr)) {
-		return SIDARI_D5GetByte(addr, no_side_effects);
-	}
+	D5_SIDARI,
 #endif
 #ifdef SONARI
-	if (SONARI_InSlot(addr)) {
-		return SONARI_D5GetByte(addr, no_side_effects);
-	}
+	D5_SONARI,
 #endif
 #ifdef MELODY_PSG
-	if (MELODY_PSG_InSlot(addr)) {
-		return MELODY_PSG_D5GetByte(addr, no_side_effects);
-	}
+	D5_MELODY_PSG,
 #endif
 #ifdef YAMARI
-	if (YAMARI_InSlot(addr)) {
-		return YAMARI_D5GetByte(addr, no_side_effects);
-	}
+	D5_YAMARI,
 #endif
 #ifdef EVIE
-	if ((EVIE_version != EVIE_NO) && ((addr & 0xffbf) <= 0xd51f)) {
-		return EVIE_D5GetByte(addr, no_side_effects);
-	}
+	D5_EVIE,
 #endif
 #ifdef AF80
-	if (AF80_enabled) {
-		return AF80_D5GetByte(addr, no_side_effects);
-	}
+	D5_AF80,
 #endif
 #ifdef BIT3
-	if (BIT3_enabled) {
-		return BIT3_D5GetByte(addr, no_side_effects);
-	}
+	D5_BIT3,
 #endif
-	if (RTIME_enabled && (addr == 0xd5b8 || addr == 0xd5b9))
-		return RTIME_GetByte();
+	D5_RTIME,
 #ifdef IDE
-	if (IDE_enabled && (addr <= 0xd50f))
-		return IDE_GetByte(addr, no_side_effects);
+	D5_IDE,
 #endif
-	/* In case 2 cartridges are inserted, reading a memory location would
-	   result in binary AND of both cartridges. */
-	return GetByte(&CARTRIDGE_main, addr, no_side_effects) & GetByte(&CARTRIDGE_piggyback, addr, no_side_effects);
-}
+	D5_CART,
+	D5_DEVICES
+};
 
-/* a write to D500-D5FF area */
-void CARTRIDGE_PutByte(UWORD addr, UBYTE byte)
+static d5_device_t const d5_devices[D5_DEVICES] = {
+#ifdef SLIGHTSID
+	{ "SlightSID", SLIGHTSID_D5GetByte, SLIGHTSID_D5PutByte },
+#endif
+#ifdef SIDARI
+	{ "SIDari", SIDARI_D5GetByte, SIDARI_D5PutByte },
+#endif
+#ifdef SONARI
+	{ "SONari", SONARI_D5GetByte, SONARI_D5PutByte },
+#endif
+#ifdef MELODY_PSG
+	{ "Melody PSG", MELODY_PSG_D5GetByte, MELODY_PSG_D5PutByte },
+#endif
+#ifdef YAMARI
+	{ "YAMari", YAMARI_D5GetByte, YAMARI_D5PutByte },
+#endif
+#ifdef EVIE
+	{ "Evie", EVIE_D5GetByte, EVIE_D5PutByte },
+#endif
+#ifdef AF80
+	{ "AF80", AF80_D5GetByte, AF80_D5PutByte },
+#endif
+#ifdef BIT3
+	{ "BIT3", BIT3_D5GetByte, BIT3_D5PutByte },
+#endif
+	{ "R-Time 8", RtimeGetByte, RtimePutByte },
+#ifdef IDE
+	{ "IDE", IdeGetByte, IdePutByte },
+#endif
+	{ "cartridge", CartGetByte, CartPutByte }
+};
+
+/* Device that answers a read of each D5xx address. */
+static d5_device_t const *d5_read_map[256];
+/* NULL-terminated list of devices that receive a write to each D5xx address. */
+static d5_device_t const *d5_write_map[256][D5_DEVICES + 1];
+
+/* Returns TRUE if device DEV claims reads (if WRITE is FALSE) or writes
+   (if WRITE is TRUE) of ADDR. */
+static int D5Claims(int dev, UWORD addr, int write)
 {
+	switch (dev) {
 #ifdef SLIGHTSID
-	if ( ((SLIGHTSID_version == SLIGHTSID_MONO) && (addr <= 0xd57f))
-		|| ((SLIGHTSID_version == SLIGHTSID_STEREO) && (addr <= 0xd541)) ) {
-		SLIGHTSID_D5PutByte(addr,byte);
-	}
+	case D5_SLIGHTSID:
+		return (SLIGHTSID_version == SLIGHTSID_MONO && addr <= 0xd57f)
+		       || (SLIGHTSID_version == SLIGHTSID_STEREO && addr <= 0xd541);
 #endif
 #ifdef SIDARI
-	if (SIDARI_InSlot(addr)) {
-		SIDARI_D5PutByte(addr,byte);
-	}
+	case D5_SIDARI:
+		return SIDARI_InSlot(addr);
 #endif
 #ifdef SONARI
-	if (SONARI_InSlot(addr)) {
-		SONARI_D5PutByte(addr,byte);
-	}
+	case D5_SONARI:
+		return SONARI_InSlot(addr);
 #endif
 #ifdef MELODY_PSG
-	if (MELODY_PSG_InSlot(addr)) {
-		MELODY_PSG_D5PutByte(addr,byte);
-	}
+	case D5_MELODY_PSG:
+		return MELODY_PSG_InSlot(addr);
 #endif
 #ifdef YAMARI
-	if (YAMARI_InSlot(addr)) {
-		YAMARI_D5PutByte(addr,byte);
-	}
+	case D5_YAMARI:
+		return YAMARI_InSlot(addr);
 #endif
 #ifdef EVIE
-	if ((EVIE_version != EVIE_NO) && ((addr & 0xffbf) <= 0xd51f)) {
-		EVIE_D5PutByte(addr,byte);
-	}
+	case D5_EVIE:
+		return EVIE_version != EVIE_NO && (addr & 0xffbf) <= 0xd51f;
 #endif
 #ifdef AF80
-	if (AF80_enabled) {
-		AF80_D5PutByte(addr,byte);
-		/* Return, because AF_80_enabled means there's an AF80
-		   cartridge in the left slot and no other cartridges are
-		   there. */
-		return;
-	}
+	case D5_AF80:
+		return AF80_enabled;
 #endif
 #ifdef BIT3
-	if (BIT3_enabled && (addr == 0xd508 || addr == 0xd580 || addr == 0xd581 || addr == 0xd583 || addr == 0xd585)) {
-		BIT3_D5PutByte(addr,byte);
-	}
+	case D5_BIT3:
+		return BIT3_enabled && (!write || addr == 0xd508 || addr == 0xd580
+		                        || addr == 0xd581 || addr == 0xd583 || addr == 0xd585);
 #endif
-	if (RTIME_enabled && (addr == 0xd5b8 || addr == 0xd5b9)) {
-		RTIME_PutByte(byte);
-	}
+	case D5_RTIME:
+		return RTIME_enabled && (addr == 0xd5b8 || addr == 0xd5b9);
 #ifdef IDE
-	if (IDE_enabled && (addr <= 0xd50f)) {
-		IDE_PutByte(addr,byte);
+	case D5_IDE:
+		return IDE_enabled && addr <= 0xd50f;
+#endif
+	default: /* D5_CART */
+		return TRUE;
 	}
+}
+
+void CARTRIDGE_UpdateD5Map(void)
+{
+	int i;
+	for (i = 0; i < 256; i++) {
+		UWORD addr = (UWORD) (0xd500 + i);
+		int dev;
+		int n = 0;
+		d5_read_map[i] = NULL;
+		for (dev = 0; dev < D5_DEVICES; dev++) {
+			if (d5_read_map[i] == NULL && D5Claims(dev, addr, FALSE))
+				d5_read_map[i] = &d5_devices[dev];
+			if (D5Claims(dev, addr, TRUE)) {
+				d5_write_map[i][n++] = &d5_devices[dev];
+#ifdef AF80
+				/* AF80_enabled means there's an AF80 cartridge in the
+				   left slot and no other cartridges are there. */
+				if (dev == D5_AF80)
+					break;
 #endif
-	PutByte(&CARTRIDGE_main, addr, byte);
-	PutByte(&CARTRIDGE_piggyback, addr, byte);
+			}
+		}
+		d5_write_map[i][n] = NULL;
+	}
+}
+
+void CARTRIDGE_PrintD5Map(FILE *fp)
+{
+	int start = 0;
+	int i;
+	for (i = 1; i <= 256; i++) {
+		int j;
+		if (i < 256 && d5_read_map[i] == d5_read_map[start]
+		    && memcmp(d5_write_map[i], d5_write_map[start], sizeof(d5_write_map[i])) == 0)
+			continue;
+		fprintf(fp, "%04X-%04X  read: %-10s write:", 0xd500 + start, 0xd500 + i - 1, d5_read_map[start]->name);
+		for (j = 0; d5_write_map[start][j] != NULL; j++)
+			fprintf(fp, "%s %s", j == 0 ? "" : ",", d5_write_map[start][j]->name);
+		fputc('\n', fp);
+		start = i;
+	}
+}
+
+/* a read from D500-D5FF area */
+UBYTE CARTRIDGE_GetByte(UWORD addr, int no_side_effects)
+{
+	return (UBYTE) d5_read_map[addr & 0xff]->get(addr, no_side_effects);
+}
+
+/* a write to D500-D5FF area */
+void CARTRIDGE_PutByte(UWORD addr, UBYTE byte)
+{
+	d5_device_t const *const *dev;
+	for (dev = d5_write_map[addr & 0xff]; *dev != NULL; dev++)
+		(*dev)->put(addr, byte);
 }
 
 /* special support of Bounty Bob on Atari5200 */
@@ -1784,6 +1891,8 @@ int CARTRIDGE_Initialise(int *argc, char *argv[])
 	}
 	*argc = j;
 
+	CARTRIDGE_UpdateD5Map();
+
 	if (help_only)
 		return TRUE;
 
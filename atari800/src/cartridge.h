@@ -205,6 +205,11 @@ void CARTRIDGE_ColdStart(void);
 
 UBYTE CARTRIDGE_GetByte(UWORD addr, int no_side_effects);
 void CARTRIDGE_PutByte(UWORD addr, UBYTE byte);
+/* Recomputes which device answers each D5xx address. Must be called
+   whenever a D5xx device is enabled, disabled or moved. */
+void CARTRIDGE_UpdateD5Map(void);
+/* Prints the owners of the D5xx addresses to FP. */
+void CARTRIDGE_PrintD5Map(FILE *fp);
 void CARTRIDGE_BountyBob1(UWORD addr);
 void CARTRIDGE_BountyBob2(UWORD addr);
 void CARTRIDGE_StateSave(void);
@@ -31,6 +31,12 @@
 /* Define to allow console sound (keyboard clicks). */
 #define CONSOLE_SOUND 1
 
+/* Define to compile 6502 code to x86-64 machine code. */
+/* #undef CPU_JIT */
+
+/* Define to cache predecoded 6502 instructions. */
+/* #undef CPU_PREDECODE */
+
 /* Define to activate crash menu after CIM instruction. */
 #define CRASH_MENU 1
 
@@ -615,6 +621,9 @@
 /* Emulate the XEP80. */
 #define XEP80_EMULATION 1
 
+/* Define to switch XE/RAMBO memory banks by pointer instead of copying. */
+/* #undef XE_BANK_PTR */
+
 /* Target: X11 with XView. */
 /* #undef XVIEW */
 
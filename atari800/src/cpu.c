@@ -36,6 +36,9 @@
 	Define NO_V_FLAG_VARIABLE to don't use local (static) variable V for the V flag.
 	Define PC_PTR to emulate 6502 Program Counter using UBYTE *.
 	Define PREFETCH_CODE to always fetch 2 bytes after the opcode.
+	Define CPU_PREDECODE to cache predecoded instructions (implies PREFETCH_CODE).
+	Define CPU_JIT to run basic blocks compiled to x86-64 code by cpu_jit.c
+	(implies CPU_PREDECODE).
 	Define WRAP_64K to correctly emulate instructions that wrap at 64K.
 	Define WRAP_ZPAGE to prevent incorrect access to the address 0x0100 in zeropage
 	indirect mode.
@@ -58,6 +61,7 @@
 #include "config.h"
 #include <stdio.h>
 #include <stdlib.h>	/* exit() */
+#include <string.h>
 
 #include "cpu.h"
 #ifdef ASAP /* external project, see http://asap.sf.net */
@@ -66,6 +70,8 @@
 #include "antic.h"
 #include "atari.h"
 #include "esc.h"
+#include "iostats.h"
+#include "log.h"
 #include "memory.h"
 #include "monitor.h"
 #ifndef BASIC
@@ -79,6 +85,18 @@
 #ifdef LIBATARI800
 #include "libatari800/main.h"
 #endif
+#ifdef CPU_PREDECODE
+#include "util.h"
+#endif
+#ifdef MONITOR_PROFILE
+#include "cpuprof.h"
+#endif
+#ifdef MONITOR_TRACE
+#include "cputrace.h"
+#endif
+#ifdef CPU_JIT
+#include "cpu_jit.h"
+#endif
 
 /* For Atari Basic loader */
 void (*CPU_rts_handler)(void) = NULL;
@@ -101,9 +119,81 @@ unsigned int CPU_remember_jmp_curpos = 0;
 #define INC_RET_NESTING
 #endif /* MONITOR_BREAK */
 
+#ifdef MONITOR_PROFILE
+#define PROFILE_CALL(site, target, s)  if (CPUPROF_enabled) CPUPROF_Call(site, target, s)
+#define PROFILE_RETURN(pc, s)          if (CPUPROF_enabled) CPUPROF_Return(pc, s)
+#define PROFILE_INTERRUPT(region, s)   if (CPUPROF_enabled) CPUPROF_Interrupt(region, GET_PC(), s)
+#else
+#define PROFILE_CALL(site, target, s)
+#define PROFILE_RETURN(pc, s)
+#define PROFILE_INTERRUPT(region, s)
+#endif /* MONITOR_PROFILE */
+
 UBYTE CPU_cim_encountered = FALSE;
 UBYTE CPU_IRQ;
 
+/* Idle loop skipping */
+int CPU_idle_skip = TRUE;
+int CPU_idle_frame_cycles = 0;
+
+static struct {
+	ULONG frame;			/* cycles skipped in the current frame */
+	ULONG frames;
+	ULONG idle_frames;		/* frames with skipped cycles */
+	ULONG max;
+	double total;
+} idle_stats;
+
+int CPU_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		if (strcmp(argv[i], "-idleskip") == 0)
+			CPU_idle_skip = TRUE;
+		else if (strcmp(argv[i], "-noidleskip") == 0)
+			CPU_idle_skip = FALSE;
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-idleskip        Skip passes through 6502 idle loops");
+				Log_print("\t-noidleskip      Run all passes through 6502 idle loops");
+			}
+			argv[j++] = argv[i];
+		}
+	}
+	*argc = j;
+
+	return TRUE;
+}
+
+void CPU_IdleFrame(void)
+{
+	CPU_idle_frame_cycles = (int) idle_stats.frame;
+	idle_stats.frames++;
+	if (idle_stats.frame > 0)
+		idle_stats.idle_frames++;
+	if (idle_stats.frame > idle_stats.max)
+		idle_stats.max = idle_stats.frame;
+	idle_stats.total += idle_stats.frame;
+	idle_stats.frame = 0;
+}
+
+void CPU_IdleStatsReset(void)
+{
+	memset(&idle_stats, 0, sizeof(idle_stats));
+}
+
+void CPU_IdleStatsPrint(FILE *fp)
+{
+	fprintf(fp, "Idle loop skipping %s: %.0f cycles skipped in %lu frames",
+	        CPU_idle_skip ? "on" : "off", idle_stats.total, (unsigned long) idle_stats.frames);
+	if (idle_stats.frames > 0)
+		fprintf(fp, ", %.0f per frame, at most %lu, in %lu frames",
+		        idle_stats.total / idle_stats.frames, (unsigned long) idle_stats.max,
+		        (unsigned long) idle_stats.idle_frames);
+	fprintf(fp, "\n");
+}
+
 #ifndef FALCON_CPUASM
 /* Windows headers define it */
 #undef ABSOLUTE
@@ -121,9 +211,22 @@ UBYTE CPU_IRQ;
 /* If PC_PTR is defined, local PC is "const UBYTE *", otherwise it's UWORD. */
 /* #define PC_PTR */
 
+#if defined(PC_PTR) && defined(XE_BANK_PTR)
+#error PC_PTR cannot work with pointer-based XE bank switching
+#endif
+
+#if defined(PC_PTR) && defined(CPU_PREDECODE)
+#error PC_PTR cannot work with the predecoded instruction cache
+#endif
+
 /* If PREFETCH_CODE is defined, 2 bytes after the opcode are always fetched. */
 /* #define PREFETCH_CODE */
 
+/* Predecoded instructions carry the 2 bytes after the opcode. */
+#if defined(CPU_PREDECODE) && !defined(PREFETCH_CODE)
+#define PREFETCH_CODE
+#endif
+
 
 /* 6502 stack handling */
 #define PL                  MEMORY_dGetByte(0x0100 + ++S)
@@ -302,6 +405,7 @@ void CPU_PutStatus(void)
 		if ((addr ^ GET_PC()) & 0xff00) \
 			ANTIC_xpos++; \
 		ANTIC_xpos++; \
+		IDLE_CHECK(addr, GET_PC() - 2); \
 		SET_PC(addr); \
 		DONE \
 	} \
@@ -323,6 +427,10 @@ void CPU_NMI(void)
 	PHPB0;
 	CPU_SetI;
 	CPU_regPC = MEMORY_dGetWordAligned(0xfffa);
+#ifdef MONITOR_PROFILE
+	if (CPUPROF_enabled)
+		CPUPROF_Interrupt((ANTIC_NMIST & 0x80) ? CPUPROF_DLI : CPUPROF_VBI, CPU_regPC, CPU_regS);
+#endif
 	CPU_regS = S;
 	ANTIC_xpos += 7; /* handling an interrupt by 6502 takes 7 cycles */
 	INC_RET_NESTING;
@@ -335,6 +443,7 @@ void CPU_NMI(void)
 		PHPB0; \
 		CPU_SetI; \
 		SET_PC(MEMORY_dGetWordAligned(0xfffe)); \
+		PROFILE_INTERRUPT(CPUPROF_IRQ, (UBYTE) (S + 3)); \
 		ANTIC_xpos += 7; \
 		INC_RET_NESTING; \
 	}
@@ -377,6 +486,510 @@ static const int cycles[256] =
 	2, 5, 2, 8, 4, 4, 6, 6, 2, 4, 2, 7, 4, 4, 7, 7		/* Fx */
 };
 
+/* TRUE if the monitor must see each instruction executed in the page of PC. */
+static int MonitorWatching(UWORD pc)
+{
+#ifdef MONITOR_BREAK
+	if (MONITOR_break_step || MONITOR_break_ret || (MONITOR_break_addr >> 8) == (pc >> 8))
+		return TRUE;
+#endif
+#ifdef MONITOR_BREAKPOINTS
+	if (MONITOR_breakpoint_table_size > 0 && MONITOR_breakpoints_enabled)
+		return TRUE;
+#endif
+#ifdef MONITOR_TRACE
+	if (MONITOR_trace_file != NULL || CPUTRACE_enabled)
+		return TRUE;
+#endif
+#ifdef MONITOR_PROFILE
+	if (CPUPROF_enabled)
+		return TRUE;
+#endif
+	return FALSE;
+}
+
+#ifdef CPU_PREDECODE
+/* Predecoded instruction cache.
+   Each 256-byte page of the address space gets, on first execution,
+   a table of predecoded instructions indexed by the low byte of the address.
+   An entry is valid while its gen equals gen of the page, so that dropping
+   a whole page is a single increment. Only instructions that fit in the page
+   and are not in hardware areas are cached; the rest is decoded into
+   a scratch entry on every execution. */
+typedef struct {
+#ifndef NO_GOTO
+	const void *handler;	/* opcode[code] */
+#endif
+	ULONG gen;
+	UWORD operand;			/* 2 bytes after the opcode */
+	UBYTE code;				/* the opcode */
+	UBYTE cycles;
+#ifdef CPU_JIT
+	UBYTE block_state;		/* JIT_UNTRIED, JIT_COMPILED or JIT_FAILED */
+	int block_max_start;	/* see CPU_JIT_Compile */
+	CPU_JIT_code_t block;	/* compiled code of the block starting here */
+#endif
+} predecode_entry_t;
+
+typedef struct {
+	ULONG gen;
+	predecode_entry_t entry[256];
+} predecode_page_t;
+
+typedef struct {
+	ULONG hits;
+	ULONG decodes;
+	ULONG invalidations;
+} predecode_stats_t;
+
+UBYTE CPU_predecode_cached[256];
+static predecode_page_t *predecode_pages[256];
+static predecode_entry_t predecode_scratch;
+static predecode_stats_t predecode_stats[256];
+
+#ifdef CPU_JIT
+#define JIT_UNTRIED  0
+#define JIT_COMPILED 1
+#define JIT_FAILED   2
+
+static struct {
+	ULONG compiled;
+	ULONG runs;
+	ULONG bails;
+} jit_stats;
+#endif
+
+#ifdef PAGED_ATTRIB
+#define PREDECODE_CACHEABLE(pc) (MEMORY_readmap[(pc) >> 8] == NULL \
+	&& (MEMORY_writemap[(pc) >> 8] == NULL || MEMORY_writemap[(pc) >> 8] == MEMORY_ROM_PutByte))
+#else
+#define PREDECODE_CACHEABLE(pc) (MEMORY_attrib[pc] != MEMORY_HARDWARE)
+#endif
+
+void CPU_PredecodeInvalidatePage(int page)
+{
+	if (CPU_predecode_cached[page]) {
+		predecode_pages[page]->gen++;
+		CPU_predecode_cached[page] = FALSE;
+		predecode_stats[page].invalidations++;
+	}
+}
+
+unsigned int CPU_PredecodeWrite(unsigned int addr)
+{
+	if (CPU_predecode_cached[(addr >> 8) & 0xff])
+		CPU_PredecodeInvalidatePage((addr >> 8) & 0xff);
+	return addr;
+}
+
+unsigned int CPU_PredecodeWriteWord(unsigned int addr)
+{
+	CPU_PredecodeWrite(addr + 1);
+	return CPU_PredecodeWrite(addr);
+}
+
+void CPU_PredecodeInvalidate(UWORD addr, int size)
+{
+	int page;
+	if (size <= 0)
+		return;
+	for (page = addr >> 8; page <= ((addr + size - 1) >> 8) && page < 256; page++)
+		CPU_PredecodeInvalidatePage(page);
+}
+
+void CPU_PredecodeFlush(void)
+{
+	int page;
+	for (page = 0; page < 256; page++)
+		CPU_PredecodeInvalidatePage(page);
+}
+
+/* Decodes the instruction at PC, storing it in the cache if possible.
+   The caller fills in the handler. */
+static predecode_entry_t *PredecodeFill(UWORD pc)
+{
+	int page = pc >> 8;
+	predecode_entry_t *e;
+	if ((pc & 0xff) > 0xfd || !PREDECODE_CACHEABLE(pc))
+		e = &predecode_scratch;
+	else {
+		if (predecode_pages[page] == NULL) {
+			predecode_pages[page] = (predecode_page_t *) Util_malloc(sizeof(predecode_page_t));
+			memset(predecode_pages[page], 0, sizeof(predecode_page_t));
+			predecode_pages[page]->gen = 1;
+		}
+		e = &predecode_pages[page]->entry[pc & 0xff];
+		e->gen = predecode_pages[page]->gen;
+		CPU_predecode_cached[page] = TRUE;
+		predecode_stats[page].decodes++;
+	}
+	e->code = MEMORY_dGetByte(pc);
+	e->operand = MEMORY_dGetWord((UWORD) (pc + 1));
+	e->cycles = (UBYTE) cycles[e->code];
+#ifdef CPU_JIT
+	e->block_state = JIT_UNTRIED;
+#endif
+	return e;
+}
+
+#ifdef CPU_JIT
+/* Compiled blocks don't stop for the monitor and don't do decimal mode. */
+static int JitAllowed(UWORD pc)
+{
+	return CPU_JIT_enabled && !(CPU_regP & CPU_D_FLAG) && CPU_rts_handler == NULL
+		&& !MonitorWatching(pc);
+}
+
+/* Compiles the block at PC into the cached entry PD. */
+static void JitCompile(predecode_entry_t *pd, UWORD pc)
+{
+	predecode_page_t const *page = predecode_pages[pc >> 8];
+	int max_start;
+	CPU_JIT_code_t block = CPU_JIT_Compile(pc, cycles, &max_start);
+	/* PD is stale if a full code buffer made CPU_JIT_Compile flush the cache */
+	if (pd->gen != page->gen)
+		return;
+	if (block == NULL) {
+		pd->block_state = JIT_FAILED;
+		return;
+	}
+	pd->block = block;
+	pd->block_max_start = max_start;
+	pd->block_state = JIT_COMPILED;
+	jit_stats.compiled++;
+}
+#endif /* CPU_JIT */
+
+void CPU_PredecodeStatsReset(void)
+{
+	memset(predecode_stats, 0, sizeof(predecode_stats));
+#ifdef CPU_JIT
+	memset(&jit_stats, 0, sizeof(jit_stats));
+#endif
+}
+
+void CPU_PredecodeStatsPrint(FILE *fp)
+{
+	int page;
+	double hits = 0;
+	double decodes = 0;
+	double invalidations = 0;
+	fprintf(fp, "Page  Hits        Decodes     Invalidations\n");
+	for (page = 0; page < 256; page++) {
+		predecode_stats_t const *st = &predecode_stats[page];
+		if (st->hits == 0 && st->decodes == 0 && st->invalidations == 0)
+			continue;
+		fprintf(fp, "%02X00  %-10lu  %-10lu  %lu\n", page,
+		        (unsigned long) st->hits, (unsigned long) st->decodes,
+		        (unsigned long) st->invalidations);
+		hits += st->hits;
+		decodes += st->decodes;
+		invalidations += st->invalidations;
+	}
+	fprintf(fp, "Total %.0f hits, %.0f decodes, %.0f invalidations", hits, decodes, invalidations);
+	if (hits + decodes > 0)
+		fprintf(fp, ", %.2f%% hit rate", 100.0 * hits / (hits + decodes));
+	fprintf(fp, "\n");
+#ifdef CPU_JIT
+	fprintf(fp, "JIT %s: %lu blocks compiled, %lu runs, %lu bail-outs\n",
+	        CPU_JIT_enabled ? "on" : "off", (unsigned long) jit_stats.compiled,
+	        (unsigned long) jit_stats.runs, (unsigned long) jit_stats.bails);
+#endif
+}
+#endif /* CPU_PREDECODE */
+
+/* Idle loops.
+   A loop is found at a backward branch or JMP and checked by IdleAnalyse:
+   it must be a straight run of at most IDLE_MAX_INSNS instructions from
+   its start to that jump, with only forward branches out of it. It may not
+   store anything, use the stack or read hardware other than VCOUNT.
+   The loop is then armed with the registers and ANTIC_xpos. If the next
+   pass comes back with the same registers after exactly the expected number
+   of cycles, every further pass will do the same, since nothing else can
+   change memory before CPU_GO returns. */
+#define IDLE_MAX_INSNS 8
+
+#define IDLE_NONE     0
+#define IDLE_IMPLIED  1
+#define IDLE_IMM      2
+#define IDLE_ZP       3
+#define IDLE_ZP_X     4
+#define IDLE_ZP_Y     5
+#define IDLE_ABS      6
+#define IDLE_ABS_X    7
+#define IDLE_ABS_Y    8
+#define IDLE_IND_X    9
+#define IDLE_IND_Y    10
+#define IDLE_BRANCH   11
+#define IDLE_JMP      12
+
+static struct {
+	int head;				/* start of the armed loop, -1 if none */
+	int rejected;			/* start of the last loop that failed IdleAnalyse */
+	int xpos;				/* ANTIC_xpos when armed */
+	UBYTE regs[9];
+	int cycles;				/* of one pass */
+	int vcount;				/* TRUE if the loop reads VCOUNT */
+#ifdef MONITOR_PROFILE
+	int n_insns;
+	UWORD insn_pc[IDLE_MAX_INSNS];
+	int insn_cycles[IDLE_MAX_INSNS];
+#endif
+} idle;
+
+static int IdleMode(UBYTE op)
+{
+	switch (op) {
+	case 0x0a: case 0x2a: case 0x4a: case 0x6a:	/* ASL ROL LSR ROR */
+	case 0x8a: case 0x98: case 0xa8: case 0xaa:	/* TXA TYA TAY TAX */
+	case 0xba: case 0x9a:						/* TSX TXS */
+	case 0xe8: case 0xc8: case 0xca: case 0x88:	/* INX INY DEX DEY */
+	case 0x18: case 0x38: case 0xb8: case 0xea:	/* CLC SEC CLV NOP */
+		return IDLE_IMPLIED;
+	case 0x09: case 0x29: case 0x49: case 0xc9:	/* ORA AND EOR CMP */
+	case 0xa9: case 0xa2: case 0xa0: case 0xe0: case 0xc0:	/* LDA LDX LDY CPX CPY */
+		return IDLE_IMM;
+	case 0x05: case 0x25: case 0x45: case 0xc5: case 0x24:
+	case 0xa5: case 0xa6: case 0xa4: case 0xe4: case 0xc4:
+		return IDLE_ZP;
+	case 0x15: case 0x35: case 0x55: case 0xd5: case 0xb5: case 0xb4:
+		return IDLE_ZP_X;
+	case 0xb6:
+		return IDLE_ZP_Y;
+	case 0x0d: case 0x2d: case 0x4d: case 0xcd: case 0x2c:
+	case 0xad: case 0xae: case 0xac: case 0xec: case 0xcc:
+		return IDLE_ABS;
+	case 0x1d: case 0x3d: case 0x5d: case 0xdd: case 0xbd: case 0xbc:
+		return IDLE_ABS_X;
+	case 0x19: case 0x39: case 0x59: case 0xd9: case 0xb9: case 0xbe:
+		return IDLE_ABS_Y;
+	case 0x01: case 0x21: case 0x41: case 0xc1: case 0xa1:
+		return IDLE_IND_X;
+	case 0x11: case 0x31: case 0x51: case 0xd1: case 0xb1:
+		return IDLE_IND_Y;
+	case 0x10: case 0x30: case 0x50: case 0x70:
+	case 0x90: case 0xb0: case 0xd0: case 0xf0:
+		return IDLE_BRANCH;
+	case 0x4c:
+		return IDLE_JMP;
+	default:
+		return IDLE_NONE;
+	}
+}
+
+/* TRUE if reading ADDR always gives the same value until CPU_GO returns,
+   which for VCOUNT is only until the end of the scanline. */
+static int IdleStableRead(UWORD addr)
+{
+#ifdef PAGED_ATTRIB
+	if (MEMORY_readmap[addr >> 8] == NULL)
+#else
+	if (MEMORY_attrib[addr] != MEMORY_HARDWARE)
+#endif
+		return TRUE;
+	/* skipped reads of VCOUNT would not be counted */
+	if ((addr & 0xff0f) == 0xd40b && !IOSTATS_enabled) {
+		idle.vcount = TRUE;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+/* Checks the loop from HEAD to the backward jump at BACK_EDGE (-1 if
+   unknown, then the first branch must be it) and sets idle.cycles and
+   idle.vcount. X and Y are the registers at HEAD. */
+static int IdleAnalyse(UWORD head, int back_edge, UBYTE X, UBYTE Y)
+{
+	UWORD pc = head;
+	int x_changed = FALSE;
+	int y_changed = FALSE;
+	int n;
+	idle.cycles = 0;
+	idle.vcount = FALSE;
+	for (n = 0; n < IDLE_MAX_INSNS; n++) {
+		UBYTE op = MEMORY_dGetByte(pc);
+		UBYTE lo = MEMORY_dGetByte((UWORD) (pc + 1));
+		UWORD word = lo + (MEMORY_dGetByte((UWORD) (pc + 2)) << 8);
+		int insn_cycles = cycles[op];
+		int len = 3;
+		UWORD addr;
+		switch (IdleMode(op)) {
+		case IDLE_IMPLIED:
+			len = 1;
+			break;
+		case IDLE_IMM:
+		case IDLE_ZP:
+			len = 2;
+			break;
+		case IDLE_ZP_X:
+		case IDLE_ZP_Y:
+			/* page zero is always read directly */
+			if (op == 0xb6 ? y_changed : x_changed)
+				return FALSE;
+			len = 2;
+			break;
+		case IDLE_ABS:
+			if (!IdleStableRead(word))
+				return FALSE;
+			break;
+		case IDLE_ABS_X:
+		case IDLE_ABS_Y:
+			if (IdleMode(op) == IDLE_ABS_X) {
+				if (x_changed)
+					return FALSE;
+				addr = word + X;
+				if ((UBYTE) addr < X)
+					insn_cycles++;
+			}
+			else {
+				if (y_changed)
+					return FALSE;
+				addr = word + Y;
+				if ((UBYTE) addr < Y)
+					insn_cycles++;
+			}
+			if (!IdleStableRead(addr))
+				return FALSE;
+			break;
+		case IDLE_IND_X:
+			if (x_changed)
+				return FALSE;
+			addr = (UBYTE) (lo + X);
+			if (!IdleStableRead(zGetWord(addr)))
+				return FALSE;
+			len = 2;
+			break;
+		case IDLE_IND_Y:
+			if (y_changed)
+				return FALSE;
+			addr = zGetWord(lo) + Y;
+			if ((UBYTE) addr < Y)
+				insn_cycles++;
+			if (!IdleStableRead(addr))
+				return FALSE;
+			len = 2;
+			break;
+		case IDLE_BRANCH:
+			addr = (UWORD) (pc + 2 + (SBYTE) lo);
+			if (addr == head) {
+				/* taken every pass */
+				insn_cycles += ((addr ^ (pc + 2)) & 0xff00) ? 2 : 1;
+				len = 0;
+			}
+			/* others must leave the loop, not taken while it goes on */
+			else if (back_edge < 0 || addr <= back_edge)
+				return FALSE;
+			else
+				len = 2;
+			break;
+		case IDLE_JMP:
+			if (word != head)
+				return FALSE;
+			len = 0;
+			break;
+		default:
+			return FALSE;
+		}
+		switch (op) {
+		case 0xa2: case 0xa6: case 0xb6: case 0xae: case 0xbe:
+		case 0xaa: case 0xba: case 0xe8: case 0xca:
+			x_changed = TRUE;
+			break;
+		case 0xa0: case 0xa4: case 0xb4: case 0xac: case 0xbc:
+		case 0xa8: case 0xc8: case 0x88:
+			y_changed = TRUE;
+			break;
+		default:
+			break;
+		}
+#ifdef MONITOR_PROFILE
+		idle.insn_pc[n] = pc;
+		idle.insn_cycles[n] = insn_cycles;
+		idle.n_insns = n + 1;
+#endif
+		idle.cycles += insn_cycles;
+		if (len == 0)
+			/* the jump back must be the one that found the loop */
+			return back_edge < 0 || pc == back_edge;
+		if (pc == back_edge)
+			return FALSE;
+		pc += len;
+	}
+	return FALSE;
+}
+
+/* Called after a backward jump from BACK_EDGE to HEAD has set ANTIC_xpos.
+   A, X, Y and S are the registers of CPU_GO. */
+static void IdleLoop(UWORD head, int back_edge, UBYTE A, UBYTE X, UBYTE Y, UBYTE S)
+{
+	UBYTE regs[9];
+	regs[0] = A;
+	regs[1] = X;
+	regs[2] = Y;
+	regs[3] = S;
+	regs[4] = N;
+	regs[5] = Z;
+	regs[6] = C;
+#ifndef NO_V_FLAG_VARIABLE
+	regs[7] = V;
+#else
+	regs[7] = 0;
+#endif
+	regs[8] = CPU_regP;
+	if (idle.head == head && ANTIC_xpos - idle.xpos == idle.cycles
+	 && memcmp(regs, idle.regs, sizeof(regs)) == 0 && !MonitorWatching(head)) {
+		int end = ANTIC_xpos_limit;
+		int passes;
+		if (idle.vcount) {
+			/* VCOUNT changes at ANTIC_LINE_C */
+			int eol = ANTIC_LINE_C;
+#ifdef NEW_CYCLE_EXACT
+			if (ANTIC_DRAWING_SCREEN)
+				eol = ANTIC_antic2cpu_ptr[ANTIC_LINE_C];
+#endif
+			if (eol < end)
+				end = eol;
+		}
+		/* each skipped pass would start and end before END */
+		passes = (end - 1 - ANTIC_xpos) / idle.cycles;
+		if (passes > 0) {
+			ANTIC_xpos += passes * idle.cycles;
+			idle_stats.frame += passes * idle.cycles;
+#ifdef MONITOR_PROFILE
+			{
+				int i;
+				for (i = 0; i < idle.n_insns; i++) {
+					UWORD pc = idle.insn_pc[i];
+					CPU_instruction_count[MEMORY_dGetByte(pc)] += passes;
+					MONITOR_coverage[pc].count += passes;
+					MONITOR_coverage[pc].cycles += passes * idle.insn_cycles[i];
+				}
+				MONITOR_coverage_insns += passes * idle.n_insns;
+				MONITOR_coverage_cycles += passes * idle.cycles;
+			}
+#endif
+		}
+		idle.head = -1;
+		return;
+	}
+	idle.head = -1;
+	if (head == idle.rejected || MonitorWatching(head)
+	 || (back_edge >= 0 && MonitorWatching((UWORD) back_edge)))
+		return;
+	if (!IdleAnalyse(head, back_edge, X, Y)) {
+		idle.rejected = head;
+		return;
+	}
+	idle.head = head;
+	idle.xpos = ANTIC_xpos;
+	memcpy(idle.regs, regs, sizeof(regs));
+}
+
+/* After a jump from INSN_PC to HEAD */
+#define IDLE_CHECK(head, insn_pc) \
+	if (CPU_idle_skip && (UWORD) (head) <= (UWORD) (insn_pc)) \
+		IdleLoop(head, (UWORD) (insn_pc), A, X, Y, S)
+
 /* 6502 emulation routine */
 #ifndef NO_GOTO
 __extension__ /* suppress -ansi -pedantic warnings */
@@ -492,13 +1105,20 @@ void CPU_GO(int limit)
 	UWORD addr;
 	UBYTE data;
 #define insn data
+#ifdef CPU_PREDECODE
+	predecode_entry_t *pd;
+#endif
 
 #else /* FALCON_CPUASM */
 
-#if defined(PAGED_MEM) || defined(PAGED_ATTRIB)
+#if defined(PAGED_MEM) || defined(PAGED_ATTRIB) || defined(XE_BANK_PTR)
 #error cpu_m68k.asm cannot work with paged memory/attributes
 #endif
 
+#if defined(CPU_PREDECODE)
+#error cpu_m68k.asm does not support the predecoded instruction cache
+#endif
+
 #if defined(MONITOR_BREAKPOINTS)
 #error cpu_m68k.asm does not support user-defined breakpoints
 #endif
@@ -589,6 +1209,10 @@ void CPU_GO(int limit)
 	CPUCHECKIRQ;
 
 #ifndef FALCON_CPUASM
+	/* memory may have changed since the last call */
+	idle.head = -1;
+	idle.rejected = -1;
+
 	while (ANTIC_xpos < ANTIC_xpos_limit) {
 #ifdef MONITOR_PROFILE
 		int old_xpos = ANTIC_xpos;
@@ -618,6 +1242,32 @@ void CPU_GO(int limit)
 #endif /* PC_PTR */
 
 #ifdef MONITOR_TRACE
+		if (CPUTRACE_enabled) {
+			CPUTRACE_record_t *r = CPUTRACE_Next();
+			UWORD pc = GET_PC();
+			int xpos = ANTIC_XPOS;
+			unsigned int clock = ANTIC_screenline_cpu_clock + xpos;
+			r->pc = pc;
+			r->ypos = (UWORD) ANTIC_ypos;
+			r->xpos = (UBYTE) xpos;
+			r->a = A;
+			r->x = X;
+			r->y = Y;
+			r->s = S;
+			r->p = (N & 0x80) |
+#ifndef NO_V_FLAG_VARIABLE
+				(V ? 0x40 : 0) |
+#else
+				(CPU_regP & CPU_V_FLAG) |
+#endif
+				0x30 | (CPU_regP & (CPU_D_FLAG | CPU_I_FLAG)) | (Z == 0 ? 0x02 : 0) | (C != 0 ? 0x01 : 0);
+			r->code[0] = MEMORY_dGetByte(pc);
+			r->code[1] = MEMORY_dGetByte((UWORD) (pc + 1));
+			r->code[2] = MEMORY_dGetByte((UWORD) (pc + 2));
+			r->clock[0] = (UBYTE) clock;
+			r->clock[1] = (UBYTE) (clock >> 8);
+			r->clock[2] = (UBYTE) (clock >> 16);
+		}
 		if (MONITOR_trace_file != NULL) {
 			MONITOR_ShowState(MONITOR_trace_file, GET_PC(), A, X, Y, S,
 				(N & 0x80) ? 'N' : '-',
@@ -653,7 +1303,81 @@ void CPU_GO(int limit)
 		MEMORY_mem[0x10000] = MEMORY_mem[0];
 #endif
 
+#ifdef CPU_PREDECODE
+		{
+			predecode_page_t *page = predecode_pages[PC >> 8];
+			if (page != NULL && page->entry[PC & 0xff].gen == page->gen) {
+				pd = &page->entry[PC & 0xff];
+				predecode_stats[PC >> 8].hits++;
+			}
+			else {
+				pd = PredecodeFill(PC);
+#ifndef NO_GOTO
+				pd->handler = opcode[pd->code];
+#endif
+			}
+		}
+#ifdef CPU_JIT
+		if (pd != &predecode_scratch && JitAllowed(PC)) {
+			if (pd->block_state == JIT_UNTRIED)
+				JitCompile(pd, PC);
+			/* only if every instruction of the block would start before the limit */
+			if (pd->block_state == JIT_COMPILED && ANTIC_xpos + pd->block_max_start < ANTIC_xpos_limit) {
+				CPU_JIT_regs_t r;
+				int status;
+				r.a = A;
+				r.x = X;
+				r.y = Y;
+				r.s = S;
+				r.n = N;
+				r.z = Z;
+				r.c = C;
+#ifndef NO_V_FLAG_VARIABLE
+				r.v = V;
+#else
+				r.v = CPU_regP & CPU_V_FLAG;
+#endif
+				r.pc = PC;
+				r.xpos = ANTIC_xpos;
+				r.mem = MEMORY_mem;
+				r.attrib = MEMORY_attrib;
+				r.cached = CPU_predecode_cached;
+				status = pd->block(&r);
+				A = r.a;
+				X = r.x;
+				Y = r.y;
+				S = r.s;
+				N = r.n;
+				Z = r.z;
+				C = r.c;
+#ifndef NO_V_FLAG_VARIABLE
+				V = r.v;
+#else
+				if (r.v)
+					CPU_SetV;
+				else
+					CPU_ClrV;
+#endif
+				ANTIC_xpos = r.xpos;
+				jit_stats.runs++;
+				if (status == CPU_JIT_BAIL)
+					jit_stats.bails++;
+				/* a block that bailed out at once leaves its first instruction to us */
+				if (status == CPU_JIT_DONE || r.pc != PC) {
+					/* a block that jumped back to its start may be an idle loop */
+					if (status == CPU_JIT_DONE && r.pc == PC && CPU_idle_skip)
+						IdleLoop(PC, -1, A, X, Y, S);
+					PC = r.pc;
+					continue;
+				}
+			}
+		}
+#endif /* CPU_JIT */
+		insn = pd->code;
+		PC++;
+#else
 		insn = GET_CODE_BYTE();
+#endif
 
 #ifdef MONITOR_BREAKPOINTS
 #ifdef MONITOR_BREAK
@@ -824,8 +1548,12 @@ void CPU_GO(int limit)
 #endif /* MONITOR_BREAKPOINTS */
 
 #ifndef CYCLES_PER_OPCODE
+#ifdef CPU_PREDECODE
+		ANTIC_xpos += pd->cycles;
+#else
 		ANTIC_xpos += cycles[insn];
 #endif
+#endif
 
 #ifdef MONITOR_PROFILE
 		CPU_instruction_count[insn]++;
@@ -833,12 +1561,16 @@ void CPU_GO(int limit)
 		MONITOR_coverage_insns++;
 #endif
 
-#ifdef PREFETCH_CODE
+#ifdef CPU_PREDECODE
+		addr = pd->operand;
+#elif defined(PREFETCH_CODE)
 		addr = PEEK_CODE_WORD();
 #endif
 
 #ifdef NO_GOTO
 		switch (insn) {
+#elif defined(CPU_PREDECODE)
+		goto *pd->handler;
 #else
 		goto *opcode[insn];
 #endif
@@ -862,6 +1594,7 @@ void CPU_GO(int limit)
 			PHPB1;
 			CPU_SetI;
 			SET_PC(MEMORY_dGetWordAligned(0xfffe));
+			PROFILE_INTERRUPT(CPUPROF_IRQ, (UBYTE) (S + 3));
 			INC_RET_NESTING;
 		}
 		DONE
@@ -1050,6 +1783,7 @@ void CPU_GO(int limit)
 			CPU_remember_jmp_curpos = (CPU_remember_jmp_curpos + 1) % CPU_REMEMBER_JMP_STEPS;
 			MONITOR_ret_nesting++;
 #endif
+			PROFILE_CALL(old_PC, OP_WORD, S);
 			PHW(retaddr);
 		}
 		SET_PC(OP_WORD);
@@ -1227,6 +1961,7 @@ void CPU_GO(int limit)
 		PLP;
 		data = PL;
 		SET_PC((PL << 8) + data);
+		PROFILE_RETURN(old_PC, S);
 		CPUCHECKIRQ;
 #ifdef MONITOR_BREAK
 		if (MONITOR_break_ret && --MONITOR_ret_nesting <= 0)
@@ -1299,6 +2034,7 @@ void CPU_GO(int limit)
 		CPU_remember_JMP[CPU_remember_jmp_curpos] = GET_PC() - 1;
 		CPU_remember_jmp_curpos = (CPU_remember_jmp_curpos + 1) % CPU_REMEMBER_JMP_STEPS;
 #endif
+		IDLE_CHECK(OP_WORD, GET_PC() - 1);
 		SET_PC(OP_WORD);
 		DONE
 
@@ -1392,6 +2128,7 @@ void CPU_GO(int limit)
 	OPCODE(60)				/* RTS */
 		data = PL;
 		SET_PC((PL << 8) + data + 1);
+		PROFILE_RETURN(old_PC, S);
 #ifdef MONITOR_BREAK
 		if (MONITOR_break_ret && --MONITOR_ret_nesting <= 0)
 			MONITOR_break_step = TRUE;
@@ -2404,6 +3141,8 @@ void CPU_GO(int limit)
 			MONITOR_coverage[old_PC].cycles += cyc;
 			MONITOR_coverage_cycles += cyc;
 		}
+		if (CPUPROF_enabled)
+			CPUPROF_Instruction(old_PC);
 #endif
 
 #ifdef MONITOR_BREAK
@@ -2430,6 +3169,8 @@ void CPU_Reset(void)
 {
 #ifdef MONITOR_PROFILE
 	memset(CPU_instruction_count, 0, sizeof(CPU_instruction_count));
+	if (CPUPROF_enabled)
+		CPUPROF_Unwind(0xff);
 #endif
 
 	CPU_IRQ = 0;
@@ -2,6 +2,12 @@
 #define CPU_H_
 
 #include "config.h"
+#include <stdio.h>
+
+/* Compiled blocks live in the predecoded instruction cache. */
+#if defined(CPU_JIT) && !defined(CPU_PREDECODE)
+#define CPU_PREDECODE
+#endif
 #ifdef ASAP /* external project, see http://asap.sf.net */
 #include "asap_internal.h"
 #else
@@ -70,4 +76,45 @@ extern unsigned int CPU_remember_jmp_curpos;
 extern int CPU_instruction_count[256];
 #endif
 
+int CPU_Initialise(int *argc, char *argv[]);
+
+/* Idle loop skipping. A loop that doesn't store anything, reads only memory
+   or VCOUNT and comes back to its start with the same registers will go on
+   like that until the next interrupt or scanline, so CPU_GO adds the cycles
+   of all such passes to ANTIC_xpos at once. The result is the same as
+   running them. */
+extern int CPU_idle_skip;
+/* Cycles skipped during the last frame. */
+extern int CPU_idle_frame_cycles;
+/* Called after each frame. */
+void CPU_IdleFrame(void);
+void CPU_IdleStatsReset(void);
+void CPU_IdleStatsPrint(FILE *fp);
+
+#ifdef CPU_PREDECODE
+/* Predecoded instruction cache. CPU_predecode_cached[page] is nonzero while
+   the page holds predecoded instructions. The MEMORY_d* store macros drop
+   them on every write to RAM; code that changes memory in any other way
+   (memcpy into MEMORY_mem, switching banks) must call
+   CPU_PredecodeInvalidate or CPU_PredecodeFlush. */
+extern UBYTE CPU_predecode_cached[256];
+void CPU_PredecodeInvalidatePage(int page);
+void CPU_PredecodeInvalidate(UWORD addr, int size);
+void CPU_PredecodeFlush(void);
+
+/* Returns ADDR after dropping predecoded code of its page. Not inline:
+   gcc won't inline it in the cold interrupt paths of the CPU loop, and a
+   macro would evaluate ADDR more than once (PH passes S--). */
+unsigned int CPU_PredecodeWrite(unsigned int addr);
+/* Same for a word store that may cross a page boundary. */
+unsigned int CPU_PredecodeWriteWord(unsigned int addr);
+
+/* Per-page hits, decodes and invalidations. */
+void CPU_PredecodeStatsReset(void);
+void CPU_PredecodeStatsPrint(FILE *fp);
+#else
+#define CPU_PredecodeInvalidate(addr, size)
+#define CPU_PredecodeFlush()
+#endif /* CPU_PREDECODE */
+
 #endif /* CPU_H_ */
@@ -0,0 +1,1015 @@
+/*
+ * cpu_jit.c - Compile 6502 basic blocks to x86-64 machine code
+ *
+ * Copyright (c) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/*
+   A block is a run of instructions inside one 256-byte page, ending at
+   the first jump, branch or instruction that is not compiled (BRK, RTI,
+   PHP, PLP, flag changes other than CLC/SEC/CLV, unofficial opcodes).
+   The compiled block keeps the 6502 registers in host registers and
+   returns to CPU_GO:
+   - at its end, with CPU_JIT_DONE,
+   - before an access to a MEMORY_HARDWARE address, a store to ROM or a store
+     to a page holding predecoded code, with CPU_JIT_BAIL and the registers
+     as they were before that instruction.
+   The caller runs a block only if it finishes before ANTIC_xpos_limit
+   even with all page-crossing penalties and with the D flag clear,
+   so the only cycle-accurate work left to the block is adding the cycles.
+
+   Host registers:
+   rdi - CPU_JIT_regs_t *, rsi - MEMORY_mem, rbp - MEMORY_attrib,
+   r12 - CPU_predecode_cached, r8 - A, r9 - X, r10 - Y, r11 - S,
+   r13 - N, r14 - Z, r15 - C, rbx - V, rax, rcx, rdx - scratch.
+*/
+
+#define _DEFAULT_SOURCE /* for MAP_ANONYMOUS */
+
+#include "config.h"
+#include <stddef.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "atari.h"
+#include "cpu.h"
+#include "cpu_jit.h"
+#include "log.h"
+#include "memory.h"
+
+#ifndef __x86_64__
+#error The 6502 JIT generates x86-64 code only
+#endif
+
+#if defined(PAGED_ATTRIB) || defined(XE_BANK_PTR)
+#error The 6502 JIT needs flat MEMORY_mem and MEMORY_attrib
+#endif
+
+#if !defined(MAP_ANONYMOUS) && defined(MAP_ANON)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+int CPU_JIT_enabled = TRUE;
+
+#define CODE_SIZE 0x400000			/* 4 MB of generated code */
+#define MAX_BLOCK_CODE 0x4000		/* more than the longest block can need */
+#define CODE_PAGE 0x1000			/* x86-64 page size */
+#define MAX_BLOCK_INSNS 64
+#define MAX_BAILS (MAX_BLOCK_INSNS * 4)
+
+static UBYTE *code_buf = NULL;
+static UBYTE *code_ptr;
+static int code_failed = FALSE;
+
+/* Operations */
+enum {
+	OP_NONE, OP_LDA, OP_LDX, OP_LDY, OP_STA, OP_STX, OP_STY,
+	OP_AND, OP_ORA, OP_EOR, OP_ADC, OP_SBC, OP_CMP, OP_CPX, OP_CPY, OP_BIT,
+	OP_INC, OP_DEC, OP_ASL, OP_LSR, OP_ROL, OP_ROR,
+	OP_TAX, OP_TAY, OP_TXA, OP_TYA, OP_TSX, OP_TXS,
+	OP_INX, OP_INY, OP_DEX, OP_DEY, OP_CLC, OP_SEC, OP_CLV, OP_NOP,
+	OP_PHA, OP_PLA, OP_JMP, OP_JMPI, OP_JSR, OP_RTS, OP_BRANCH
+};
+
+/* Addressing modes */
+enum {
+	M_IMP, M_IMM, M_ZP, M_ZPX, M_ZPY, M_ABS, M_ABSX, M_ABSY, M_INDX, M_INDY, M_REL
+};
+
+static const struct {
+	UBYTE code;
+	UBYTE op;
+	UBYTE mode;
+} insn_list[] = {
+	{ 0x09, OP_ORA, M_IMM }, { 0x05, OP_ORA, M_ZP }, { 0x15, OP_ORA, M_ZPX }, { 0x0d, OP_ORA, M_ABS },
+	{ 0x1d, OP_ORA, M_ABSX }, { 0x19, OP_ORA, M_ABSY }, { 0x01, OP_ORA, M_INDX }, { 0x11, OP_ORA, M_INDY },
+	{ 0x29, OP_AND, M_IMM }, { 0x25, OP_AND, M_ZP }, { 0x35, OP_AND, M_ZPX }, { 0x2d, OP_AND, M_ABS },
+	{ 0x3d, OP_AND, M_ABSX }, { 0x39, OP_AND, M_ABSY }, { 0x21, OP_AND, M_INDX }, { 0x31, OP_AND, M_INDY },
+	{ 0x49, OP_EOR, M_IMM }, { 0x45, OP_EOR, M_ZP }, { 0x55, OP_EOR, M_ZPX }, { 0x4d, OP_EOR, M_ABS },
+	{ 0x5d, OP_EOR, M_ABSX }, { 0x59, OP_EOR, M_ABSY }, { 0x41, OP_EOR, M_INDX }, { 0x51, OP_EOR, M_INDY },
+	{ 0x69, OP_ADC, M_IMM }, { 0x65, OP_ADC, M_ZP }, { 0x75, OP_ADC, M_ZPX }, { 0x6d, OP_ADC, M_ABS },
+	{ 0x7d, OP_ADC, M_ABSX }, { 0x79, OP_ADC, M_ABSY }, { 0x61, OP_ADC, M_INDX }, { 0x71, OP_ADC, M_INDY },
+	{ 0xe9, OP_SBC, M_IMM }, { 0xe5, OP_SBC, M_ZP }, { 0xf5, OP_SBC, M_ZPX }, { 0xed, OP_SBC, M_ABS },
+	{ 0xfd, OP_SBC, M_ABSX }, { 0xf9, OP_SBC, M_ABSY }, { 0xe1, OP_SBC, M_INDX }, { 0xf1, OP_SBC, M_INDY },
+	{ 0xc9, OP_CMP, M_IMM }, { 0xc5, OP_CMP, M_ZP }, { 0xd5, OP_CMP, M_ZPX }, { 0xcd, OP_CMP, M_ABS },
+	{ 0xdd, OP_CMP, M_ABSX }, { 0xd9, OP_CMP, M_ABSY }, { 0xc1, OP_CMP, M_INDX }, { 0xd1, OP_CMP, M_INDY },
+	{ 0xa9, OP_LDA, M_IMM }, { 0xa5, OP_LDA, M_ZP }, { 0xb5, OP_LDA, M_ZPX }, { 0xad, OP_LDA, M_ABS },
+	{ 0xbd, OP_LDA, M_ABSX }, { 0xb9, OP_LDA, M_ABSY }, { 0xa1, OP_LDA, M_INDX }, { 0xb1, OP_LDA, M_INDY },
+	{ 0x85, OP_STA, M_ZP }, { 0x95, OP_STA, M_ZPX }, { 0x8d, OP_STA, M_ABS },
+	{ 0x9d, OP_STA, M_ABSX }, { 0x99, OP_STA, M_ABSY }, { 0x81, OP_STA, M_INDX }, { 0x91, OP_STA, M_INDY },
+	{ 0xe0, OP_CPX, M_IMM }, { 0xe4, OP_CPX, M_ZP }, { 0xec, OP_CPX, M_ABS },
+	{ 0xc0, OP_CPY, M_IMM }, { 0xc4, OP_CPY, M_ZP }, { 0xcc, OP_CPY, M_ABS },
+	{ 0xa2, OP_LDX, M_IMM }, { 0xa6, OP_LDX, M_ZP }, { 0xb6, OP_LDX, M_ZPY }, { 0xae, OP_LDX, M_ABS }, { 0xbe, OP_LDX, M_ABSY },
+	{ 0xa0, OP_LDY, M_IMM }, { 0xa4, OP_LDY, M_ZP }, { 0xb4, OP_LDY, M_ZPX }, { 0xac, OP_LDY, M_ABS }, { 0xbc, OP_LDY, M_ABSX },
+	{ 0x86, OP_STX, M_ZP }, { 0x96, OP_STX, M_ZPY }, { 0x8e, OP_STX, M_ABS },
+	{ 0x84, OP_STY, M_ZP }, { 0x94, OP_STY, M_ZPX }, { 0x8c, OP_STY, M_ABS },
+	{ 0x24, OP_BIT, M_ZP }, { 0x2c, OP_BIT, M_ABS },
+	{ 0xe6, OP_INC, M_ZP }, { 0xf6, OP_INC, M_ZPX }, { 0xee, OP_INC, M_ABS }, { 0xfe, OP_INC, M_ABSX },
+	{ 0xc6, OP_DEC, M_ZP }, { 0xd6, OP_DEC, M_ZPX }, { 0xce, OP_DEC, M_ABS }, { 0xde, OP_DEC, M_ABSX },
+	{ 0x0a, OP_ASL, M_IMP }, { 0x06, OP_ASL, M_ZP }, { 0x16, OP_ASL, M_ZPX }, { 0x0e, OP_ASL, M_ABS }, { 0x1e, OP_ASL, M_ABSX },
+	{ 0x4a, OP_LSR, M_IMP }, { 0x46, OP_LSR, M_ZP }, { 0x56, OP_LSR, M_ZPX }, { 0x4e, OP_LSR, M_ABS }, { 0x5e, OP_LSR, M_ABSX },
+	{ 0x2a, OP_ROL, M_IMP }, { 0x26, OP_ROL, M_ZP }, { 0x36, OP_ROL, M_ZPX }, { 0x2e, OP_ROL, M_ABS }, { 0x3e, OP_ROL, M_ABSX },
+	{ 0x6a, OP_ROR, M_IMP }, { 0x66, OP_ROR, M_ZP }, { 0x76, OP_ROR, M_ZPX }, { 0x6e, OP_ROR, M_ABS }, { 0x7e, OP_ROR, M_ABSX },
+	{ 0xaa, OP_TAX, M_IMP }, { 0xa8, OP_TAY, M_IMP }, { 0x8a, OP_TXA, M_IMP }, { 0x98, OP_TYA, M_IMP },
+	{ 0xba, OP_TSX, M_IMP }, { 0x9a, OP_TXS, M_IMP },
+	{ 0xe8, OP_INX, M_IMP }, { 0xc8, OP_INY, M_IMP }, { 0xca, OP_DEX, M_IMP }, { 0x88, OP_DEY, M_IMP },
+	{ 0x18, OP_CLC, M_IMP }, { 0x38, OP_SEC, M_IMP }, { 0xb8, OP_CLV, M_IMP }, { 0xea, OP_NOP, M_IMP },
+	{ 0x48, OP_PHA, M_IMP }, { 0x68, OP_PLA, M_IMP },
+	{ 0x4c, OP_JMP, M_ABS }, { 0x6c, OP_JMPI, M_ABS }, { 0x20, OP_JSR, M_ABS }, { 0x60, OP_RTS, M_IMP },
+	{ 0x10, OP_BRANCH, M_REL }, { 0x30, OP_BRANCH, M_REL }, { 0x50, OP_BRANCH, M_REL }, { 0x70, OP_BRANCH, M_REL },
+	{ 0x90, OP_BRANCH, M_REL }, { 0xb0, OP_BRANCH, M_REL }, { 0xd0, OP_BRANCH, M_REL }, { 0xf0, OP_BRANCH, M_REL }
+};
+
+static UBYTE insn_op[256];
+static UBYTE insn_mode[256];
+
+/* x86-64 registers */
+enum {
+	RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+#define R_REGS   RDI
+#define R_MEM    RSI
+#define R_ATTRIB RBP
+#define R_CACHED R12
+#define R_A      R8
+#define R_X      R9
+#define R_Y      R10
+#define R_S      R11
+#define R_N      R13
+#define R_Z      R14
+#define R_C      R15
+#define R_V      RBX
+
+/* Condition codes */
+#define CC_B  0x2
+#define CC_AE 0x3
+#define CC_E  0x4
+#define CC_NE 0x5
+
+/* ALU operations: opcode of "op r/m32, r32" and /digit of "op r/m32, imm32" */
+#define ALU_ADD 0x01, 0
+#define ALU_OR  0x09, 1
+#define ALU_AND 0x21, 4
+#define ALU_SUB 0x29, 5
+#define ALU_XOR 0x31, 6
+#define ALU_CMP 0x39, 7
+
+static UBYTE *out;
+
+/* Instructions of the block being compiled */
+static UWORD insn_pc[MAX_BLOCK_INSNS];
+static int insn_cycles[MAX_BLOCK_INSNS];
+static int cur_insn;
+
+/* Jumps to the bail-out code of an instruction, patched at the end */
+static UBYTE *bail_patch[MAX_BAILS];
+static int bail_insn[MAX_BAILS];
+static int n_bails;
+
+static UBYTE *epilogue;
+
+static void emit8(int b)
+{
+	*out++ = (UBYTE) b;
+}
+
+static void emit32(int v)
+{
+	emit8(v);
+	emit8(v >> 8);
+	emit8(v >> 16);
+	emit8(v >> 24);
+}
+
+static void patch32(UBYTE *p, const UBYTE *target)
+{
+	int rel = (int) (target - (p + 4));
+	p[0] = (UBYTE) rel;
+	p[1] = (UBYTE) (rel >> 8);
+	p[2] = (UBYTE) (rel >> 16);
+	p[3] = (UBYTE) (rel >> 24);
+}
+
+/* Always emitting REX makes byte registers 4..7 mean spl..dil, not ah..bh. */
+static void rex(int w, int reg, int index, int base)
+{
+	emit8(0x40 | (w << 3) | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3));
+}
+
+static void opcode(int op)
+{
+	if (op > 0xff)
+		emit8(op >> 8);
+	emit8(op);
+}
+
+/* OP with register operands REG and RM. */
+static void op_rr(int w, int op, int reg, int rm)
+{
+	rex(w, reg, 0, rm);
+	opcode(op);
+	emit8(0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/* OP with register REG and memory operand [BASE + INDEX + DISP];
+   INDEX < 0 means no index. */
+static void op_rm(int w, int op, int reg, int base, int index, int disp)
+{
+	int mod;
+	rex(w, reg, index < 0 ? 0 : index, base);
+	opcode(op);
+	if (disp == 0 && (base & 7) != RBP)
+		mod = 0;
+	else if (disp >= -128 && disp <= 127)
+		mod = 1;
+	else
+		mod = 2;
+	if (index >= 0 || (base & 7) == RSP) {
+		emit8((mod << 6) | ((reg & 7) << 3) | 4);
+		emit8((((index >= 0 ? index : RSP) & 7) << 3) | (base & 7));
+	}
+	else
+		emit8((mod << 6) | ((reg & 7) << 3) | (base & 7));
+	if (mod == 1)
+		emit8(disp);
+	else if (mod == 2)
+		emit32(disp);
+}
+
+#define MOV_RR(dst, src)                op_rr(0, 0x8b, dst, src)
+#define MOVZX_RR(dst, src)              op_rr(0, 0x0fb6, dst, src)
+#define MOVZX_RM(dst, base, index, disp) op_rm(0, 0x0fb6, dst, base, index, disp)
+#define STORE8(src, base, index, disp)  op_rm(0, 0x88, src, base, index, disp)
+#define SETCC(cc, reg)                  op_rr(0, 0x0f90 | (cc), 0, reg)
+
+static void alu_rr(int op, int digit, int dst, int src)
+{
+	op_rr(0, op, src, dst);
+}
+
+static void alu_ri(int op, int digit, int reg, int imm)
+{
+	op_rr(0, 0x81, digit, reg);
+	emit32(imm);
+}
+
+#define ALU_RR(alu, dst, src) alu_rr(alu, dst, src)
+#define ALU_RI(alu, reg, imm) alu_ri(alu, reg, imm)
+
+static void mov_ri(int reg, int imm)
+{
+	rex(0, 0, 0, reg);
+	emit8(0xb8 + (reg & 7));
+	emit32(imm);
+}
+
+/* SHL (DIGIT 4) or SHR (DIGIT 5) by N */
+static void shift_ri(int digit, int reg, int n)
+{
+	op_rr(0, 0xc1, digit, reg);
+	emit8(n);
+}
+
+#define SHL(reg, n) shift_ri(4, reg, n)
+#define SHR(reg, n) shift_ri(5, reg, n)
+
+/* cmp byte [BASE + INDEX + DISP], IMM */
+static void cmp_mem8(int base, int index, int disp, int imm)
+{
+	op_rm(0, 0x80, 7, base, index, disp);
+	emit8(imm);
+}
+
+/* add dword [regs->xpos], N */
+static void add_xpos(int n)
+{
+	op_rm(0, 0x81, 0, R_REGS, -1, (int) offsetof(CPU_JIT_regs_t, xpos));
+	emit32(n);
+}
+
+/* Emits jcc rel32 and returns the address of rel32. */
+static UBYTE *jcc(int cc)
+{
+	UBYTE *p;
+	emit8(0x0f);
+	emit8(0x80 | cc);
+	p = out;
+	emit32(0);
+	return p;
+}
+
+static void jmp_to(const UBYTE *target)
+{
+	emit8(0xe9);
+	emit32(0);
+	patch32(out - 4, target);
+}
+
+static void push_host(int reg)
+{
+	if (reg & 8)
+		emit8(0x41);
+	emit8(0x50 + (reg & 7));
+}
+
+static void pop_host(int reg)
+{
+	if (reg & 8)
+		emit8(0x41);
+	emit8(0x58 + (reg & 7));
+}
+
+/* 6502 registers in CPU_JIT_regs_t */
+static const struct {
+	int reg;
+	int offset;
+} reg_map[] = {
+	{ R_A, offsetof(CPU_JIT_regs_t, a) },
+	{ R_X, offsetof(CPU_JIT_regs_t, x) },
+	{ R_Y, offsetof(CPU_JIT_regs_t, y) },
+	{ R_S, offsetof(CPU_JIT_regs_t, s) },
+	{ R_N, offsetof(CPU_JIT_regs_t, n) },
+	{ R_Z, offsetof(CPU_JIT_regs_t, z) },
+	{ R_C, offsetof(CPU_JIT_regs_t, c) },
+	{ R_V, offsetof(CPU_JIT_regs_t, v) }
+};
+
+static const int saved_regs[] = { RBX, RBP, R12, R13, R14, R15 };
+
+#define N_ITEMS(a) ((int) (sizeof(a) / sizeof((a)[0])))
+
+static void gen_prologue(void)
+{
+	int i;
+	for (i = 0; i < N_ITEMS(saved_regs); i++)
+		push_host(saved_regs[i]);
+	op_rm(1, 0x8b, R_MEM, R_REGS, -1, (int) offsetof(CPU_JIT_regs_t, mem));
+	op_rm(1, 0x8b, R_ATTRIB, R_REGS, -1, (int) offsetof(CPU_JIT_regs_t, attrib));
+	op_rm(1, 0x8b, R_CACHED, R_REGS, -1, (int) offsetof(CPU_JIT_regs_t, cached));
+	for (i = 0; i < N_ITEMS(reg_map); i++)
+		MOVZX_RM(reg_map[i].reg, R_REGS, -1, reg_map[i].offset);
+}
+
+/* Entered with the new PC in ecx, cycles to add in edx
+   and the return value in eax. */
+static void gen_epilogue(void)
+{
+	int i;
+	emit8(0x66);
+	op_rm(0, 0x89, RCX, R_REGS, -1, (int) offsetof(CPU_JIT_regs_t, pc));
+	op_rm(0, 0x01, RDX, R_REGS, -1, (int) offsetof(CPU_JIT_regs_t, xpos));
+	for (i = 0; i < N_ITEMS(reg_map); i++)
+		STORE8(reg_map[i].reg, R_REGS, -1, reg_map[i].offset);
+	for (i = N_ITEMS(saved_regs); --i >= 0; )
+		pop_host(saved_regs[i]);
+	emit8(0xc3);
+}
+
+/* Leaves the block at the constant address PC. */
+static void exit_const(int pc, int cycles, int status)
+{
+	mov_ri(RCX, pc);
+	mov_ri(RDX, cycles);
+	mov_ri(RAX, status);
+	jmp_to(epilogue);
+}
+
+/* Leaves the block at the address in ecx. */
+static void exit_dynamic(int cycles)
+{
+	mov_ri(RDX, cycles);
+	mov_ri(RAX, CPU_JIT_DONE);
+	jmp_to(epilogue);
+}
+
+/* Returns to the interpreter before the current instruction if CC. */
+static void bail_if(int cc)
+{
+	bail_patch[n_bails] = jcc(cc);
+	bail_insn[n_bails] = cur_insn;
+	n_bails++;
+}
+
+static void set_nz(int reg)
+{
+	MOV_RR(R_N, reg);
+	MOV_RR(R_Z, reg);
+}
+
+static int is_zpage(int mode)
+{
+	return mode == M_ZP || mode == M_ZPX || mode == M_ZPY;
+}
+
+/* Loads the 16-bit pointer at zero page address ZP into eax; clobbers edx.
+   Wraps in the zero page like zGetWord. */
+static void gen_zp_pointer(int zp)
+{
+	MOVZX_RM(RAX, R_MEM, -1, zp);
+	MOVZX_RM(RDX, R_MEM, -1, (zp + 1) & 0xff);
+	SHL(RDX, 8);
+	ALU_RR(ALU_OR, RAX, RDX);
+}
+
+/* Computes the effective address into ecx; clobbers eax and edx. */
+static void gen_ea(int mode, int operand)
+{
+	switch (mode) {
+	case M_ZP:
+		mov_ri(RCX, operand & 0xff);
+		break;
+	case M_ZPX:
+	case M_ZPY:
+		MOV_RR(RCX, mode == M_ZPX ? R_X : R_Y);
+		ALU_RI(ALU_ADD, RCX, operand & 0xff);
+		MOVZX_RR(RCX, RCX);
+		break;
+	case M_ABS:
+		mov_ri(RCX, operand);
+		break;
+	case M_ABSX:
+	case M_ABSY:
+		MOV_RR(RCX, mode == M_ABSX ? R_X : R_Y);
+		ALU_RI(ALU_ADD, RCX, operand);
+		ALU_RI(ALU_AND, RCX, 0xffff);
+		break;
+	case M_INDX:
+		MOV_RR(RCX, R_X);
+		ALU_RI(ALU_ADD, RCX, operand & 0xff);
+		MOVZX_RR(RCX, RCX);
+		MOVZX_RM(RAX, R_MEM, RCX, 0);
+		ALU_RI(ALU_ADD, RCX, 1);
+		MOVZX_RR(RCX, RCX);
+		MOVZX_RM(RDX, R_MEM, RCX, 0);
+		SHL(RDX, 8);
+		ALU_RR(ALU_OR, RAX, RDX);
+		MOV_RR(RCX, RAX);
+		break;
+	case M_INDY:
+		gen_zp_pointer(operand & 0xff);
+		ALU_RR(ALU_ADD, RAX, R_Y);
+		ALU_RI(ALU_AND, RAX, 0xffff);
+		MOV_RR(RCX, RAX);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Loads the operand into eax, the address (if any) into ecx. Adds a cycle
+   when an indexed read crosses a page, like NCYCLES_X and NCYCLES_Y. */
+static void gen_read(int mode, int operand)
+{
+	if (mode == M_IMM) {
+		mov_ri(RAX, operand & 0xff);
+		return;
+	}
+	gen_ea(mode, operand);
+	if (!is_zpage(mode)) {
+		cmp_mem8(R_ATTRIB, RCX, 0, MEMORY_HARDWARE);
+		bail_if(CC_E);
+		if (mode == M_ABSX || mode == M_ABSY || mode == M_INDY) {
+			UBYTE *skip;
+			MOVZX_RR(RAX, RCX);
+			ALU_RR(ALU_CMP, RAX, mode == M_ABSX ? R_X : R_Y);
+			emit8(0x70 | CC_AE);
+			emit8(0);
+			skip = out;
+			add_xpos(1);
+			skip[-1] = (UBYTE) (out - skip);
+		}
+	}
+	MOVZX_RM(RAX, R_MEM, RCX, 0);
+}
+
+/* Bails out unless a byte may be stored at the address in ecx (or zero
+   page for zero-page modes) without leaving RAM or touching cached code.
+   Clobbers edx. */
+static void gen_write_check(int mode)
+{
+	if (is_zpage(mode)) {
+		cmp_mem8(R_CACHED, -1, 0, 0);
+		bail_if(CC_NE);
+	}
+	else {
+		cmp_mem8(R_ATTRIB, RCX, 0, MEMORY_RAM);
+		bail_if(CC_NE);
+		MOV_RR(RDX, RCX);
+		SHR(RDX, 8);
+		cmp_mem8(R_CACHED, RDX, 0, 0);
+		bail_if(CC_NE);
+	}
+}
+
+static void gen_stack_check(void)
+{
+	cmp_mem8(R_CACHED, -1, 1, 0);
+	bail_if(CC_NE);
+}
+
+static void gen_push(int reg)
+{
+	STORE8(reg, R_MEM, R_S, 0x100);
+	ALU_RI(ALU_SUB, R_S, 1);
+	MOVZX_RR(R_S, R_S);
+}
+
+static void gen_pull(int reg)
+{
+	ALU_RI(ALU_ADD, R_S, 1);
+	MOVZX_RR(R_S, R_S);
+	MOVZX_RM(reg, R_MEM, R_S, 0x100);
+}
+
+/* ASL, LSR, ROL or ROR of REG; clobbers edx. */
+static void gen_shift(int op, int reg)
+{
+	switch (op) {
+	case OP_ASL:
+		MOV_RR(R_C, reg);
+		SHR(R_C, 7);
+		SHL(reg, 1);
+		MOVZX_RR(reg, reg);
+		break;
+	case OP_LSR:
+		MOV_RR(R_C, reg);
+		ALU_RI(ALU_AND, R_C, 1);
+		SHR(reg, 1);
+		break;
+	case OP_ROL:
+		MOV_RR(RDX, reg);
+		SHL(reg, 1);
+		ALU_RR(ALU_OR, reg, R_C);
+		MOVZX_RR(reg, reg);
+		MOV_RR(R_C, RDX);
+		SHR(R_C, 7);
+		break;
+	case OP_ROR:
+		MOV_RR(RDX, R_C);
+		SHL(RDX, 7);
+		MOV_RR(R_C, reg);
+		ALU_RI(ALU_AND, R_C, 1);
+		SHR(reg, 1);
+		ALU_RR(ALU_OR, reg, RDX);
+		break;
+	default:
+		break;
+	}
+}
+
+/* Compare REG with the operand in eax. */
+static void gen_compare(int reg)
+{
+	MOV_RR(RDX, reg);
+	ALU_RR(ALU_SUB, RDX, RAX);
+	mov_ri(R_C, 0);
+	SETCC(CC_AE, R_C);
+	MOVZX_RR(RDX, RDX);
+	set_nz(RDX);
+}
+
+/* Binary mode ADC and SBC of the operand in eax. */
+static void gen_adc(void)
+{
+	MOV_RR(RDX, R_A);
+	ALU_RR(ALU_ADD, RDX, RAX);
+	ALU_RR(ALU_ADD, RDX, R_C);
+	MOV_RR(R_C, RDX);
+	SHR(R_C, 8);
+	/* V = !((A ^ data) & 0x80) && ((data ^ tmp) & 0x80) */
+	MOV_RR(R_V, R_A);
+	ALU_RR(ALU_XOR, R_V, RAX);
+	op_rr(0, 0xf7, 2, R_V);		/* not */
+	ALU_RR(ALU_XOR, RAX, RDX);
+	ALU_RR(ALU_AND, R_V, RAX);
+	ALU_RI(ALU_AND, R_V, 0x80);
+	SHR(R_V, 7);
+	MOVZX_RR(R_A, RDX);
+	set_nz(R_A);
+}
+
+static void gen_sbc(void)
+{
+	MOV_RR(RDX, R_A);
+	ALU_RR(ALU_SUB, RDX, RAX);
+	ALU_RR(ALU_ADD, RDX, R_C);
+	ALU_RI(ALU_SUB, RDX, 1);
+	mov_ri(R_C, 0);
+	ALU_RI(ALU_CMP, RDX, 0x100);
+	SETCC(CC_B, R_C);
+	/* V = ((A ^ data) & 0x80) && ((A ^ tmp) & 0x80) */
+	MOV_RR(R_V, R_A);
+	ALU_RR(ALU_XOR, R_V, RAX);
+	MOV_RR(RAX, R_A);
+	ALU_RR(ALU_XOR, RAX, RDX);
+	ALU_RR(ALU_AND, R_V, RAX);
+	ALU_RI(ALU_AND, R_V, 0x80);
+	SHR(R_V, 7);
+	MOVZX_RR(R_A, RDX);
+	set_nz(R_A);
+}
+
+/* Conditional branch CODE at PC; ends the block. */
+static void gen_branch(int code, int pc, int operand, int cycles)
+{
+	static const int flag_reg[4] = { R_N, R_V, R_C, R_Z };
+	int reg = flag_reg[code >> 6];
+	int next = (pc + 2) & 0xffff;
+	int target = (next + (SBYTE) operand) & 0xffff;
+	int cc;
+	UBYTE *taken;
+	if (reg == R_N) {
+		op_rr(0, 0xf7, 0, R_N);	/* test r13d, 0x80 */
+		emit32(0x80);
+	}
+	else
+		op_rr(0, 0x85, reg, reg);
+	/* the flag is set if bit 5 of the opcode is; Z is set when z == 0 */
+	cc = (code & 0x20) ? CC_NE : CC_E;
+	if (reg == R_Z)
+		cc ^= 1;
+	taken = jcc(cc);
+	exit_const(next, cycles, CPU_JIT_DONE);
+	patch32(taken, out);
+	exit_const(target, cycles + 1 + (((target ^ next) & 0xff00) != 0), CPU_JIT_DONE);
+}
+
+/* Compiles the instruction CODE at PC. CYCLES is the static cycle count
+   of the block after it. Returns TRUE if it ends the block. */
+static int gen_insn(int code, int pc, int operand, int cycles)
+{
+	int op = insn_op[code];
+	int mode = insn_mode[code];
+	switch (op) {
+	case OP_LDA:
+	case OP_LDX:
+	case OP_LDY:
+		{
+			int reg = op == OP_LDA ? R_A : op == OP_LDX ? R_X : R_Y;
+			gen_read(mode, operand);
+			MOV_RR(reg, RAX);
+			set_nz(reg);
+		}
+		break;
+	case OP_STA:
+	case OP_STX:
+	case OP_STY:
+		gen_ea(mode, operand);
+		gen_write_check(mode);
+		STORE8(op == OP_STA ? R_A : op == OP_STX ? R_X : R_Y, R_MEM, RCX, 0);
+		break;
+	case OP_AND:
+		gen_read(mode, operand);
+		ALU_RR(ALU_AND, R_A, RAX);
+		set_nz(R_A);
+		break;
+	case OP_ORA:
+		gen_read(mode, operand);
+		ALU_RR(ALU_OR, R_A, RAX);
+		set_nz(R_A);
+		break;
+	case OP_EOR:
+		gen_read(mode, operand);
+		ALU_RR(ALU_XOR, R_A, RAX);
+		set_nz(R_A);
+		break;
+	case OP_ADC:
+		gen_read(mode, operand);
+		gen_adc();
+		break;
+	case OP_SBC:
+		gen_read(mode, operand);
+		gen_sbc();
+		break;
+	case OP_CMP:
+		gen_read(mode, operand);
+		gen_compare(R_A);
+		break;
+	case OP_CPX:
+		gen_read(mode, operand);
+		gen_compare(R_X);
+		break;
+	case OP_CPY:
+		gen_read(mode, operand);
+		gen_compare(R_Y);
+		break;
+	case OP_BIT:
+		gen_read(mode, operand);
+		MOV_RR(R_N, RAX);
+		MOV_RR(R_V, RAX);
+		ALU_RI(ALU_AND, R_V, 0x40);
+		MOV_RR(R_Z, RAX);
+		ALU_RR(ALU_AND, R_Z, R_A);
+		break;
+	case OP_INC:
+	case OP_DEC:
+	case OP_ASL:
+	case OP_LSR:
+	case OP_ROL:
+	case OP_ROR:
+		if (mode == M_IMP) {
+			gen_shift(op, R_A);
+			set_nz(R_A);
+			break;
+		}
+		gen_ea(mode, operand);
+		gen_write_check(mode);
+		MOVZX_RM(RAX, R_MEM, RCX, 0);
+		if (op == OP_INC || op == OP_DEC) {
+			if (op == OP_INC)
+				ALU_RI(ALU_ADD, RAX, 1);
+			else
+				ALU_RI(ALU_SUB, RAX, 1);
+			MOVZX_RR(RAX, RAX);
+		}
+		else
+			gen_shift(op, RAX);
+		STORE8(RAX, R_MEM, RCX, 0);
+		set_nz(RAX);
+		break;
+	case OP_TAX:
+		MOV_RR(R_X, R_A);
+		set_nz(R_X);
+		break;
+	case OP_TAY:
+		MOV_RR(R_Y, R_A);
+		set_nz(R_Y);
+		break;
+	case OP_TXA:
+		MOV_RR(R_A, R_X);
+		set_nz(R_A);
+		break;
+	case OP_TYA:
+		MOV_RR(R_A, R_Y);
+		set_nz(R_A);
+		break;
+	case OP_TSX:
+		MOV_RR(R_X, R_S);
+		set_nz(R_X);
+		break;
+	case OP_TXS:
+		MOV_RR(R_S, R_X);
+		break;
+	case OP_INX:
+	case OP_INY:
+	case OP_DEX:
+	case OP_DEY:
+		{
+			int reg = (op == OP_INX || op == OP_DEX) ? R_X : R_Y;
+			if (op == OP_INX || op == OP_INY)
+				ALU_RI(ALU_ADD, reg, 1);
+			else
+				ALU_RI(ALU_SUB, reg, 1);
+			MOVZX_RR(reg, reg);
+			set_nz(reg);
+		}
+		break;
+	case OP_CLC:
+		mov_ri(R_C, 0);
+		break;
+	case OP_SEC:
+		mov_ri(R_C, 1);
+		break;
+	case OP_CLV:
+		mov_ri(R_V, 0);
+		break;
+	case OP_NOP:
+		break;
+	case OP_PHA:
+		gen_stack_check();
+		gen_push(R_A);
+		break;
+	case OP_PLA:
+		gen_pull(R_A);
+		set_nz(R_A);
+		break;
+	case OP_JMP:
+		exit_const(operand, cycles, CPU_JIT_DONE);
+		return TRUE;
+	case OP_JMPI:
+		/* the original 6502 doesn't cross the page fetching the high byte */
+		MOVZX_RM(RCX, R_MEM, -1, operand);
+		MOVZX_RM(RAX, R_MEM, -1, (operand & 0xff) == 0xff ? operand - 0xff : operand + 1);
+		SHL(RAX, 8);
+		ALU_RR(ALU_OR, RCX, RAX);
+		exit_dynamic(cycles);
+		return TRUE;
+	case OP_JSR:
+		gen_stack_check();
+		mov_ri(RAX, ((pc + 2) >> 8) & 0xff);
+		gen_push(RAX);
+		mov_ri(RAX, (pc + 2) & 0xff);
+		gen_push(RAX);
+		exit_const(operand, cycles, CPU_JIT_DONE);
+		return TRUE;
+	case OP_RTS:
+		gen_pull(RAX);
+		gen_pull(RCX);
+		SHL(RCX, 8);
+		ALU_RR(ALU_OR, RCX, RAX);
+		ALU_RI(ALU_ADD, RCX, 1);
+		ALU_RI(ALU_AND, RCX, 0xffff);
+		exit_dynamic(cycles);
+		return TRUE;
+	case OP_BRANCH:
+		gen_branch(code, pc, operand, cycles);
+		return TRUE;
+	default:
+		break;
+	}
+	return FALSE;
+}
+
+static void CodeFailed(void)
+{
+	Log_print("Cannot allocate executable memory, 6502 JIT disabled");
+	code_failed = TRUE;
+	CPU_JIT_enabled = FALSE;
+	if (code_buf != NULL) {
+		/* drop the predecoded instructions that refer to compiled blocks */
+		CPU_PredecodeFlush();
+		munmap(code_buf, CODE_SIZE);
+		code_buf = NULL;
+	}
+}
+
+/* The code buffer is never writable and executable at the same time, for
+   systems that enforce W^X. Only the pages a block is compiled into are
+   made writable, and only while compiling it. */
+static int ProtectCode(UBYTE *start, int writable)
+{
+	size_t offset = (size_t) (start - code_buf) & ~(size_t) (CODE_PAGE - 1);
+	size_t end = (size_t) (start - code_buf) + MAX_BLOCK_CODE;
+	if (end > CODE_SIZE)
+		end = CODE_SIZE;
+	return mprotect(code_buf + offset, end - offset,
+	                writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC) == 0;
+}
+
+static int InitCode(void)
+{
+	int i;
+	void *p;
+	if (code_failed)
+		return FALSE;
+	p = mmap(NULL, CODE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (p == MAP_FAILED) {
+		CodeFailed();
+		return FALSE;
+	}
+	code_buf = code_ptr = (UBYTE *) p;
+	for (i = 0; i < N_ITEMS(insn_list); i++) {
+		insn_op[insn_list[i].code] = insn_list[i].op;
+		insn_mode[insn_list[i].code] = insn_list[i].mode;
+	}
+	return TRUE;
+}
+
+static int InsnLength(int mode)
+{
+	switch (mode) {
+	case M_IMP:
+		return 1;
+	case M_ABS:
+	case M_ABSX:
+	case M_ABSY:
+		return 3;
+	default:
+		return 2;
+	}
+}
+
+CPU_JIT_code_t CPU_JIT_Compile(UWORD pc, const int *cycles, int *max_start)
+{
+	UBYTE *entry;
+	CPU_JIT_code_t block = NULL;
+	UBYTE *stub = NULL;
+	int compiled = TRUE;
+	int n_insns = 0;
+	int static_cycles = 0;
+	int worst = 0;
+	int i;
+
+	if (code_buf == NULL && !InitCode())
+		return NULL;
+	if (code_buf + CODE_SIZE - code_ptr < MAX_BLOCK_CODE) {
+		/* start over; blocks compiled so far are referenced only by
+		   the predecoded instructions */
+		code_ptr = code_buf;
+		CPU_PredecodeFlush();
+	}
+	if (!ProtectCode(code_ptr, TRUE)) {
+		CodeFailed();
+		return NULL;
+	}
+	out = code_ptr;
+	n_bails = 0;
+	epilogue = out;
+	gen_epilogue();
+	entry = out;
+	gen_prologue();
+	*max_start = 0;
+
+	for (;;) {
+		int code;
+		int operand;
+		int op;
+		int mode;
+		if ((pc & 0xff) > 0xfd || n_insns == MAX_BLOCK_INSNS) {
+			exit_const(pc, static_cycles, CPU_JIT_DONE);
+			break;
+		}
+		code = MEMORY_dGetByte(pc);
+		operand = MEMORY_dGetWord(pc + 1);
+		op = insn_op[code];
+		mode = insn_mode[code];
+		/* absolute accesses to I/O are left to the interpreter right away */
+		if (op == OP_NONE
+		 || (mode == M_ABS && op != OP_JMP && op != OP_JMPI && op != OP_JSR
+		     && MEMORY_attrib[operand] == MEMORY_HARDWARE)) {
+			if (n_insns == 0) {
+				compiled = FALSE;
+				break;
+			}
+			exit_const(pc, static_cycles, CPU_JIT_DONE);
+			break;
+		}
+		cur_insn = n_insns;
+		insn_pc[n_insns] = pc;
+		insn_cycles[n_insns] = static_cycles;
+		*max_start = worst;
+		n_insns++;
+		static_cycles += cycles[code];
+		worst += cycles[code];
+		if (op == OP_BRANCH)
+			worst += 2;
+		else if ((mode == M_ABSX || mode == M_ABSY || mode == M_INDY)
+		      && op != OP_STA && op != OP_INC && op != OP_DEC
+		      && op != OP_ASL && op != OP_LSR && op != OP_ROL && op != OP_ROR)
+			worst++;
+		if (gen_insn(code, pc, operand, static_cycles))
+			break;
+		pc += InsnLength(mode);
+	}
+
+	/* bail-out exits, one per instruction that needs it */
+	for (i = 0; i < n_bails; i++) {
+		int n = bail_insn[i];
+		if (i == 0 || bail_insn[i - 1] != n) {
+			stub = out;
+			exit_const(insn_pc[n], insn_cycles[n], CPU_JIT_BAIL);
+		}
+		patch32(bail_patch[i], stub);
+	}
+
+	if (!ProtectCode(code_ptr, FALSE)) {
+		CodeFailed();
+		return NULL;
+	}
+	if (compiled) {
+		code_ptr = out;
+		/* ISO C has no cast from an object pointer to a function pointer */
+		memcpy(&block, &entry, sizeof(block));
+	}
+	return block;
+}
+
+int CPU_JIT_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		if (strcmp(argv[i], "-jit") == 0)
+			CPU_JIT_enabled = TRUE;
+		else if (strcmp(argv[i], "-nojit") == 0)
+			CPU_JIT_enabled = FALSE;
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-jit             Run 6502 code compiled to x86-64 code");
+				Log_print("\t-nojit           Interpret all 6502 code");
+			}
+			argv[j++] = argv[i];
+		}
+	}
+	*argc = j;
+
+	return TRUE;
+}
@@ -0,0 +1,43 @@
+#ifndef CPU_JIT_H_
+#define CPU_JIT_H_
+
+#include "config.h"
+#include "atari.h"
+
+/* 6502 registers and memory seen by compiled code. The flags are kept
+   the way cpu.c keeps them: bit 7 of n is N, z == 0 means Z, c is 0 or 1,
+   v != 0 means V. */
+typedef struct {
+	UBYTE a;
+	UBYTE x;
+	UBYTE y;
+	UBYTE s;
+	UBYTE n;
+	UBYTE z;
+	UBYTE c;
+	UBYTE v;
+	UWORD pc;
+	int xpos;					/* ANTIC_xpos */
+	UBYTE *mem;					/* MEMORY_mem */
+	const UBYTE *attrib;		/* MEMORY_attrib */
+	const UBYTE *cached;		/* CPU_predecode_cached */
+} CPU_JIT_regs_t;
+
+/* Return values of a compiled block. */
+#define CPU_JIT_DONE 0			/* the block ran to its end */
+#define CPU_JIT_BAIL 1			/* stopped before an instruction the interpreter must do */
+
+typedef int (*CPU_JIT_code_t)(CPU_JIT_regs_t *regs);
+
+/* TRUE if CPU_GO runs compiled blocks. */
+extern int CPU_JIT_enabled;
+
+int CPU_JIT_Initialise(int *argc, char *argv[]);
+
+/* Compiles the basic block at PC, taking instruction timings from CYCLES.
+   Stores in *MAX_START the most cycles the block may spend before starting
+   its last instruction. Returns NULL if the first instruction can't be
+   compiled. May call CPU_PredecodeFlush when the code buffer is full. */
+CPU_JIT_code_t CPU_JIT_Compile(UWORD pc, const int *cycles, int *max_start);
+
+#endif /* CPU_JIT_H_ */
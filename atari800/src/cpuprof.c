@@ -0,0 +1,534 @@
+/*
+ * cpuprof.c - 6502 call graph profiler
+ *
+ * Copyright (c) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#define _POSIX_C_SOURCE 200112L /* for snprintf */
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef MONITOR_PROFILE
+
+#include "antic.h"
+#include "atari.h"
+#include "cpuprof.h"
+#include "log.h"
+#include "util.h"
+
+/*
+   The profile is a calling context tree: a node for every chain of calls
+   seen, starting at the root of a region (main code, VBI, DLI or IRQ).
+   Each interrupt goes to a child of the root of its region, each JSR
+   to a child of the current node. The cycles are kept per node and
+   instruction address.
+
+   Calls are matched with returns by the stack pointer: an RTS or RTI
+   leaves every call whose return address it took off the stack.
+   Code that drops return addresses with PLA or TXS stays in the called
+   routine until a later return unwinds past it; an RTS to an address
+   pushed by the code itself (a jump table) is a jump within the routine.
+*/
+
+#define ROOT_FN(region) (0x10000 + (region))
+
+typedef struct {
+	int parent;					/* -1 for the roots */
+	int fn;						/* entry address or ROOT_FN */
+	UWORD site;					/* address of the JSR, 0 for interrupts */
+	UBYTE region;
+	unsigned long calls;
+	unsigned long cycles;		/* not including called routines */
+	int next;					/* in the hash chain */
+} node_t;
+
+typedef struct {
+	int node;
+	UWORD pc;
+	unsigned long cycles;
+	int next;
+} line_t;
+
+typedef struct {
+	int caller;					/* node to return to */
+	UBYTE s;					/* stack pointer after the return */
+} frame_t;
+
+#define NODE_BUCKETS 4096
+#define LINE_BUCKETS 65536
+/* beyond this, calls are charged to the caller */
+#define MAX_NODES 1000000
+#define MAX_LINES 4000000
+/* the 6502 stack holds at most 128 return addresses */
+#define MAX_DEPTH 256
+
+int CPUPROF_enabled = FALSE;
+
+static node_t *nodes = NULL;
+static int n_nodes;
+static int max_nodes;
+static int node_bucket[NODE_BUCKETS];
+
+static line_t *lines = NULL;
+static int n_lines;
+static int max_lines;
+static int line_bucket[LINE_BUCKETS];
+
+static frame_t stack[MAX_DEPTH];
+static int depth;
+static int cur;
+static int root[CPUPROF_REGIONS];
+static unsigned int last_clock;
+
+static char callgrind_filename[FILENAME_MAX];
+static char folded_filename[FILENAME_MAX];
+
+static const char * const region_names[CPUPROF_REGIONS] = { "main", "VBI", "DLI", "IRQ" };
+
+static int GetNode(int parent, int fn, UWORD site, int region)
+{
+	unsigned int h = ((unsigned int) parent * 31 + (unsigned int) fn * 7 + site) % NODE_BUCKETS;
+	int i;
+	for (i = node_bucket[h]; i >= 0; i = nodes[i].next) {
+		if (nodes[i].parent == parent && nodes[i].fn == fn && nodes[i].site == site)
+			return i;
+	}
+	if (n_nodes >= MAX_NODES)
+		return parent;
+	if (n_nodes == max_nodes) {
+		max_nodes = max_nodes ? 2 * max_nodes : 1024;
+		nodes = (node_t *) Util_realloc(nodes, max_nodes * sizeof(node_t));
+	}
+	i = n_nodes++;
+	nodes[i].parent = parent;
+	nodes[i].fn = fn;
+	nodes[i].site = site;
+	nodes[i].region = (UBYTE) region;
+	nodes[i].calls = 0;
+	nodes[i].cycles = 0;
+	nodes[i].next = node_bucket[h];
+	node_bucket[h] = i;
+	return i;
+}
+
+static line_t *GetLine(int node, UWORD pc)
+{
+	unsigned int h = ((unsigned int) node * 257 + pc) % LINE_BUCKETS;
+	int i;
+	for (i = line_bucket[h]; i >= 0; i = lines[i].next) {
+		if (lines[i].node == node && lines[i].pc == pc)
+			return &lines[i];
+	}
+	if (n_lines >= MAX_LINES)
+		return NULL;
+	if (n_lines == max_lines) {
+		max_lines = max_lines ? 2 * max_lines : 4096;
+		lines = (line_t *) Util_realloc(lines, max_lines * sizeof(line_t));
+	}
+	i = n_lines++;
+	lines[i].node = node;
+	lines[i].pc = pc;
+	lines[i].cycles = 0;
+	lines[i].next = line_bucket[h];
+	line_bucket[h] = i;
+	return &lines[i];
+}
+
+void CPUPROF_Reset(void)
+{
+	int r;
+	n_nodes = 0;
+	n_lines = 0;
+	memset(node_bucket, 0xff, sizeof(node_bucket));
+	memset(line_bucket, 0xff, sizeof(line_bucket));
+	for (r = 0; r < CPUPROF_REGIONS; r++)
+		root[r] = GetNode(-1, ROOT_FN(r), 0, r);
+	depth = 0;
+	cur = root[CPUPROF_MAIN];
+	last_clock = ANTIC_CPU_CLOCK;
+}
+
+void CPUPROF_Start(void)
+{
+	if (nodes == NULL)
+		CPUPROF_Reset();
+	/* calls made while stopped weren't seen */
+	depth = 0;
+	cur = root[CPUPROF_MAIN];
+	last_clock = ANTIC_CPU_CLOCK;
+	CPUPROF_enabled = TRUE;
+}
+
+void CPUPROF_Stop(void)
+{
+	CPUPROF_enabled = FALSE;
+}
+
+void CPUPROF_Instruction(UWORD pc)
+{
+	unsigned int now = ANTIC_CPU_CLOCK;
+	int cycles = (int) (now - last_clock);
+	line_t *line;
+	last_clock = now;
+	if (cycles <= 0)
+		return;
+	nodes[cur].cycles += cycles;
+	line = GetLine(cur, pc);
+	if (line != NULL)
+		line->cycles += cycles;
+}
+
+static void Enter(int node, UBYTE s)
+{
+	if (depth < MAX_DEPTH) {
+		stack[depth].caller = cur;
+		stack[depth].s = s;
+		depth++;
+		cur = node;
+	}
+	nodes[node].calls++;
+}
+
+void CPUPROF_Call(UWORD site, UWORD target, UBYTE s)
+{
+	/* the JSR itself belongs to the caller */
+	CPUPROF_Instruction(site);
+	Enter(GetNode(cur, target, site, nodes[cur].region), s);
+}
+
+void CPUPROF_Interrupt(int region, UWORD target, UBYTE s)
+{
+	nodes[root[region]].calls++;
+	Enter(GetNode(root[region], target, 0, region), s);
+}
+
+void CPUPROF_Unwind(UBYTE s)
+{
+	while (depth > 0 && stack[depth - 1].s <= s)
+		cur = stack[--depth].caller;
+}
+
+void CPUPROF_Return(UWORD pc, UBYTE s)
+{
+	CPUPROF_Instruction(pc);
+	CPUPROF_Unwind(s);
+}
+
+static const char *FnName(int fn)
+{
+	static char buffer[8];
+	if (fn >= ROOT_FN(0))
+		return region_names[fn - ROOT_FN(0)];
+	snprintf(buffer, sizeof(buffer), "$%04X", fn);
+	return buffer;
+}
+
+/* Cycles of every node including its callees. Children are created after
+   their parents, so one pass from the end does it. */
+static unsigned long *InclusiveCycles(void)
+{
+	unsigned long *incl = (unsigned long *) Util_malloc((n_nodes + 1) * sizeof(unsigned long));
+	int i;
+	for (i = 0; i < n_nodes; i++)
+		incl[i] = nodes[i].cycles;
+	for (i = n_nodes - 1; i >= 0; i--) {
+		if (nodes[i].parent >= 0)
+			incl[nodes[i].parent] += incl[i];
+	}
+	return incl;
+}
+
+/* TRUE if FN is also an ancestor of node I, so that its cycles are already
+   included in an outer call. */
+static int Recursive(int i)
+{
+	int p;
+	for (p = nodes[i].parent; p >= 0; p = nodes[p].parent) {
+		if (nodes[p].fn == nodes[i].fn)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+typedef struct {
+	int region;
+	int fn;
+	unsigned long calls;
+	unsigned long self;
+	unsigned long total;
+} fn_stat_t;
+
+static int CompareFnKey(const void *a, const void *b)
+{
+	const fn_stat_t *x = (const fn_stat_t *) a;
+	const fn_stat_t *y = (const fn_stat_t *) b;
+	if (x->region != y->region)
+		return x->region - y->region;
+	return x->fn - y->fn;
+}
+
+static int CompareFnSelf(const void *a, const void *b)
+{
+	const fn_stat_t *x = (const fn_stat_t *) a;
+	const fn_stat_t *y = (const fn_stat_t *) b;
+	if (x->self != y->self)
+		return x->self < y->self ? 1 : -1;
+	return CompareFnKey(a, b);
+}
+
+void CPUPROF_PrintTop(FILE *fp, int count)
+{
+	fn_stat_t *stats;
+	unsigned long *incl;
+	unsigned long all = 0;
+	unsigned long region_total[CPUPROF_REGIONS];
+	int n = 0;
+	int i;
+	if (nodes == NULL || n_nodes == 0) {
+		fprintf(fp, "No profile collected\n");
+		return;
+	}
+	incl = InclusiveCycles();
+	stats = (fn_stat_t *) Util_malloc(n_nodes * sizeof(fn_stat_t));
+	for (i = 0; i < n_nodes; i++) {
+		stats[i].region = nodes[i].region;
+		stats[i].fn = nodes[i].fn;
+		stats[i].calls = nodes[i].calls;
+		stats[i].self = nodes[i].cycles;
+		stats[i].total = Recursive(i) ? 0 : incl[i];
+		all += nodes[i].cycles;
+	}
+	for (i = 0; i < CPUPROF_REGIONS; i++)
+		region_total[i] = incl[root[i]];
+	free(incl);
+	qsort(stats, n_nodes, sizeof(fn_stat_t), CompareFnKey);
+	for (i = 0; i < n_nodes; i++) {
+		if (n > 0 && CompareFnKey(&stats[n - 1], &stats[i]) == 0) {
+			stats[n - 1].calls += stats[i].calls;
+			stats[n - 1].self += stats[i].self;
+			stats[n - 1].total += stats[i].total;
+		}
+		else
+			stats[n++] = stats[i];
+	}
+	qsort(stats, n, sizeof(fn_stat_t), CompareFnSelf);
+	if (all == 0)
+		all = 1;
+	fprintf(fp, "Cycles by region:");
+	for (i = 0; i < CPUPROF_REGIONS; i++)
+		fprintf(fp, " %s %lu (%.2f%%)", region_names[i], region_total[i], 100.0 * region_total[i] / all);
+	fprintf(fp, "\nRegion Routine        Self cycles         Total cycles      Calls\n");
+	for (i = 0; i < n && i < count && stats[i].self > 0; i++) {
+		fprintf(fp, "%-6s %-7s %11lu(%5.2f%%) %11lu(%6.2f%%) %10lu\n",
+			region_names[stats[i].region], FnName(stats[i].fn),
+			stats[i].self, 100.0 * stats[i].self / all,
+			stats[i].total, 100.0 * stats[i].total / all,
+			stats[i].calls);
+	}
+	free(stats);
+}
+
+/* A cost line (callee < 0) or a call of CALLEE at PC, in function FN. */
+typedef struct {
+	int region;
+	int fn;
+	int callee;
+	UWORD pc;
+	unsigned long calls;
+	unsigned long cycles;
+} cg_rec_t;
+
+static int CompareCallgrind(const void *a, const void *b)
+{
+	const cg_rec_t *x = (const cg_rec_t *) a;
+	const cg_rec_t *y = (const cg_rec_t *) b;
+	if (x->region != y->region)
+		return x->region - y->region;
+	if (x->fn != y->fn)
+		return x->fn - y->fn;
+	if (x->callee != y->callee)
+		return x->callee - y->callee;
+	return x->pc - y->pc;
+}
+
+int CPUPROF_WriteCallgrind(const char *filename)
+{
+	FILE *fp;
+	cg_rec_t *recs;
+	unsigned long *incl;
+	unsigned long all = 0;
+	int n = 0;
+	int m;
+	int i;
+	if (nodes == NULL)
+		CPUPROF_Reset();
+	fp = fopen(filename, "w");
+	if (fp == NULL) {
+		Log_print("Cannot write %s", filename);
+		return FALSE;
+	}
+	incl = InclusiveCycles();
+	recs = (cg_rec_t *) Util_malloc((n_lines + n_nodes + 1) * sizeof(cg_rec_t));
+	for (i = 0; i < n_lines; i++) {
+		const node_t *node = &nodes[lines[i].node];
+		recs[n].region = node->region;
+		recs[n].fn = node->fn;
+		recs[n].callee = -1;
+		recs[n].pc = lines[i].pc;
+		recs[n].calls = 0;
+		recs[n].cycles = lines[i].cycles;
+		all += lines[i].cycles;
+		n++;
+	}
+	for (i = 0; i < n_nodes; i++) {
+		const node_t *node = &nodes[i];
+		if (node->parent < 0 || node->calls == 0)
+			continue;
+		recs[n].region = node->region;
+		recs[n].fn = nodes[node->parent].fn;
+		recs[n].callee = node->fn;
+		recs[n].pc = node->site;
+		recs[n].calls = node->calls;
+		recs[n].cycles = Recursive(i) ? 0 : incl[i];
+		n++;
+	}
+	free(incl);
+	qsort(recs, n, sizeof(cg_rec_t), CompareCallgrind);
+	/* merge the same lines and calls of different call chains */
+	m = 0;
+	for (i = 0; i < n; i++) {
+		if (m > 0 && CompareCallgrind(&recs[m - 1], &recs[i]) == 0) {
+			recs[m - 1].calls += recs[i].calls;
+			recs[m - 1].cycles += recs[i].cycles;
+		}
+		else
+			recs[m++] = recs[i];
+	}
+
+	fprintf(fp, "# callgrind format\nversion: 1\ncreator: " Atari800_TITLE "\n");
+	fprintf(fp, "positions: instr\nevents: Cycles\nsummary: %lu\n", all);
+	for (i = 0; i < m; i++) {
+		if (i == 0 || recs[i].region != recs[i - 1].region)
+			fprintf(fp, "\nob=%s\n", region_names[recs[i].region]);
+		if (i == 0 || recs[i].region != recs[i - 1].region || recs[i].fn != recs[i - 1].fn)
+			fprintf(fp, "fn=%s\n", FnName(recs[i].fn));
+		if (recs[i].callee < 0)
+			fprintf(fp, "0x%04X %lu\n", recs[i].pc, recs[i].cycles);
+		else {
+			fprintf(fp, "cfn=%s\n", FnName(recs[i].callee));
+			fprintf(fp, "calls=%lu 0x%04X\n", recs[i].calls, recs[i].callee);
+			fprintf(fp, "0x%04X %lu\n", recs[i].pc, recs[i].cycles);
+		}
+	}
+	free(recs);
+	fclose(fp);
+	return TRUE;
+}
+
+int CPUPROF_WriteFolded(const char *filename)
+{
+	FILE *fp;
+	int chain[MAX_DEPTH + 2];
+	int i;
+	if (nodes == NULL)
+		CPUPROF_Reset();
+	fp = fopen(filename, "w");
+	if (fp == NULL) {
+		Log_print("Cannot write %s", filename);
+		return FALSE;
+	}
+	for (i = 0; i < n_nodes; i++) {
+		int n = 0;
+		int p;
+		if (nodes[i].cycles == 0)
+			continue;
+		for (p = i; p >= 0 && n < MAX_DEPTH + 2; p = nodes[p].parent)
+			chain[n++] = p;
+		while (--n >= 0)
+			fprintf(fp, n > 0 ? "%s;" : "%s", FnName(nodes[chain[n]].fn));
+		fprintf(fp, " %lu\n", nodes[i].cycles);
+	}
+	fclose(fp);
+	return TRUE;
+}
+
+int CPUPROF_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-callprof") == 0) {
+			if (i_a)
+				Util_strlcpy(callgrind_filename, argv[++i], sizeof(callgrind_filename));
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-callprof-folded") == 0) {
+			if (i_a)
+				Util_strlcpy(folded_filename, argv[++i], sizeof(folded_filename));
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-callprof <file>         Profile 6502 code, write callgrind file on exit");
+				Log_print("\t-callprof-folded <file>  Profile 6502 code, write folded call chains on exit");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	if (callgrind_filename[0] != '\0' || folded_filename[0] != '\0')
+		CPUPROF_Start();
+	return TRUE;
+}
+
+void CPUPROF_Exit(void)
+{
+	if (callgrind_filename[0] != '\0')
+		CPUPROF_WriteCallgrind(callgrind_filename);
+	if (folded_filename[0] != '\0')
+		CPUPROF_WriteFolded(folded_filename);
+	callgrind_filename[0] = '\0';
+	folded_filename[0] = '\0';
+	CPUPROF_enabled = FALSE;
+	free(nodes);
+	free(lines);
+	nodes = NULL;
+	lines = NULL;
+	max_nodes = 0;
+	max_lines = 0;
+}
+
+#endif /* MONITOR_PROFILE */
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,50 @@
+#ifndef CPUPROF_H_
+#define CPUPROF_H_
+
+#include "config.h"
+#include <stdio.h>
+#include "atari.h"
+
+#ifdef MONITOR_PROFILE
+
+/* Call graph profiler. Every machine cycle - the instruction's own cycles,
+   cycles stolen by ANTIC and WSYNC waits - is charged to the instruction
+   that was executing and to the chain of JSRs and interrupts leading to it.
+   Interrupts start a chain of their own, separate for each region. */
+#define CPUPROF_MAIN 0
+#define CPUPROF_VBI  1
+#define CPUPROF_DLI  2
+#define CPUPROF_IRQ  3
+#define CPUPROF_REGIONS 4
+
+extern int CPUPROF_enabled;
+
+int CPUPROF_Initialise(int *argc, char *argv[]);
+void CPUPROF_Exit(void);
+
+/* Starts profiling, keeping what was collected so far. */
+void CPUPROF_Start(void);
+void CPUPROF_Stop(void);
+void CPUPROF_Reset(void);
+
+/* Called by cpu.c while CPUPROF_enabled. */
+void CPUPROF_Instruction(UWORD pc);
+/* A JSR at SITE to TARGET; S is the stack pointer before the JSR. */
+void CPUPROF_Call(UWORD site, UWORD target, UBYTE s);
+/* An RTS or RTI at PC, S is the stack pointer after it. */
+void CPUPROF_Return(UWORD pc, UBYTE s);
+/* An interrupt to TARGET; S is the stack pointer before the interrupt. */
+void CPUPROF_Interrupt(int region, UWORD target, UBYTE s);
+/* Forgets calls whose return address is below S on the stack. */
+void CPUPROF_Unwind(UBYTE s);
+
+/* Functions using most cycles. */
+void CPUPROF_PrintTop(FILE *fp, int count);
+/* Callgrind format, for KCachegrind and other callgrind readers. */
+int CPUPROF_WriteCallgrind(const char *filename);
+/* One line per call chain, "VBI;E45F;F0A3 123", for flame graph tools. */
+int CPUPROF_WriteFolded(const char *filename);
+
+#endif /* MONITOR_PROFILE */
+
+#endif /* CPUPROF_H_ */
@@ -0,0 +1,243 @@
+/*
+ * cputrace.c - binary 6502 execution trace
+ *
+ * Copyright (c) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef MONITOR_TRACE
+
+#include "atari.h"
+#include "cputrace.h"
+#include "log.h"
+#include "util.h"
+
+/* a frame has at most 35568 cycles, so fewer than 18000 instructions */
+#define DEFAULT_SIZE 0x100000
+#define MIN_SIZE 0x8000
+/* records converted per fwrite */
+#define CHUNK 4096
+
+int CPUTRACE_enabled = FALSE;
+CPUTRACE_record_t *CPUTRACE_ring = NULL;
+unsigned int CPUTRACE_mask;
+unsigned int CPUTRACE_head;
+
+static unsigned int size = DEFAULT_SIZE;
+static FILE *stream = NULL;
+static unsigned int stream_tail;	/* next record to write */
+static unsigned long stream_records;
+static unsigned long stream_lost;
+static char stream_filename[FILENAME_MAX];
+
+static void Allocate(void)
+{
+	if (CPUTRACE_ring == NULL) {
+		CPUTRACE_ring = (CPUTRACE_record_t *) Util_malloc(size * sizeof(CPUTRACE_record_t));
+		CPUTRACE_mask = size - 1;
+		CPUTRACE_head = 0;
+	}
+}
+
+static FILE *OpenFile(const char *filename)
+{
+	static const UBYTE header[CPUTRACE_HEADER_SIZE] = {
+		'A', '8', 'B', 'T', 'R', 'A', 'C', 'E',
+		CPUTRACE_VERSION, 0, CPUTRACE_RECORD_SIZE, 0, 0, 0, 0, 0
+	};
+	FILE *fp = fopen(filename, "wb");
+	if (fp == NULL) {
+		Log_print("Cannot write %s", filename);
+		return NULL;
+	}
+	fwrite(header, 1, sizeof(header), fp);
+	return fp;
+}
+
+/* Writes COUNT records starting at ring position FIRST. */
+static void WriteRecords(FILE *fp, unsigned int first, unsigned int count)
+{
+	UBYTE buffer[CHUNK * CPUTRACE_RECORD_SIZE];
+	while (count > 0) {
+		unsigned int n = count < CHUNK ? count : CHUNK;
+		unsigned int i;
+		UBYTE *p = buffer;
+		for (i = 0; i < n; i++) {
+			const CPUTRACE_record_t *r = &CPUTRACE_ring[(first + i) & CPUTRACE_mask];
+			p[0] = (UBYTE) r->pc;
+			p[1] = (UBYTE) (r->pc >> 8);
+			p[2] = (UBYTE) r->ypos;
+			p[3] = (UBYTE) (r->ypos >> 8);
+			p[4] = r->xpos;
+			p[5] = r->a;
+			p[6] = r->x;
+			p[7] = r->y;
+			p[8] = r->s;
+			p[9] = r->p;
+			memcpy(p + 10, r->code, 3);
+			memcpy(p + 13, r->clock, 3);
+			p += CPUTRACE_RECORD_SIZE;
+		}
+		fwrite(buffer, CPUTRACE_RECORD_SIZE, n, fp);
+		first += n;
+		count -= n;
+	}
+}
+
+void CPUTRACE_Start(void)
+{
+	Allocate();
+	CPUTRACE_enabled = TRUE;
+}
+
+void CPUTRACE_Stop(void)
+{
+	CPUTRACE_Frame();
+	CPUTRACE_enabled = FALSE;
+}
+
+int CPUTRACE_Save(const char *filename)
+{
+	FILE *fp;
+	unsigned int count;
+	if (CPUTRACE_ring == NULL) {
+		Log_print("No trace recorded");
+		return FALSE;
+	}
+	fp = OpenFile(filename);
+	if (fp == NULL)
+		return FALSE;
+	count = CPUTRACE_head <= CPUTRACE_mask ? CPUTRACE_head : CPUTRACE_mask + 1;
+	WriteRecords(fp, CPUTRACE_head - count, count);
+	fclose(fp);
+	return TRUE;
+}
+
+int CPUTRACE_Stream(const char *filename)
+{
+	if (stream != NULL) {
+		CPUTRACE_Frame();
+		fclose(stream);
+		stream = NULL;
+		if (stream_lost > 0)
+			Log_print("Trace %s: %lu records written, %lu lost", stream_filename, stream_records, stream_lost);
+	}
+	if (filename == NULL)
+		return TRUE;
+	stream = OpenFile(filename);
+	if (stream == NULL)
+		return FALSE;
+	Util_strlcpy(stream_filename, filename, sizeof(stream_filename));
+	CPUTRACE_Start();
+	stream_tail = CPUTRACE_head;
+	stream_records = 0;
+	stream_lost = 0;
+	return TRUE;
+}
+
+void CPUTRACE_Frame(void)
+{
+	unsigned int count;
+	if (stream == NULL)
+		return;
+	count = CPUTRACE_head - stream_tail;
+	if (count > CPUTRACE_mask + 1) {
+		/* the ring has been overwritten since the last frame */
+		stream_lost += count - (CPUTRACE_mask + 1);
+		stream_tail = CPUTRACE_head - (CPUTRACE_mask + 1);
+		count = CPUTRACE_mask + 1;
+	}
+	WriteRecords(stream, stream_tail, count);
+	stream_tail += count;
+	stream_records += count;
+}
+
+void CPUTRACE_PrintStatus(void)
+{
+	printf("Binary trace %s, %u records in a ring of %u\n", CPUTRACE_enabled ? "on" : "off",
+		CPUTRACE_ring == NULL ? 0 : CPUTRACE_head <= CPUTRACE_mask ? CPUTRACE_head : CPUTRACE_mask + 1,
+		size);
+	if (stream != NULL)
+		printf("Writing to %s: %lu records written, %lu lost\n", stream_filename, stream_records, stream_lost);
+}
+
+int CPUTRACE_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	const char *filename = NULL;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-btrace") == 0) {
+			if (i_a)
+				filename = argv[++i];
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-btrace-size") == 0) {
+			if (i_a) {
+				int n = Util_sscandec(argv[++i]);
+				if (n < MIN_SIZE) {
+					Log_print("Invalid trace size, must be at least %d", MIN_SIZE);
+					return FALSE;
+				}
+				/* a power of two */
+				for (size = MIN_SIZE; size < (unsigned int) n; size <<= 1);
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-btrace <file>       Write binary trace of executed 6502 code");
+				Log_print("\t-btrace-size <n>     Keep last <n> instructions in trace buffer");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	if (filename != NULL)
+		return CPUTRACE_Stream(filename);
+	return TRUE;
+}
+
+void CPUTRACE_Exit(void)
+{
+	CPUTRACE_Stream(NULL);
+	CPUTRACE_enabled = FALSE;
+	free(CPUTRACE_ring);
+	CPUTRACE_ring = NULL;
+}
+
+#endif /* MONITOR_TRACE */
+
+/*
+vim:ts=4:sw=4:
+*/
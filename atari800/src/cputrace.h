@@ -0,0 +1,59 @@
+#ifndef CPUTRACE_H_
+#define CPUTRACE_H_
+
+#include "config.h"
+#include "atari.h"
+
+#ifdef MONITOR_TRACE
+
+/* Binary execution trace. cpu.c stores a record for every instruction
+   in a ring; the ring is written to a file on demand (the last
+   instructions executed) or after every frame (all of them).
+   util/tracedump.c prints the file in the format of the TRACE command.
+
+   File: "A8BTRACE", version (2 bytes), record size (2 bytes),
+   4 reserved bytes, then the records. Multi-byte fields are little-endian. */
+typedef struct {
+	UWORD pc;
+	UWORD ypos;				/* ANTIC_ypos */
+	UBYTE xpos;				/* ANTIC_XPOS */
+	UBYTE a;
+	UBYTE x;
+	UBYTE y;
+	UBYTE s;
+	UBYTE p;
+	UBYTE code[3];			/* opcode and operand bytes */
+	UBYTE clock[3];			/* low 24 bits of ANTIC_CPU_CLOCK */
+} CPUTRACE_record_t;
+
+#define CPUTRACE_VERSION 1
+#define CPUTRACE_RECORD_SIZE 16
+#define CPUTRACE_HEADER_SIZE 16
+
+extern int CPUTRACE_enabled;
+extern CPUTRACE_record_t *CPUTRACE_ring;
+extern unsigned int CPUTRACE_mask;		/* ring size - 1 */
+extern unsigned int CPUTRACE_head;		/* records stored so far */
+
+int CPUTRACE_Initialise(int *argc, char *argv[]);
+void CPUTRACE_Exit(void);
+
+void CPUTRACE_Start(void);
+void CPUTRACE_Stop(void);
+/* Writes the records in the ring, oldest first. */
+int CPUTRACE_Save(const char *filename);
+/* Starts writing all records to FILENAME, or stops if NULL. */
+int CPUTRACE_Stream(const char *filename);
+/* Called after each frame. */
+void CPUTRACE_Frame(void);
+void CPUTRACE_PrintStatus(void);
+
+/* Returns the record for the instruction about to execute. */
+static inline CPUTRACE_record_t *CPUTRACE_Next(void)
+{
+	return &CPUTRACE_ring[CPUTRACE_head++ & CPUTRACE_mask];
+}
+
+#endif /* MONITOR_TRACE */
+
+#endif /* CPUTRACE_H_ */
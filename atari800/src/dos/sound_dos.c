@@ -37,6 +37,10 @@ int PLATFORM_SoundSetup(Sound_setup_t *setup)
 	int buffer_samples;
 	int stereo = setup->channels == 2;
 
+	if (bps > 16)
+		/* Sound Blaster plays up to 16-bit samples. */
+		bps = 16;
+
 	if (setup->buffer_frames == 0)
 		/* Set buffer_frames automatically. */
 		setup->buffer_frames = Sound_NextPow2(setup->freq / 50);
@@ -35,6 +35,7 @@
 #include "sysrom.h"
 #include "ui.h"
 #include <stdlib.h>
+#include <string.h>
 
 #ifdef LIBATARI800
 #include "libatari800/main.h"
@@ -129,6 +130,18 @@ void ESC_AddEscRts2(UWORD address, UBYTE esc_code, ESC_FunctionType function)
 	MEMORY_dPutByte(address + 1, esc_code);	/* ESC CODE */
 }
 
+void ESC_GetTable(ESC_Table *table)
+{
+	memcpy(table->address, esc_address, sizeof(esc_address));
+	memcpy(table->function, esc_function, sizeof(esc_function));
+}
+
+void ESC_SetTable(const ESC_Table *table)
+{
+	memcpy(esc_address, table->address, sizeof(esc_address));
+	memcpy(esc_function, table->function, sizeof(esc_function));
+}
+
 void ESC_Remove(UBYTE esc_code)
 {
 	esc_function[esc_code] = NULL;
@@ -102,4 +102,13 @@ void ESC_ClearAll(void);
 /* Reinitializes patches after enable_*_patch change. */
 void ESC_UpdatePatches(void);
 
+/* The registered escape sequences, which aren't in the state save. */
+typedef struct {
+	UWORD address[256];
+	ESC_FunctionType function[256];
+} ESC_Table;
+
+void ESC_GetTable(ESC_Table *table);
+void ESC_SetTable(const ESC_Table *table);
+
 #endif /* ESC_H_ */
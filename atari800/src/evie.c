@@ -32,6 +32,7 @@
 #define COUNT_CYCLES
 
 #include "evie.h"
+#include "cartridge.h"
 #include "pokeysnd.h"
 #include "atari.h"
 #include "antic.h"
@@ -283,6 +284,7 @@ void EVIE_Init(unsigned long freq17, int playback_freq, int n_pokeys, int b16)
 		AYEMU_read_state(AYEMU_CHIP_EVIE_INDEX, &psg_state);
 
 	evie_initialize(freq17, playback_freq, n_pokeys, b16, restore_sid_state ? &sid_state : NULL, restore_psg_state ? &psg_state : NULL);
+	CARTRIDGE_UpdateD5Map();
 }
 
 void EVIE_Exit(void)
@@ -509,6 +511,14 @@ void EVIE_D67PutByte(UWORD addr, UBYTE byte)
 	}
 }
 
+/* Returns TRUE if Evie is enabled but neither its SID nor its PSG can be
+   heard until the next register write. */
+int EVIE_IsSilent(void)
+{
+	return EVIE_version != EVIE_NO
+		&& RESID_is_silent(RESID_CHIP_EVIE_INDEX) && AYEMU_is_silent(AYEMU_CHIP_EVIE_INDEX);
+}
+
 static UBYTE* sid_generate_samples(UBYTE *sndbuffer, int samples)
 {
 	int ticks;
@@ -517,6 +527,10 @@ static UBYTE* sid_generate_samples(UBYTE *sndbuffer, int samples)
 	unsigned int buflen = samples > sid_buffer_length ? sid_buffer_length : samples;
 	unsigned int amount = 0;
 
+	if (EVIE_version != EVIE_NO && RESID_is_silent(RESID_CHIP_EVIE_INDEX)) {
+		RESID_skip(RESID_CHIP_EVIE_INDEX, (int)(buflen * sid_ticks_per_sample));
+		return sndbuffer + buflen * (bit16 ? 2 : 1) * pokeys_count;
+	}
 	if (EVIE_version != EVIE_NO)
 		while (buflen > 0) {
 			ticks = buflen * sid_ticks_per_sample;
@@ -541,6 +555,10 @@ static UBYTE* psg_generate_samples(UBYTE *sndbuffer, int samples)
 	unsigned int amount = 0;
 
 	/*Log_print("psg_generate_samples %d", buflen);*/
+	if (EVIE_version != EVIE_NO && AYEMU_is_silent(AYEMU_CHIP_EVIE_INDEX)) {
+		AYEMU_skip(AYEMU_CHIP_EVIE_INDEX, buflen);
+		return sndbuffer + buflen * (bit16 ? 2 : 1) * pokeys_count;
+	}
 	if (EVIE_version != EVIE_NO)
 		while (buflen > 0) {
 			ticks = buflen * psg_ticks_per_sample;
@@ -625,6 +643,11 @@ static unsigned int sid_generate_sync(UBYTE *buffer_begin, UBYTE *buffer_end, un
 		ticks = int_part;
 		/*Log_print("Evie_GenerateSync");*/
 		/*Log_print("sid_ticks=%d, num_ticks=%d", ticks, num_ticks);*/
+		if (RESID_is_silent(RESID_CHIP_EVIE_INDEX)) {
+			if (ticks > 0)
+				RESID_skip(RESID_CHIP_EVIE_INDEX, ticks);
+			return samples_count * sample_size;
+		}
 		if (ticks > 0) {
 			count = RESID_calculate_sample(RESID_CHIP_EVIE_INDEX, ticks, sid_buffer, samples_count);
 		}
@@ -671,6 +694,10 @@ static unsigned int psg_generate_sync(UBYTE *buffer_begin, UBYTE *buffer_end, un
 		ticks = int_part;
 		/*Log_print("Evie_GenerateSync");*/
 		/*Log_print("psg_ticks=%d, num_ticks=%d", ticks, num_ticks);*/
+		if (AYEMU_is_silent(AYEMU_CHIP_EVIE_INDEX)) {
+			AYEMU_skip(AYEMU_CHIP_EVIE_INDEX, samples_count);
+			return samples_count * sample_size;
+		}
 		if (ticks > 0) {
 			count = AYEMU_calculate_sample(AYEMU_CHIP_EVIE_INDEX, ticks, psg_buffer, samples_count);
 			/*Log_print("calc_sample %d", count);*/
@@ -31,6 +31,7 @@ int EVIE_D5GetByte(UWORD addr, int no_side_effects);
 void EVIE_D5PutByte(UWORD addr, UBYTE byte);
 void EVIE_D67PutByte(UWORD addr, UBYTE byte);
 void EVIE_Process(void *sndbuffer, int sndn);
+int EVIE_IsSilent(void);
 #ifdef SYNCHRONIZED_SOUND
 unsigned int EVIE_GenerateSync(UBYTE *buffer_begin, UBYTE *buffer_end, unsigned int ticks, unsigned int sndn);
 #endif
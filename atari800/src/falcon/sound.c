@@ -112,6 +112,10 @@ int PLATFORM_SoundSetup(Sound_setup_t *setup)
 		return FALSE;
 	}
 
+	if (setup->sample_size > 2)
+		/* No 32-bit formats in the XBIOS sound API. */
+		setup->sample_size = 2;
+
 	if (Getcookie(C__SND, &cookie) == C_FOUND) {
 		if (setup->sample_size == 1 && !(cookie & SND_8BIT)) {
 			if (cookie & SND_16BIT) {
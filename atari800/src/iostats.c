@@ -0,0 +1,338 @@
+/*
+ * iostats.c - hardware register access statistics
+ *
+ * Copyright (c) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "antic.h"
+#include "atari.h"
+#include "iostats.h"
+#include "log.h"
+#include "memory.h"
+#include "util.h"
+
+/* log2 of the cycles between writes; the last bucket takes longer times */
+#define BUCKETS 24
+
+typedef struct {
+	unsigned long reads;
+	unsigned long writes;
+	unsigned int last_write;		/* ANTIC_CPU_CLOCK */
+	unsigned int min_interval;		/* 0 until the second write */
+	unsigned int frame;				/* frame of frame_writes */
+	unsigned int frame_writes;
+	unsigned int max_frame_writes;
+} reg_stat_t;
+
+typedef struct {
+	reg_stat_t reg[256];
+	unsigned long reads;
+	unsigned long writes;
+	unsigned int last_write;
+	unsigned int frame;
+	unsigned int frame_writes;
+	unsigned int max_frame_writes;
+	unsigned long histogram[BUCKETS];
+} page_stat_t;
+
+int IOSTATS_enabled = FALSE;
+
+static page_stat_t *pages[256];
+static unsigned int frame;
+static unsigned long frames;
+static FILE *log_fp = NULL;
+static char dump_filename[FILENAME_MAX];
+
+#ifdef PAGED_ATTRIB
+/* The hardware pages are counted by wrapping their readmap and writemap
+   functions. Code that sets the maps later replaces a wrapper; such pages
+   are wrapped again after the frame. */
+static MEMORY_rdfunc saved_readmap[256];
+static MEMORY_wrfunc saved_writemap[256];
+
+static UBYTE CountedGetByte(UWORD addr, int no_side_effects)
+{
+	if (!no_side_effects)
+		IOSTATS_Read(addr);
+	return (*saved_readmap[addr >> 8])(addr, no_side_effects);
+}
+
+static void CountedPutByte(UWORD addr, UBYTE byte)
+{
+	IOSTATS_Write(addr, byte);
+	(*saved_writemap[addr >> 8])(addr, byte);
+}
+
+static void Wrap(void)
+{
+	int i;
+	for (i = 0; i < 256; i++) {
+		if (MEMORY_readmap[i] != NULL && MEMORY_readmap[i] != CountedGetByte) {
+			saved_readmap[i] = MEMORY_readmap[i];
+			MEMORY_readmap[i] = CountedGetByte;
+		}
+		/* writes to ROM aren't I/O */
+		if (MEMORY_writemap[i] != NULL && MEMORY_writemap[i] != CountedPutByte
+		 && MEMORY_writemap[i] != MEMORY_ROM_PutByte) {
+			saved_writemap[i] = MEMORY_writemap[i];
+			MEMORY_writemap[i] = CountedPutByte;
+		}
+	}
+}
+
+static void Unwrap(void)
+{
+	int i;
+	for (i = 0; i < 256; i++) {
+		if (MEMORY_readmap[i] == CountedGetByte)
+			MEMORY_readmap[i] = saved_readmap[i];
+		if (MEMORY_writemap[i] == CountedPutByte)
+			MEMORY_writemap[i] = saved_writemap[i];
+	}
+}
+#endif /* PAGED_ATTRIB */
+
+static page_stat_t *GetPage(UWORD addr)
+{
+	page_stat_t *page = pages[addr >> 8];
+	if (page == NULL) {
+		page = (page_stat_t *) Util_malloc(sizeof(page_stat_t));
+		memset(page, 0, sizeof(page_stat_t));
+		pages[addr >> 8] = page;
+	}
+	return page;
+}
+
+void IOSTATS_Read(UWORD addr)
+{
+	page_stat_t *page = GetPage(addr);
+	page->reads++;
+	page->reg[addr & 0xff].reads++;
+}
+
+void IOSTATS_Write(UWORD addr, UBYTE byte)
+{
+	page_stat_t *page = GetPage(addr);
+	reg_stat_t *reg = &page->reg[addr & 0xff];
+	unsigned int now = ANTIC_CPU_CLOCK;
+
+	if (reg->writes > 0) {
+		unsigned int interval = now - reg->last_write;
+		if (reg->min_interval == 0 || interval < reg->min_interval)
+			reg->min_interval = interval;
+	}
+	if (reg->writes == 0 || reg->frame != frame) {
+		reg->frame = frame;
+		reg->frame_writes = 0;
+	}
+	if (++reg->frame_writes > reg->max_frame_writes)
+		reg->max_frame_writes = reg->frame_writes;
+	reg->last_write = now;
+	reg->writes++;
+
+	if (page->writes > 0) {
+		unsigned int interval = now - page->last_write;
+		int bucket = 0;
+		while (interval >= 2 && bucket < BUCKETS - 1) {
+			interval >>= 1;
+			bucket++;
+		}
+		page->histogram[bucket]++;
+	}
+	if (page->writes == 0 || page->frame != frame) {
+		page->frame = frame;
+		page->frame_writes = 0;
+	}
+	if (++page->frame_writes > page->max_frame_writes)
+		page->max_frame_writes = page->frame_writes;
+	page->last_write = now;
+	page->writes++;
+
+	if (log_fp != NULL)
+		fprintf(log_fp, "%d,%d,%d,%04X,%02X\n", Atari800_nframes, ANTIC_ypos, ANTIC_XPOS, addr, byte);
+}
+
+void IOSTATS_Start(void)
+{
+#ifdef PAGED_ATTRIB
+	Wrap();
+#endif
+	IOSTATS_enabled = TRUE;
+}
+
+void IOSTATS_Stop(void)
+{
+#ifdef PAGED_ATTRIB
+	Unwrap();
+#endif
+	IOSTATS_enabled = FALSE;
+}
+
+void IOSTATS_Reset(void)
+{
+	int i;
+	for (i = 0; i < 256; i++) {
+		free(pages[i]);
+		pages[i] = NULL;
+	}
+	frames = 0;
+}
+
+void IOSTATS_Frame(void)
+{
+	if (!IOSTATS_enabled)
+		return;
+	frame++;
+	frames++;
+#ifdef PAGED_ATTRIB
+	Wrap();
+#endif
+}
+
+void IOSTATS_Print(FILE *fp, int page_no)
+{
+	int p;
+	int any = FALSE;
+	for (p = 0; p < 256; p++) {
+		const page_stat_t *page = pages[p];
+		int i;
+		if (page == NULL || (page_no >= 0 && p != page_no))
+			continue;
+		any = TRUE;
+		fprintf(fp, "Page %02Xxx: %lu reads, %lu writes in %lu frames, at most %u writes in a frame\n",
+			p, page->reads, page->writes, frames, page->max_frame_writes);
+		if (page->writes > 1) {
+			fprintf(fp, "Cycles between writes:");
+			for (i = 0; i < BUCKETS; i++) {
+				if (page->histogram[i] == 0)
+					continue;
+				if (i == 0)
+					fprintf(fp, " <2:%lu", page->histogram[i]);
+				else if (i == BUCKETS - 1)
+					fprintf(fp, " >=%lu:%lu", 1UL << i, page->histogram[i]);
+				else
+					fprintf(fp, " %lu-%lu:%lu", 1UL << i, (2UL << i) - 1, page->histogram[i]);
+			}
+			fprintf(fp, "\n");
+		}
+		fprintf(fp, "Addr      Reads     Writes  Max/frame  Min cycles\n");
+		for (i = 0; i < 256; i++) {
+			const reg_stat_t *reg = &page->reg[i];
+			if (reg->reads == 0 && reg->writes == 0)
+				continue;
+			fprintf(fp, "%04X %10lu %10lu %10u", (p << 8) + i, reg->reads, reg->writes, reg->max_frame_writes);
+			if (reg->writes > 1)
+				fprintf(fp, " %11u\n", reg->min_interval);
+			else
+				fprintf(fp, "           -\n");
+		}
+	}
+	if (!any)
+		fprintf(fp, "No accesses counted\n");
+}
+
+int IOSTATS_Dump(const char *filename)
+{
+	FILE *fp = fopen(filename, "w");
+	if (fp == NULL) {
+		Log_print("Cannot write %s", filename);
+		return FALSE;
+	}
+	IOSTATS_Print(fp, -1);
+	fclose(fp);
+	return TRUE;
+}
+
+int IOSTATS_Log(const char *filename)
+{
+	if (log_fp != NULL) {
+		fclose(log_fp);
+		log_fp = NULL;
+	}
+	if (filename == NULL)
+		return TRUE;
+	log_fp = fopen(filename, "w");
+	if (log_fp == NULL) {
+		Log_print("Cannot write %s", filename);
+		return FALSE;
+	}
+	fprintf(log_fp, "frame,line,cycle,address,value\n");
+	return TRUE;
+}
+
+int IOSTATS_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-iostats") == 0) {
+			if (i_a) {
+				Util_strlcpy(dump_filename, argv[++i], sizeof(dump_filename));
+				IOSTATS_Start();
+			}
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-iostats-log") == 0) {
+			if (i_a) {
+				if (!IOSTATS_Log(argv[++i]))
+					return FALSE;
+				IOSTATS_Start();
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-iostats <file>      Count hardware register accesses, write on exit");
+				Log_print("\t-iostats-log <file>  Write every hardware register write to a file");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	return TRUE;
+}
+
+void IOSTATS_Exit(void)
+{
+	if (dump_filename[0] != '\0')
+		IOSTATS_Dump(dump_filename);
+	dump_filename[0] = '\0';
+	IOSTATS_Log(NULL);
+	IOSTATS_Stop();
+	IOSTATS_Reset();
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,35 @@
+#ifndef IOSTATS_H_
+#define IOSTATS_H_
+
+#include "config.h"
+#include <stdio.h>
+#include "atari.h"
+
+/* Counts of reads and writes of every hardware register, with the times
+   of the writes: the shortest time between two writes of a register,
+   the most writes in a frame and, for each page, a histogram of the times
+   between writes of that page. Reads done by the monitor aren't counted. */
+
+extern int IOSTATS_enabled;
+
+int IOSTATS_Initialise(int *argc, char *argv[]);
+void IOSTATS_Exit(void);
+
+void IOSTATS_Start(void);
+void IOSTATS_Stop(void);
+void IOSTATS_Reset(void);
+/* Called after each frame. */
+void IOSTATS_Frame(void);
+
+/* Called by memory.c for every access to a hardware address. */
+void IOSTATS_Read(UWORD addr);
+void IOSTATS_Write(UWORD addr, UBYTE byte);
+
+/* Statistics of PAGE, or of all pages if PAGE is negative. */
+void IOSTATS_Print(FILE *fp, int page);
+int IOSTATS_Dump(const char *filename);
+/* Starts writing "frame,line,cycle,address,value" of every write to
+   FILENAME, or stops if NULL. */
+int IOSTATS_Log(const char *filename);
+
+#endif /* IOSTATS_H_ */
@@ -64,6 +64,10 @@ int PLATFORM_SoundSetup(Sound_setup_t *setup)
 	int sconfig[JAVANVM_InitSoundSIZE];
 	int hw_buffer_size;
 
+	if (setup->sample_size > 2)
+		/* 32-bit formats are not supported by the Java side. */
+		setup->sample_size = 2;
+
 	if (setup->buffer_frames == 0)
 		/* Set buffer_frames automatically. */
 		setup->buffer_frames = Sound_NextPow2(setup->freq * 4 / 50);
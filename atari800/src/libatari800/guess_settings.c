@@ -1,5 +1,10 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
 
 #include "libatari800.h"
 
@@ -133,9 +138,25 @@ char *default_args[] = {
 char memo_pad_text[] = "\x21\x34\x21\x32\x29\x00\x23\x2F\x2D\x30\x35\x34\x25\x32\x00\x0D\x00\x2D\x25\x2D\x2F\x00\x30\x21\x24"; /* ATARI COMPUTER - MEMO PAD */
 char memo_pad_altirra[] = "\x21\x6C\x74\x69\x72\x72\x61\x2F\x33"; /* AltirraOS */
 
-int check_memo_pad(emulator_state_t *state) {
-	antic_state_t *antic = (antic_state_t *)&state->state[state->tags.antic];
-	UBYTE *memory = (UBYTE *)&state->state[state->tags.base_ram];
+/* Returns the byte seen by the CPU at ADDR. */
+UBYTE peek(frame_status_t *status, UWORD addr) {
+	if (addr >= 0x4000 && addr < 0x8000)
+		return status->bank[addr - 0x4000];
+	return status->memory[addr];
+}
+
+/* Compares LEN bytes seen by the CPU from ADDR with TEXT. */
+int match_memory(frame_status_t *status, UWORD addr, const char *text, int len) {
+	int i;
+
+	for (i = 0; i < len; i++) {
+		if (peek(status, addr + i) != (UBYTE) text[i])
+			return FALSE;
+	}
+	return TRUE;
+}
+
+int check_memo_pad(frame_status_t *status) {
 	UWORD ramtop;
 	UWORD gr0;
 
@@ -151,13 +172,13 @@ int check_memo_pad(emulator_state_t *state) {
 		character indent, so on a 48k machine with no carts inserted, it is at
 		$bc42.
 	 */
-	ramtop = memory[0x6a] << 8;
-	if (antic->dlist == ramtop - 0x3e0) {
+	ramtop = peek(status, 0x6a) << 8;
+	if (status->dlist == ramtop - 0x3e0) {
 		gr0 = ramtop - 0x3c0;
-		if (memcmp(&memory[gr0 + 2], memo_pad_text, sizeof(memo_pad_text)) == 0) {
+		if (match_memory(status, gr0 + 2, memo_pad_text, sizeof(memo_pad_text))) {
 			return TRUE;
 		}
-		else if (memcmp(&memory[gr0 + 2], memo_pad_altirra, sizeof(memo_pad_altirra)) == 0) {
+		else if (match_memory(status, gr0 + 2, memo_pad_altirra, sizeof(memo_pad_altirra))) {
 			return TRUE;
 		}
 	}
@@ -166,27 +187,19 @@ int check_memo_pad(emulator_state_t *state) {
 
 #define BAD_DLIST_MIN_FRAMES 200
 
-int run_emulator(int num_args, int num_frames, int verbose) {
-	int i;
-
-	if (verbose > 1) {
-		for (i=0; i<num_args; i++) {
-			printf("%s ", test_args[i]);
-		}
-		printf("\n");
-	}
-	libatari800_init(num_args, test_args);
-	if (libatari800_error_code) return 0;
-
-	emulator_state_t state;
+/* Run the emulator from its current state. Returns the number of frames run,
+   or minus the frame where a failure was detected. */
+int run_emulator(int num_frames) {
+	frame_status_t status;
 	input_template_t input;
 
 	int frame = 0;
 	int selftest_count = 0;
+	libatari800_clear_input_array(&input);
 	while (frame < num_frames) {
 		libatari800_next_frame(&input);
-		libatari800_get_current_state(&state);
-		if (state.flags.selftest_enabled) {
+		libatari800_get_frame_status(&status);
+		if (status.selftest_enabled) {
 			selftest_count++;
 			if (selftest_count > 10) {
 				frame = -frame;
@@ -196,7 +209,7 @@ int run_emulator(int num_args, int num_frames, int verbose) {
 		}
 		switch (libatari800_error_code) {
 			case 0:
-			if (check_memo_pad(&state)) {
+			if (check_memo_pad(&status)) {
 				libatari800_error_code = LIBATARI800_MEMO_PAD;
 				frame = -frame;
 				goto exit;
@@ -239,16 +252,27 @@ cart_types_t *get_first_cart(machine_config_t *machine, int cart_kb) {
 	return cart_desc;
 }
 
-/* Run the emulator using a given set of command line args. If it could be a
-   cartridge, run it multiple times trying the various cart types corresponding
-   to its size.
+/* One run of an image: a machine and, if the image could be a cartridge, one
+   of the cart types corresponding to its size. */
+typedef struct {
+	machine_config_t *machine;
+	cart_types_t *cart_desc;
+	int cart_type;	/* 0 to load the image without a cart type */
+	int num_frames;
+	int result;		/* return value of run_emulator, 0 if the image failed to load */
+	int error_code;
+} trial_t;
+
+#define MAX_TRIALS 1024
+
+trial_t trials[MAX_TRIALS];
+
+/* Add the trials of a machine to the list starting at trial. Returns the
+   number of trials added.
 */
-int run_machine(machine_config_t *machine, char *pathname, int num_frames, int cart_kb, int verbose) {
-	int success;
-	int any_success = 0;
-	char **machine_args;
+int add_trials(trial_t *trial, machine_config_t *machine, int num_frames, int cart_kb) {
+	int count = 0;
 	cart_types_t *cart_desc = get_first_cart(machine, cart_kb);
-	char cart_type_string[16];
 
 	if (cart_kb < 0 && !cart_desc) {
 		/* have an exact match for a cart type, but not compatible machine */
@@ -256,64 +280,190 @@ int run_machine(machine_config_t *machine, char *pathname, int num_frames, int c
 	}
 	num_frames = num_frames < machine->min_frames ? machine->min_frames : num_frames;
 	while (1) {
-		/* args array is modified by atari800, so need to recreate it each time */
-		int num_args = 0;
-		while (num_args < (sizeof(default_args) / sizeof(default_args[0]))) {
-			test_args[num_args] = default_args[num_args];
-			// printf("default arg %d: %s\n", num_args, default_args[num_args]);
-			num_args++;
+		trial->machine = machine;
+		trial->cart_desc = cart_desc;
+		trial->cart_type = 0;
+		if (cart_desc && ((cart_desc->size == cart_kb) || (cart_kb < 0))) {
+			trial->cart_type = cart_desc->type;
 		}
-		machine_args = machine->args;
-		while (*machine_args) {
-			// printf("arg %d: %s\n", num_args, *machine_args);
-			test_args[num_args++] = *machine_args++;
+		trial->num_frames = num_frames;
+		trial->result = 0;
+		trial->error_code = 0;
+		trial++;
+		count++;
+		if (!cart_desc || (cart_kb < 0)) break;
+		if (cart_desc) {
+			cart_desc++;
+			if (cart_desc->size != cart_kb) cart_desc = NULL;
 		}
-		if (cart_desc && ((cart_desc->size == cart_kb) || (cart_kb < 0))) {
-			test_args[num_args++] = "-cart-type";
-			sprintf(cart_type_string, "%d", cart_desc->type);
-			test_args[num_args++] = cart_type_string;
-			test_args[num_args++] = "-cart";
+	}
+	return count;
+}
+
+/* The machine as it was right after libatari800_init, restored before every
+   trial on that machine instead of booting it again. */
+libatari800_context_t *boot_snapshot = NULL;
+machine_config_t *booted_machine = NULL;
+
+int boot_machine(machine_config_t *machine, int verbose) {
+	int i;
+	char **machine_args;
+
+	/* args array is modified by atari800, so need to recreate it each time */
+	int num_args = 0;
+	while (num_args < (sizeof(default_args) / sizeof(default_args[0]))) {
+		test_args[num_args] = default_args[num_args];
+		num_args++;
+	}
+	machine_args = machine->args;
+	while (*machine_args) {
+		test_args[num_args++] = *machine_args++;
+	}
+	if (verbose > 1) {
+		for (i=0; i<num_args; i++) {
+			printf("%s ", test_args[i]);
 		}
-		test_args[num_args++] = pathname;
-
-		success = run_emulator(num_args, num_frames, verbose);
-		if (success) any_success++;
-		if (!verbose) {
-			if (success > 0) {
-				printf("%s: %s (", pathname, machine->label);
-				machine_args = machine->args;
-				while (*machine_args) {
-					printf("%s", *machine_args);
-					machine_args++;
-					if (*machine_args) printf(" ");
-				}
-				if (cart_desc) {
-					printf(" -cart-type %d", cart_desc->type);
-				}
-				printf(")\n");
+		printf("\n");
+	}
+	booted_machine = NULL;
+	libatari800_init(num_args, test_args);
+	if (libatari800_error_code) return FALSE;
+
+	if (boot_snapshot) libatari800_context_free(boot_snapshot);
+	/* without a snapshot the machine is booted again for the next trial */
+	boot_snapshot = libatari800_context_new();
+	if (boot_snapshot) booted_machine = machine;
+	return TRUE;
+}
+
+void run_trial(trial_t *trial, char *pathname, int verbose) {
+	/* a snapshot that can't be restored is replaced by booting again */
+	if (!(trial->machine == booted_machine && libatari800_context_restore(boot_snapshot))
+	    && !boot_machine(trial->machine, verbose)) {
+		trial->result = 0;
+		trial->error_code = libatari800_error_code;
+		return;
+	}
+	if (verbose > 1) {
+		if (trial->cart_type) printf("-cart-type %d -cart ", trial->cart_type);
+		printf("%s\n", pathname);
+	}
+	/* an image that can't be opened runs the bare machine, as on the
+	   command line */
+	if (trial->cart_type) libatari800_insert_cartridge(pathname, trial->cart_type);
+	else libatari800_reboot_with_file(pathname);
+	if (libatari800_error_code) trial->result = 0;
+	else trial->result = run_emulator(trial->num_frames);
+	trial->error_code = libatari800_error_code;
+}
+
+#ifndef _WIN32
+/* Split the trials into contiguous blocks, one per worker process. Each
+   worker shares the parent's memory copy-on-write, boots only the machines
+   of its own block and sends back the result and error code of each
+   trial.
+*/
+void run_trials_parallel(trial_t *trial, int num_trials, char *pathname, int jobs, int verbose) {
+	int fd[MAX_TRIALS];
+	pid_t pid[MAX_TRIALS];
+	int first[MAX_TRIALS + 1];
+	int i, j;
+
+	if (jobs > num_trials) jobs = num_trials;
+	for (j=0; j<=jobs; j++) {
+		first[j] = num_trials * j / jobs;
+	}
+	fflush(stdout);
+	for (j=0; j<jobs; j++) {
+		int pipe_fd[2];
+		pid[j] = -1;
+		fd[j] = -1;
+		if (pipe(pipe_fd) < 0) continue;
+		pid[j] = fork();
+		if (pid[j] == 0) {
+			close(pipe_fd[0]);
+			for (i=first[j]; i<first[j + 1]; i++) {
+				int record[2];
+				run_trial(&trial[i], pathname, verbose);
+				record[0] = trial[i].result;
+				record[1] = trial[i].error_code;
+				if (write(pipe_fd[1], record, sizeof(record)) != sizeof(record)) break;
 			}
+			fflush(stdout);
+			_exit(0);
 		}
-		else {
-			printf("%s: %s", pathname, machine->label);
-			if (success > 0) printf(" status: OK through %d frames", success);
+		close(pipe_fd[1]);
+		if (pid[j] < 0) close(pipe_fd[0]);
+		else fd[j] = pipe_fd[0];
+	}
+	for (j=0; j<jobs; j++) {
+		for (i=first[j]; i<first[j + 1]; i++) {
+			int record[2];
+			if (fd[j] >= 0 && read(fd[j], record, sizeof(record)) == sizeof(record)) {
+				trial[i].result = record[0];
+				trial[i].error_code = record[1];
+			}
 			else {
-				printf(" status: FAIL");
-				if (libatari800_error_code) {
-					printf(" (%s)", libatari800_error_message());
-				}
+				/* worker couldn't be started or died */
+				trial[i].result = 0;
+				trial[i].error_code = 0;
+			}
+		}
+		if (fd[j] >= 0) close(fd[j]);
+		if (pid[j] > 0) waitpid(pid[j], NULL, 0);
+	}
+}
+#endif
+
+void run_trials(trial_t *trial, int num_trials, char *pathname, int jobs, int verbose) {
+	int i;
+
+#ifndef _WIN32
+	if (jobs > 1 && num_trials > 1) {
+		run_trials_parallel(trial, num_trials, pathname, jobs, verbose);
+		return;
+	}
+#endif
+	for (i=0; i<num_trials; i++) {
+		run_trial(&trial[i], pathname, verbose);
+	}
+}
+
+void print_trial(trial_t *trial, char *pathname, int verbose) {
+	char **machine_args;
+	machine_config_t *machine = trial->machine;
+	int success = trial->result;
+
+	if (!verbose) {
+		if (success > 0) {
+			printf("%s: %s (", pathname, machine->label);
+			machine_args = machine->args;
+			while (*machine_args) {
+				printf("%s", *machine_args);
+				machine_args++;
+				if (*machine_args) printf(" ");
 			}
-			if (cart_desc) {
-				printf(" (cart=%d '%s')", cart_desc->type, cart_desc->label);
+			if (trial->cart_desc) {
+				printf(" -cart-type %d", trial->cart_desc->type);
 			}
-			printf("\n");
+			printf(")\n");
 		}
-		if (!cart_desc || (cart_kb < 0)) break;
-		if (cart_desc) {
-			cart_desc++;
-			if (cart_desc->size != cart_kb) cart_desc = NULL;
+	}
+	else {
+		printf("%s: %s", pathname, machine->label);
+		if (success > 0) printf(" status: OK through %d frames", success);
+		else {
+			printf(" status: FAIL");
+			if (trial->error_code) {
+				libatari800_error_code = trial->error_code;
+				printf(" (%s)", libatari800_error_message());
+			}
 		}
+		if (trial->cart_desc) {
+			printf(" (cart=%d '%s')", trial->cart_desc->type, trial->cart_desc->label);
+		}
+		printf("\n");
 	}
-	return any_success;
 }
 
 #define CHUNK_SIZE 1024
@@ -388,6 +538,7 @@ int main(int argc, char **argv) {
 	int video_flag = MACHINE_VIDEO_ALL;
 	int video_flag_encountered = FALSE;
 	int num_frames = 1000;
+	int jobs = 1;
 
 	int i;
 	for (i=1; i<argc; i++) {
@@ -401,6 +552,9 @@ int main(int argc, char **argv) {
 			else if (strcmp(argv[i], "-vvv") == 0) {
 				verbose += 3;
 			}
+			else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+				jobs = atoi(argv[++i]);
+			}
 			else if (strcmp(argv[i], "-s") == 0) {
 				verbose = 0;
 			}
@@ -450,21 +604,32 @@ int main(int argc, char **argv) {
 		}
 		else {
 			int successful_count = 0;
+			int num_trials = 0;
 			machine_config_t *machine = machine_config;
 			int cart_kb = guess_cart_kb(argv[i], verbose);
+			int t;
 			if (cart_kb == INVALID_FILE_SIZE) continue;
 			while (machine->label) {
 				if (machine->type & machine_flag && machine->type & os_flag && machine->type & video_flag) {
 					if (verbose > 1) {
 						printf("trying %s\n", machine->label);
 					}
-					if (run_machine(machine, argv[i], num_frames, cart_kb, verbose)) successful_count++;
+					num_trials += add_trials(&trials[num_trials], machine, num_frames, cart_kb);
 				}
 				else if (verbose > 1) {
 					printf("skipping %s\n", machine->label);
 				}
 				machine++;
 			}
+			run_trials(trials, num_trials, argv[i], jobs, verbose);
+			machine = NULL;
+			for (t=0; t<num_trials; t++) {
+				print_trial(&trials[t], argv[i], verbose);
+				if (trials[t].result && trials[t].machine != machine) {
+					machine = trials[t].machine;
+					successful_count++;
+				}
+			}
 			if (!successful_count && !verbose) printf("%s: FAIL\n", argv[i]);
 		}
 	}
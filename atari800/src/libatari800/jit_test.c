@@ -0,0 +1,322 @@
+/* Differential test of the 6502 JIT: runs random 6502 programs with and
+   without compiled blocks and compares the whole machine after each frame. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "antic.h"
+#include "atari.h"
+#include "cpu.h"
+#include "memory.h"
+#include "pokey.h"
+#ifdef CPU_JIT
+#include "cpu_jit.h"
+#endif
+
+#include "libatari800.h"
+
+#ifdef CPU_JIT
+
+/* free RAM on both machines; page zero from 0x80 is used as well */
+#define CODE_START 0x2000
+#define CODE_END   0x2e00
+#define SUB_START  0x2f00
+#define DATA_START 0x3000			/* 0x3000..0x3fff */
+#define N_PROGRAMS 24
+#define N_FRAMES   40
+
+static unsigned long seed;
+
+static int rnd(int n)
+{
+	seed = seed * 1103515245 + 12345;
+	return (int) ((seed >> 16) % n);
+}
+
+static UBYTE *mem;
+static int pc;
+
+/* operand addresses of LDA #imm, patched by the program itself */
+static int patch_addr[256];
+static int n_patches;
+
+/* starts of the instructions, for backward branches */
+static int insn_start[4096];
+static int n_insns;
+
+static void put(int b)
+{
+	mem[pc++] = (UBYTE) b;
+}
+
+static void put_word(int w)
+{
+	put(w & 0xff);
+	put(w >> 8);
+}
+
+static int data_addr(void)
+{
+	return DATA_START + rnd(0xf00);
+}
+
+/* Opcodes by addressing mode, all compiled by cpu_jit.c */
+static const UBYTE read_imm[] = { 0x09, 0x29, 0x49, 0x69, 0xe9, 0xc9, 0xa9, 0xe0, 0xc0, 0xa2, 0xa0 };
+static const UBYTE read_zp[] = { 0x05, 0x25, 0x45, 0x65, 0xe5, 0xc5, 0xa5, 0xe4, 0xc4, 0xa6, 0xa4, 0x24,
+	0x15, 0x35, 0x55, 0x75, 0xf5, 0xd5, 0xb5, 0xb6, 0xb4 };
+static const UBYTE read_abs[] = { 0x0d, 0x2d, 0x4d, 0x6d, 0xed, 0xcd, 0xad, 0xec, 0xcc, 0xae, 0xac, 0x2c,
+	0x1d, 0x3d, 0x5d, 0x7d, 0xfd, 0xdd, 0xbd, 0xbc,
+	0x19, 0x39, 0x59, 0x79, 0xf9, 0xd9, 0xb9, 0xbe };
+static const UBYTE read_ind[] = { 0x01, 0x21, 0x41, 0x61, 0xe1, 0xc1, 0xa1,
+	0x11, 0x31, 0x51, 0x71, 0xf1, 0xd1, 0xb1 };
+static const UBYTE write_zp[] = { 0x85, 0x86, 0x84, 0xe6, 0xc6, 0x06, 0x46, 0x26, 0x66 };
+static const UBYTE write_zpx[] = { 0x95, 0x94, 0xf6, 0xd6, 0x16, 0x56, 0x36, 0x76 };
+static const UBYTE write_abs[] = { 0x8d, 0x8e, 0x8c, 0xee, 0xce, 0x0e, 0x4e, 0x2e, 0x6e };
+static const UBYTE write_absx[] = { 0x9d, 0xfe, 0xde, 0x1e, 0x5e, 0x3e, 0x7e };
+static const UBYTE implied[] = { 0x0a, 0x4a, 0x2a, 0x6a, 0xaa, 0xa8, 0x8a, 0x98, 0xba, 0xe8, 0xc8,
+	0xca, 0x88, 0x18, 0x38, 0xb8, 0xea, 0x48, 0x68 };
+static const UBYTE branches[] = { 0x10, 0x30, 0x50, 0x70, 0x90, 0xb0, 0xd0, 0xf0 };
+
+#define PICK(a) a[rnd(sizeof(a))]
+
+/* Emits one random instruction (or a short sequence) at pc. */
+static void random_insn(void)
+{
+	insn_start[n_insns++] = pc;
+	switch (rnd(16)) {
+	case 0:
+	case 1:
+		if (rnd(4) == 0) {
+			/* LDA #imm that the program modifies */
+			put(0xa9);
+			patch_addr[n_patches++ & 0xff] = pc;
+			put(rnd(256));
+		}
+		else {
+			put(PICK(read_imm));
+			put(rnd(256));
+		}
+		break;
+	case 2:
+	case 3:
+		put(PICK(read_zp));
+		put(0x80 + rnd(0x80));
+		break;
+	case 4:
+	case 5:
+		put(PICK(read_abs));
+		put_word(data_addr());
+		break;
+	case 6:
+		put(PICK(read_ind));
+		put(0x80 + 2 * rnd(0x20));
+		break;
+	case 7:
+		put(PICK(write_zp));
+		put(0xc0 + rnd(0x40));
+		break;
+	case 8:
+		/* keep indexed stores in the data area */
+		put(0xa2);
+		put(rnd(0x40));
+		insn_start[n_insns++] = pc;
+		if (rnd(2)) {
+			put(PICK(write_zpx));
+			put(0xc0);
+		}
+		else {
+			put(PICK(write_absx));
+			put_word(data_addr());
+		}
+		break;
+	case 9:
+		put(PICK(write_abs));
+		put_word(data_addr());
+		break;
+	case 10:
+		/* STA (zp),y - pointers are never overwritten */
+		put(0x91);
+		put(0x80 + 2 * rnd(0x20));
+		break;
+	case 11:
+	case 12:
+		put(PICK(implied));
+		break;
+	case 13:
+		switch (rnd(8)) {
+		case 0:
+			/* self-modifying code */
+			if (n_patches > 0) {
+				put(0x8d);
+				put_word(patch_addr[rnd(n_patches < 256 ? n_patches : 256)]);
+			}
+			else
+				put(0xea);
+			break;
+		case 1:
+			/* I/O: VCOUNT, RANDOM, COLBK, WSYNC */
+			put(0xad);
+			put_word(rnd(2) ? 0xd40b : 0xd20a);
+			break;
+		case 2:
+			put(0x8d);
+			put_word(rnd(2) ? 0xd01a : 0xd40a);
+			break;
+		case 3:
+			/* decimal mode is left to the interpreter */
+			put(0xf8);
+			insn_start[n_insns++] = pc;
+			put(rnd(2) ? 0x69 : 0xe9);
+			put(rnd(256));
+			insn_start[n_insns++] = pc;
+			put(0xd8);
+			break;
+		case 4:
+			put(0x20);
+			put_word(SUB_START + 16 * rnd(8));
+			break;
+		default:
+			put(0x9a);	/* TXS */
+			break;
+		}
+		break;
+	default:
+		put(PICK(branches));
+		if (rnd(3) == 0 && n_insns > 1) {
+			/* backward, to an earlier instruction in range */
+			int i = n_insns - 1 - rnd(n_insns - 1 < 20 ? n_insns - 1 : 20) - 1;
+			int offset = insn_start[i] - (pc + 1);
+			put(offset >= -128 ? offset : 0);
+		}
+		else
+			put(0);		/* fall through */
+		break;
+	}
+}
+
+static void make_program(unsigned long program_seed)
+{
+	int i;
+	seed = program_seed;
+	n_patches = 0;
+	n_insns = 0;
+	/* pointers at 0x80..0xbf, work area at 0xc0..0xff */
+	for (i = 0; i < 0x40; i += 2) {
+		int p = data_addr() & 0xff00;
+		mem[0x80 + i] = (UBYTE) p;
+		mem[0x81 + i] = (UBYTE) (p >> 8);
+	}
+	for (i = 0xc0; i < 0x100; i++)
+		mem[i] = (UBYTE) rnd(256);
+	for (i = DATA_START; i < DATA_START + 0x1000; i++)
+		mem[i] = (UBYTE) rnd(256);
+	/* subroutines of a few instructions */
+	for (i = 0; i < 8; i++) {
+		int j;
+		pc = SUB_START + 16 * i;
+		for (j = 0; j < 4; j++) {
+			put(PICK(read_imm));
+			put(rnd(256));
+		}
+		put(0x60);
+	}
+	pc = CODE_START;
+	while (pc < CODE_END)
+		random_insn();
+	put(0x4c);
+	put_word(CODE_START);
+}
+
+static unsigned long hash_machine(void)
+{
+	unsigned long h = 5381;
+	UBYTE *screen = libatari800_get_screen_ptr();
+	int i;
+	CPU_GetStatus();
+	for (i = 0; i < 0x10000; i++)
+		h = h * 33 + MEMORY_dGetByte(i);
+	h = h * 33 + CPU_regPC;
+	h = h * 33 + CPU_regA;
+	h = h * 33 + CPU_regX;
+	h = h * 33 + CPU_regY;
+	h = h * 33 + CPU_regS;
+	h = h * 33 + CPU_regP;
+	h = h * 33 + ANTIC_xpos;
+	for (i = 0; i < 384 * 240; i++)
+		h = h * 33 + screen[i];
+	return h;
+}
+
+/* Boots MACHINE, runs the program made from PROGRAM_SEED and stores hashes
+   of N_FRAMES frames in HASHES. */
+static void run(char **machine, unsigned long program_seed, int jit, unsigned long *hashes)
+{
+	input_template_t input;
+	char *args[4];
+	int frame;
+	/* libatari800_init removes the options it handles from the array */
+	memcpy(args, machine, sizeof(args));
+	mem = libatari800_get_main_memory_ptr();
+	/* a cold start doesn't clear areas without RAM */
+	memset(mem, 0, 0x10000);
+	libatari800_init(4, args);
+	/* seeded with the host time */
+	POKEY_SetRandomCounter(0);
+	libatari800_clear_input_array(&input);
+	CPU_JIT_enabled = jit;
+	for (frame = 0; frame < 100; frame++)
+		libatari800_next_frame(&input);
+	make_program(program_seed);
+	CPU_regPC = CODE_START;
+	CPU_cim_encountered = FALSE;
+	for (frame = 0; frame < N_FRAMES; frame++) {
+		libatari800_next_frame(&input);
+		hashes[frame] = hash_machine();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	/* with BASIC, as the XL self-test would use page zero from 0x80;
+	   without R-Time 8, which reads the host clock */
+	static char *machines[][4] = {
+		{ "atari800", "-xl", "-basic", "-nortime" },
+		{ "atari800", "-atari", "-nobasic", "-nortime" }
+	};
+	unsigned long interpreted[N_FRAMES];
+	unsigned long compiled[N_FRAMES];
+	int failures = 0;
+	int m;
+
+	for (m = 0; m < 2; m++) {
+		int i;
+		for (i = 0; i < N_PROGRAMS; i++) {
+			int frame;
+			run(machines[m], 1000 * m + i + 1, FALSE, interpreted);
+			CPU_PredecodeStatsReset();
+			run(machines[m], 1000 * m + i + 1, TRUE, compiled);
+			for (frame = 0; frame < N_FRAMES; frame++) {
+				if (interpreted[frame] != compiled[frame]) {
+					printf("%s program %d: differs at frame %d\n", machines[m][1], i + 1, frame);
+					failures++;
+					break;
+				}
+			}
+		}
+		printf("%s: %d programs, %d frames each\n", machines[m][1], N_PROGRAMS, N_FRAMES);
+		CPU_PredecodeStatsPrint(stdout);
+	}
+	printf(failures ? "FAILED\n" : "OK\n");
+	return failures ? 1 : 0;
+}
+
+#else /* CPU_JIT */
+
+int main(int argc, char **argv)
+{
+	printf("6502 JIT not compiled in, nothing to test\n");
+	return 0;
+}
+
+#endif /* CPU_JIT */
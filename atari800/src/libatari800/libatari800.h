@@ -1,6 +1,8 @@
 #ifndef LIBATARI800_H_
 #define LIBATARI800_H_
 
+#include <stdint.h>
+
 #ifndef UBYTE
 #define UBYTE unsigned char
 #endif
@@ -10,7 +12,6 @@
 #endif
 
 #ifndef ULONG
-#include <stdint.h>
 #define ULONG uint32_t
 #endif
 
@@ -176,6 +177,69 @@ typedef struct {
     int Base_mult[4];
 } pokey_state_t;
 
+/* Machine status after a frame, filled without going through the state
+   save. The pointers stay valid until the next frame. */
+typedef struct {
+    UWORD PC;
+    UBYTE A;
+    UBYTE P;
+    UBYTE S;
+    UBYTE X;
+    UBYTE Y;
+    UWORD dlist;
+    UBYTE selftest_enabled;
+    ULONG frame;
+    int idle_cycles;            /* cycles of idle loops skipped in the frame */
+    const UBYTE *memory;        /* 64 KB seen by the CPU, except 0x4000-0x7fff */
+    const UBYTE *bank;          /* 16 KB seen by the CPU at 0x4000-0x7fff */
+    const UBYTE *screen;
+} frame_status_t;
+
+/* Samples of the last frame, interleaved when there are two channels. They
+   stay valid until the end of the next frame. */
+typedef struct {
+    const UBYTE *samples;
+    int frames;                 /* samples per channel */
+    int channels;               /* 1 = mono, 2 = stereo */
+    int sample_size;            /* 1 = unsigned 8-bit, 2 = signed 16-bit system-endian */
+    int freq;                   /* frames per second */
+} audio_buffer_t;
+
+/* Sound chips, for libatari800_get_audio_stem */
+#define LIBATARI800_CHIP_POKEY 0
+#define LIBATARI800_CHIP_VOTRAX 1
+#define LIBATARI800_CHIP_SLIGHTSID 2
+#define LIBATARI800_CHIP_EVIE 3
+#define LIBATARI800_CHIP_SIDARI 4
+#define LIBATARI800_CHIP_SONARI 5
+#define LIBATARI800_CHIP_MELODY_PSG 6
+#define LIBATARI800_CHIP_YAMARI 7
+
+/* Lines of the screen that changed, see libatari800_get_screen_changes */
+typedef struct {
+    uint64_t hash;              /* as returned by libatari800_get_screen_hash */
+    int changed_lines;
+    UBYTE dirty[240];           /* TRUE for each line that changed */
+} screen_changes_t;
+
+/* Output of one frame of libatari800_run_frames */
+typedef struct {
+    int error_code;             /* libatari800_error_code after the frame */
+    int audio_frames;           /* as returned by libatari800_get_audio */
+    uint64_t screen_hash;       /* 0 unless the screen was drawn and hashed */
+} frame_output_t;
+
+/* Flags of libatari800_run_frames */
+#define LIBATARI800_RUN_DRAW_ALL 1
+#define LIBATARI800_RUN_HASH_SCREEN 2
+#define LIBATARI800_RUN_STOP_ON_ERROR 4
+
+typedef struct {
+    /* called after each frame if not NULL; returning FALSE ends the run */
+    int (*frame_done)(void *user, int frame, const frame_output_t *output);
+    void *user;
+} run_callbacks_t;
+
 extern int libatari800_error_code;
 #define LIBATARI800_UNIDENTIFIED_CART_TYPE 1
 #define LIBATARI800_CPU_CRASH 2
@@ -187,24 +251,104 @@ extern int libatari800_error_code;
 
 int libatari800_init(int argc, char **argv);
 
+/* Closes the sound file written with the -audio-only option. */
+void libatari800_exit(void);
+
 char *libatari800_error_message();
 
 void libatari800_clear_input_array(input_template_t *input);
 
 int libatari800_next_frame(input_template_t *input);
 
+/* Runs N frames, the Ith one with INPUT_SCHEDULE[I], or with nothing pressed
+   if INPUT_SCHEDULE is NULL, and stores what each frame gave in OUTPUTS[I]
+   unless OUTPUTS is NULL. Only the last frame draws the screen, unless FLAGS
+   has LIBATARI800_RUN_DRAW_ALL; the others run exactly the same without
+   drawing it. LIBATARI800_RUN_HASH_SCREEN hashes the visible part of every
+   drawn screen, and LIBATARI800_RUN_STOP_ON_ERROR ends the run after a frame
+   with an error. Returns the number of frames run. */
+int libatari800_run_frames(int n, input_template_t *input_schedule, frame_output_t *outputs, int flags, const run_callbacks_t *callbacks);
+
 int libatari800_mount_disk_image(int diskno, const char *filename, int readonly);
 
 int libatari800_reboot_with_file(const char *filename);
 
+int libatari800_insert_cartridge(const char *filename, int type);
+
+/* Goes back to the last snapshot taken with the -rewind option. Calling it
+   again before the next frame goes back one more snapshot. */
+int libatari800_rewind(void);
+
 UBYTE *libatari800_get_main_memory_ptr();
 
 UBYTE *libatari800_get_screen_ptr();
 
+/* Returns a 64-bit hash of the visible part of the screen. */
+uint64_t libatari800_get_screen_hash(void);
+
+/* Compares each line of the visible part of the screen with the same line at
+   the previous call, and returns how many of them changed; all of them at
+   the first call. Lines that can't be seen are never marked. */
+int libatari800_get_screen_changes(screen_changes_t *changes);
+
 cpu_state_t *libatari800_get_cpu_ptr();
 
 void libatari800_get_current_state(emulator_state_t *state);
 
 void libatari800_restore_state(emulator_state_t *state);
 
+void libatari800_get_frame_status(frame_status_t *status);
+
+/* Fills AUDIO with the samples of the last frame, which are read in place,
+   and returns their number per channel; 0 if sound is disabled. */
+int libatari800_get_audio(audio_buffer_t *audio);
+
+/* Stems are the sound that each chip added to the samples of
+   libatari800_get_audio; added up they make those samples, unless they
+   clip. Switching them on or off takes effect at
+   the end of the next frame, so the first stems come with the frame after
+   it. The stem of a chip that is not emulated is silent.
+   libatari800_get_audio_stem returns FALSE if the last frame was made
+   without stems. */
+int libatari800_enable_audio_stems(int enable);
+
+int libatari800_get_audio_stem(int chip, audio_buffer_t *audio);
+
+/* A state delta holds the state without the 256-byte pages of memory that
+   haven't changed since the previous delta; the first one has all of them.
+   Applying a delta to the state made from the previous one gives the
+   current state, which libatari800_restore_state_buffer loads. The
+   functions return the length written to BUFFER, or 0 if it is too small or
+   the delta doesn't fit STATE. Deltas are only small when the library is
+   configured with --enable-dirtypages. */
+int libatari800_get_state_delta(UBYTE *buffer, int size);
+
+int libatari800_apply_state_delta(const UBYTE *state, int state_len, const UBYTE *delta, int delta_len, UBYTE *buffer, int size);
+
+int libatari800_restore_state_buffer(const UBYTE *state, int len);
+
+/* Several machines in one process, taking turns. There is still a single
+   emulator in global variables: a context is a saved machine, and selecting
+   it swaps it in through the state save, after saving the machine that was
+   running into its own context. The functions above work on the selected
+   machine. Restoring a context instead makes the machine a copy of it, which
+   leaves the context unchanged, so it can serve as a snapshot to go back to.
+   Nothing here is reentrant and contexts don't run in parallel: calls from
+   several threads must be serialized by the caller and gain no speed. To run
+   machines on several cores, use one process per machine.
+   libatari800_context_new returns NULL and the other functions return
+   FALSE if the machine can't be saved or read; the machine that was
+   running then stays selected. */
+typedef struct libatari800_context libatari800_context_t;
+
+libatari800_context_t *libatari800_context_new(void);
+
+void libatari800_context_free(libatari800_context_t *context);
+
+int libatari800_context_select(libatari800_context_t *context);
+
+int libatari800_context_restore(libatari800_context_t *context);
+
+int libatari800_context_next_frame(libatari800_context_t *context, input_template_t *input);
+
 #endif /* LIBATARI800_H_ */
@@ -25,21 +25,31 @@
 
 #include "config.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /* Atari800 includes */
 #include "atari.h"
 #include "akey.h"
 #include "afile.h"
+#include "binload.h"
+#include "esc.h"
 #include "../input.h"
+#include "iostats.h"
 #include "log.h"
+#include "rewind.h"
 #include "antic.h"
 #include "cpu.h"
+#ifdef MONITOR_TRACE
+#include "cputrace.h"
+#endif
 #include "platform.h"
 #include "memory.h"
 #include "screen.h"
 #ifdef SOUND
 #include "../sound.h"
+#include "pokeysnd.h"
+#include "sndsave.h"
 #endif
 #include "util.h"
 #include "videomode.h"
@@ -112,7 +122,7 @@ int PLATFORM_Initialise(int *argc, char *argv[])
 }
 
 
-void LIBATARI800_Frame(void)
+void LIBATARI800_Frame(int draw_display)
 {
 	switch (INPUT_key_code) {
 	case AKEY_COLDSTART:
@@ -137,15 +147,29 @@ void LIBATARI800_Frame(void)
 	Devices_Frame();
 	INPUT_Frame();
 	GTIA_Frame();
-	ANTIC_Frame(TRUE);
-	INPUT_DrawMousePointer();
-	Screen_DrawAtariSpeed(Util_time());
-	Screen_DrawDiskLED();
-	Screen_Draw1200LED();
+	if (!draw_display)
+		ANTIC_Frame(ANTIC_FRAME_NO_PIXELS);
+	else {
+		ANTIC_Frame(TRUE);
+		INPUT_DrawMousePointer();
+		Screen_DrawAtariSpeed(Util_time());
+		Screen_DrawDiskLED();
+		Screen_Draw1200LED();
+	}
 	POKEY_Frame();
 #ifdef SOUND
 	Sound_Update();
+#ifdef SYNCHRONIZED_SOUND
+	if (debug_sound)
+		printf("%u bytes of sound\n", POKEYSND_frame_length);
+#endif
+#endif
+	CPU_IdleFrame();
+#ifdef MONITOR_TRACE
+	CPUTRACE_Frame();
 #endif
+	IOSTATS_Frame();
+	REWIND_Frame();
 	Atari800_nframes++;
 }
 
@@ -182,6 +206,13 @@ int libatari800_init(int argc, char **argv) {
 	return Atari800_Initialise(&argc, argv);
 }
 
+void libatari800_exit(void) {
+#ifdef SOUND
+	/* the sound file of -audio-only gets its length in the header here */
+	SndSave_CloseSoundFile();
+#endif
+}
+
 char *error_messages[] = {
 	"no error",
 	"unidentified cartridge",
@@ -212,9 +243,11 @@ void libatari800_clear_input_array(input_template_t *input)
 jmp_buf libatari800_cpu_crash;
 #endif
 
-int libatari800_next_frame(input_template_t *input)
+static int RunFrame(input_template_t *input, int draw_display)
 {
 	LIBATARI800_Input_array = input;
+	/* The caller may have changed memory through libatari800_get_main_memory_ptr. */
+	CPU_PredecodeFlush();
 	INPUT_key_code = PLATFORM_Keyboard();
 	LIBATARI800_Mouse();
 #ifdef HAVE_SETJMP
@@ -226,7 +259,7 @@ int libatari800_next_frame(input_template_t *input)
 #endif /* HAVE_SETJMP */
 	{
 		/* normal operation */
-		LIBATARI800_Frame();
+		LIBATARI800_Frame(draw_display);
 		if (CPU_cim_encountered) {
 			libatari800_error_code = LIBATARI800_CPU_CRASH;
 		}
@@ -234,15 +267,67 @@ int libatari800_next_frame(input_template_t *input)
 			libatari800_error_code = LIBATARI800_DLIST_ERROR;
 		}
 	}
-	PLATFORM_DisplayScreen();
+	if (draw_display)
+		PLATFORM_DisplayScreen();
 	return !libatari800_error_code;
 }
 
+int libatari800_next_frame(input_template_t *input)
+{
+	return RunFrame(input, !Atari800_audio_only);
+}
+
+int libatari800_run_frames(int n, input_template_t *input_schedule, frame_output_t *outputs, int flags, const run_callbacks_t *callbacks)
+{
+	static input_template_t no_input;
+	frame_output_t output;
+	audio_buffer_t audio;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		int draw_display = !Atari800_audio_only
+			&& ((flags & LIBATARI800_RUN_DRAW_ALL) || i == n - 1);
+		RunFrame(input_schedule != NULL ? &input_schedule[i] : &no_input, draw_display);
+		output.error_code = libatari800_error_code;
+		output.audio_frames = libatari800_get_audio(&audio);
+		output.screen_hash = draw_display && (flags & LIBATARI800_RUN_HASH_SCREEN) ? libatari800_get_screen_hash() : 0;
+		if (outputs != NULL)
+			outputs[i] = output;
+		if (callbacks != NULL && callbacks->frame_done != NULL
+		    && !callbacks->frame_done(callbacks->user, i, &output))
+			return i + 1;
+		if (output.error_code && (flags & LIBATARI800_RUN_STOP_ON_ERROR))
+			return i + 1;
+	}
+	return n;
+}
+
 int libatari800_mount_disk_image(int diskno, const char *filename, int readonly)
 {
 	return SIO_Mount(diskno, filename, readonly);
 }
 
+int libatari800_insert_cartridge(const char *filename, int type)
+{
+	int result = CARTRIDGE_Insert(filename);
+	if (result == CARTRIDGE_CANT_OPEN || result == CARTRIDGE_BAD_FORMAT)
+		return FALSE;
+	/* raw image of a size that several types have */
+	if (result > 0 && type > CARTRIDGE_NONE && type <= CARTRIDGE_LAST_SUPPORTED && CARTRIDGE_kb[type] == result)
+		CARTRIDGE_SetType(&CARTRIDGE_main, type);
+	if (CARTRIDGE_main.type == CARTRIDGE_UNKNOWN) {
+		CARTRIDGE_SetType(&CARTRIDGE_main, UI_SelectCartType(result));
+		return FALSE;
+	}
+	Atari800_Coldstart();
+	return TRUE;
+}
+
+int libatari800_rewind(void)
+{
+	return REWIND_Back();
+}
+
 int libatari800_reboot_with_file(const char *filename)
 {
 	int file_type;
@@ -264,6 +349,33 @@ UBYTE *libatari800_get_screen_ptr()
 	return (UBYTE *)Screen_atari;
 }
 
+uint64_t libatari800_get_screen_hash(void)
+{
+	uint64_t line_hashes[Screen_HEIGHT];
+	return LIBATARI800_Video_HashScreen(line_hashes);
+}
+
+/* line hashes at the previous libatari800_get_screen_changes */
+static uint64_t prev_line_hashes[Screen_HEIGHT];
+static int have_prev_line_hashes = FALSE;
+
+int libatari800_get_screen_changes(screen_changes_t *changes)
+{
+	uint64_t line_hashes[Screen_HEIGHT];
+	int y;
+
+	changes->hash = LIBATARI800_Video_HashScreen(line_hashes);
+	changes->changed_lines = 0;
+	for (y = 0; y < Screen_HEIGHT; y++) {
+		changes->dirty[y] = y >= Screen_visible_y1 && y < Screen_visible_y2
+			&& (!have_prev_line_hashes || line_hashes[y] != prev_line_hashes[y]);
+		changes->changed_lines += changes->dirty[y];
+	}
+	memcpy(prev_line_hashes, line_hashes, sizeof(prev_line_hashes));
+	have_prev_line_hashes = TRUE;
+	return changes->changed_lines;
+}
+
 void libatari800_get_current_state(emulator_state_t *state)
 {
 	LIBATARI800_StateSave(state->state, &state->tags);
@@ -275,6 +387,274 @@ void libatari800_restore_state(emulator_state_t *state)
 	LIBATARI800_StateLoad(state->state);
 }
 
+int libatari800_get_state_delta(UBYTE *buffer, int size)
+{
+	return (int) StateSav_SaveAtariStateDelta(buffer, size);
+}
+
+int libatari800_apply_state_delta(const UBYTE *state, int state_len, const UBYTE *delta, int delta_len, UBYTE *buffer, int size)
+{
+	return (int) StateSav_ApplyDelta(state, state_len, delta, delta_len, buffer, size);
+}
+
+int libatari800_restore_state_buffer(const UBYTE *state, int len)
+{
+	return StateSav_ReadAtariStateMem(state, len);
+}
+
+void libatari800_get_frame_status(frame_status_t *status)
+{
+	CPU_GetStatus();
+	status->PC = CPU_regPC;
+	status->A = CPU_regA;
+	status->P = CPU_regP;
+	status->S = CPU_regS;
+	status->X = CPU_regX;
+	status->Y = CPU_regY;
+	status->dlist = ANTIC_dlist;
+	status->selftest_enabled = MEMORY_selftest_enabled;
+	status->frame = Atari800_nframes;
+	status->idle_cycles = CPU_idle_frame_cycles;
+	status->memory = MEMORY_mem;
+	status->bank = MEMORY_bank_ptr;
+	status->screen = (const UBYTE *) Screen_atari;
+}
+
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND)
+static int FillAudioBuffer(audio_buffer_t *audio, const UBYTE *samples)
+{
+	audio->channels = POKEYSND_num_pokeys;
+	audio->sample_size = (POKEYSND_snd_flags & POKEYSND_BIT16) ? 2 : 1;
+	audio->freq = POKEYSND_playback_freq;
+	audio->samples = samples;
+	audio->frames = POKEYSND_frame_length / audio->channels / audio->sample_size;
+	return audio->frames;
+}
+#endif /* defined(SOUND) && defined(SYNCHRONIZED_SOUND) */
+
+int libatari800_get_audio(audio_buffer_t *audio)
+{
+	memset(audio, 0, sizeof(audio_buffer_t));
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND)
+	if (Sound_enabled)
+		return FillAudioBuffer(audio, POKEYSND_frame_buffer);
+#endif
+	return 0;
+}
+
+int libatari800_enable_audio_stems(int enable)
+{
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND) && defined(SOUND_THIN_API)
+	if (Sound_enabled) {
+		POKEYSND_SetStems(enable);
+		return TRUE;
+	}
+#endif
+	return FALSE;
+}
+
+int libatari800_get_audio_stem(int chip, audio_buffer_t *audio)
+{
+	memset(audio, 0, sizeof(audio_buffer_t));
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND) && defined(SOUND_THIN_API)
+	if (Sound_enabled) {
+		const UBYTE *stem = POKEYSND_GetFrameStem(chip);
+		if (stem != NULL) {
+			FillAudioBuffer(audio, stem);
+			return TRUE;
+		}
+	}
+#endif
+	return FALSE;
+}
+
+/* Machine contexts. The emulator keeps its machine in global variables,
+   so contexts take turns: the running machine belongs to the selected
+   context and is swapped out through the state save when another one is
+   selected. Everything that a frame depends on and that isn't in the
+   state save is swapped with it, short of the sound generators other
+   than the default POKEY engine. */
+
+struct libatari800_context {
+	/* a 130XE with the sound chips doesn't fit in emulator_state_t */
+	UBYTE *state;
+	size_t state_size;
+	size_t state_len;
+	ULONG random_counter;
+	int pot_scanline;
+	int nframes;
+	int error_code;
+	int cim_encountered;
+	int selftest_enabled;
+	/* a file being loaded by "-run" or libatari800_reboot_with_file */
+	FILE *bin_file;
+	int start_binloading;
+	int loading_basic;
+	int wait_active;
+	BINLOAD_Progress bin_progress;
+	/* the binary loader's escape sequence is on the machine's stack */
+	ESC_Table esc_table;
+	SIO_Transfer sio_transfer;
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND)
+	UBYTE *sound_state;
+	size_t sound_state_size;
+#endif
+};
+
+static libatari800_context_t *current_context = NULL;
+
+#define MAX_CONTEXT_STATE 0x1000000
+
+/* Saves the running machine into CONTEXT. Returns FALSE, leaving CONTEXT
+   without a state, if the state doesn't fit even in MAX_CONTEXT_STATE. */
+static int SaveContext(libatari800_context_t *context)
+{
+	while ((context->state_len = StateSav_SaveAtariStateMem(context->state, context->state_size)) == 0) {
+		if (context->state_size >= MAX_CONTEXT_STATE) {
+			Log_print("Cannot save the machine into its context");
+			return FALSE;
+		}
+		context->state_size = context->state_size == 0 ? STATESAV_MAX_SIZE : context->state_size * 2;
+		context->state = (UBYTE *) Util_realloc(context->state, context->state_size);
+	}
+	context->random_counter = POKEY_GetRandomCounter();
+	context->pot_scanline = POKEY_GetPotScanline();
+	context->nframes = Atari800_nframes;
+	context->error_code = libatari800_error_code;
+	context->cim_encountered = CPU_cim_encountered;
+	context->selftest_enabled = MEMORY_selftest_enabled;
+	context->bin_file = BINLOAD_bin_file;
+	context->start_binloading = BINLOAD_start_binloading;
+	context->loading_basic = BINLOAD_loading_basic;
+	context->wait_active = BINLOAD_wait_active;
+	BINLOAD_GetProgress(&context->bin_progress);
+	ESC_GetTable(&context->esc_table);
+	SIO_GetTransfer(&context->sio_transfer);
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND)
+	if (context->sound_state_size != POKEYSND_SyncStateSize()) {
+		context->sound_state_size = POKEYSND_SyncStateSize();
+		context->sound_state = (UBYTE *) Util_realloc(context->sound_state, context->sound_state_size);
+	}
+	POKEYSND_GetSyncState(context->sound_state);
+#endif
+	return TRUE;
+}
+
+libatari800_context_t *libatari800_context_new(void)
+{
+	libatari800_context_t *context = (libatari800_context_t *) Util_malloc(sizeof(libatari800_context_t));
+	context->state = NULL;
+	context->state_size = 0;
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND)
+	context->sound_state = NULL;
+	context->sound_state_size = 0;
+#endif
+	if (!SaveContext(context)) {
+		free(context->state);
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND)
+		free(context->sound_state);
+#endif
+		free(context);
+		return NULL;
+	}
+	/* the file stays with the current machine */
+	context->bin_file = NULL;
+	context->start_binloading = FALSE;
+	return context;
+}
+
+void libatari800_context_free(libatari800_context_t *context)
+{
+	if (context == current_context)
+		current_context = NULL;
+	else if (context->bin_file != NULL)
+		fclose(context->bin_file);
+	free(context->state);
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND)
+	free(context->sound_state);
+#endif
+	free(context);
+}
+
+/* Makes the machine a copy of CONTEXT, after saving the running machine
+   into the current context. Returns FALSE, with the running machine left
+   as it was, if either step fails. */
+static int LoadContext(libatari800_context_t *context)
+{
+	int selftest_enabled = MEMORY_selftest_enabled;
+
+	if (current_context != NULL && !SaveContext(current_context))
+		return FALSE;
+	MEMORY_selftest_enabled = context->selftest_enabled;
+	if (context->state_len == 0 || !StateSav_ReadAtariStateMem(context->state, context->state_len)) {
+		Log_print("Cannot switch to the machine of a context");
+		MEMORY_selftest_enabled = selftest_enabled;
+		/* in case the state was read only in part */
+		if (current_context != NULL) {
+			StateSav_ReadAtariStateMem(current_context->state, current_context->state_len);
+			ESC_SetTable(&current_context->esc_table);
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND)
+			if (current_context->sound_state_size == POKEYSND_SyncStateSize())
+				POKEYSND_SetSyncState(current_context->sound_state);
+#endif
+		}
+		return FALSE;
+	}
+	POKEY_SetRandomCounter(context->random_counter);
+	POKEY_SetPotScanline(context->pot_scanline);
+	Atari800_nframes = context->nframes;
+	libatari800_error_code = context->error_code;
+	CPU_cim_encountered = context->cim_encountered;
+	BINLOAD_bin_file = context->bin_file;
+	BINLOAD_start_binloading = context->start_binloading;
+	BINLOAD_loading_basic = context->loading_basic;
+	BINLOAD_wait_active = context->wait_active;
+	BINLOAD_SetProgress(&context->bin_progress);
+	ESC_SetTable(&context->esc_table);
+	SIO_SetTransfer(&context->sio_transfer);
+#if defined(SOUND) && defined(SYNCHRONIZED_SOUND)
+	/* the sound restarts if the state changed the sound setup */
+	if (context->sound_state_size == POKEYSND_SyncStateSize())
+		POKEYSND_SetSyncState(context->sound_state);
+#endif
+	/* the snapshots belong to the machine that was running */
+	REWIND_Reset();
+	return TRUE;
+}
+
+int libatari800_context_select(libatari800_context_t *context)
+{
+	if (context == current_context)
+		return TRUE;
+	if (!LoadContext(context))
+		return FALSE;
+	current_context = context;
+	return TRUE;
+}
+
+int libatari800_context_restore(libatari800_context_t *context)
+{
+	/* a file of a machine that belongs to no context is closed */
+	FILE *bin_file = current_context == NULL ? BINLOAD_bin_file : NULL;
+
+	if (!LoadContext(context))
+		return FALSE;
+	if (bin_file != NULL)
+		fclose(bin_file);
+	/* the file stays with the context */
+	BINLOAD_bin_file = NULL;
+	BINLOAD_start_binloading = FALSE;
+	current_context = NULL;
+	return TRUE;
+}
+
+int libatari800_context_next_frame(libatari800_context_t *context, input_template_t *input)
+{
+	if (!libatari800_context_select(context))
+		return FALSE;
+	return libatari800_next_frame(input);
+}
+
 /*
 vim:ts=4:sw=4:
 */
@@ -12,6 +12,7 @@ extern jmp_buf libatari800_cpu_crash;
 
 #include "libatari800/libatari800.h"
 
-void LIBATARI800_Frame(void);
+/* Runs one frame; the screen is only drawn if DRAW_DISPLAY. */
+void LIBATARI800_Frame(int draw_display);
 
 #endif /* LIBATARI800_VIDEO_H_ */
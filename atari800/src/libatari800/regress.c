@@ -0,0 +1,364 @@
+/* Regression test and benchmark: runs the images of a manifest for a number
+   of frames each and compares hashes of the sound they made and of the last
+   screen with the expected ones. Every image runs in a fresh worker process,
+   as the emulator keeps its machine in global variables.
+
+   Each line of a manifest holds an image (XEX, ATR, CAR or anything else
+   atari800 can start), the number of frames, the expected audio and screen
+   hashes in hex, or - to skip a check, and then any emulator options:
+
+       # image        frames  audio             screen            options
+       game.xex       600     9d3e2f41a07c55b2  03a5c6e1f2b47d90  -xl -ntsc
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifndef _WIN32
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+#include "pokey.h"
+
+#include "libatari800.h"
+
+#define MAX_IMAGES 1024
+#define MAX_OPTIONS 32
+#define MAX_LINE 1024
+
+typedef struct {
+	char line[MAX_LINE];	/* the tokens point into it */
+	char *image;
+	char path[MAX_LINE];	/* of the image, from the manifest's directory */
+	int num_frames;
+	char *audio;			/* expected hashes, "-" for none */
+	char *screen;
+	char *options[MAX_OPTIONS];
+	int num_options;
+} image_t;
+
+typedef struct {
+	int ok;					/* FALSE if the image couldn't be run */
+	int frames;
+	int error_code;
+	uint64_t audio_hash;
+	uint64_t screen_hash;
+	double audio_samples;	/* per channel */
+	double seconds;
+} result_t;
+
+static image_t images[MAX_IMAGES];
+static result_t results[MAX_IMAGES];
+
+/* 64-bit FNV-1a */
+static uint64_t hash_bytes(uint64_t hash, const UBYTE *p, int len)
+{
+	while (len-- > 0) {
+		hash ^= *p++;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+static int hash_audio(void *user, int frame, const frame_output_t *output)
+{
+	result_t *result = (result_t *) user;
+	audio_buffer_t audio;
+
+	if (libatari800_get_audio(&audio) > 0) {
+		result->audio_hash = hash_bytes(result->audio_hash, audio.samples,
+		                                audio.frames * audio.channels * audio.sample_size);
+		result->audio_samples += audio.frames;
+	}
+	return TRUE;
+}
+
+/* Boots IMAGE and runs it, in the calling process. */
+static void run_image(const image_t *image, result_t *result)
+{
+	char *args[MAX_OPTIONS + 3];
+	frame_output_t last;
+	run_callbacks_t callbacks;
+	clock_t start;
+	FILE *fp;
+	int num_args = 0;
+	int i;
+
+	args[num_args++] = "atari800";
+	/* R-Time 8 reads the host clock */
+	args[num_args++] = "-nortime";
+	for (i = 0; i < image->num_options; i++)
+		args[num_args++] = image->options[i];
+	args[num_args++] = (char *) image->path;
+
+	memset(result, 0, sizeof(result_t));
+	result->audio_hash = 0xcbf29ce484222325ULL;
+	/* the emulator would just boot without it */
+	fp = fopen(image->path, "rb");
+	if (fp == NULL)
+		return;
+	fclose(fp);
+	result->ok = libatari800_init(num_args, args);
+	result->error_code = libatari800_error_code;
+	if (!result->ok)
+		return;
+	/* the random generator is seeded with the host time */
+	POKEY_SetRandomCounter(0);
+
+	memset(&last, 0, sizeof(last));
+	callbacks.frame_done = hash_audio;
+	callbacks.user = result;
+	start = clock();
+	result->frames = 0;
+	while (result->frames < image->num_frames) {
+		/* a block of frames at a time, drawing only the last screen */
+		int n = image->num_frames - result->frames;
+		frame_output_t outputs[100];
+		if (n > 100)
+			n = 100;
+		libatari800_run_frames(n, NULL, outputs, LIBATARI800_RUN_HASH_SCREEN, &callbacks);
+		last = outputs[n - 1];
+		result->frames += n;
+	}
+	result->seconds = (double) (clock() - start) / CLOCKS_PER_SEC;
+	result->screen_hash = last.screen_hash;
+	result->error_code = last.error_code;
+	libatari800_exit();
+}
+
+#ifndef _WIN32
+/* Runs the images in up to JOBS worker processes at a time, one process per
+   image. A worker sends its result through a pipe. */
+static void run_images_parallel(int num_images, int jobs, int verbose)
+{
+	int fd[MAX_IMAGES];
+	pid_t pid[MAX_IMAGES];
+	int next = 0;
+	int running = 0;
+	int i;
+
+	fflush(stdout);
+	while (next < num_images || running > 0) {
+		if (next < num_images && running < jobs) {
+			int pipe_fd[2];
+			i = next++;
+			pid[i] = -1;
+			fd[i] = -1;
+			if (pipe(pipe_fd) < 0)
+				continue;
+			pid[i] = fork();
+			if (pid[i] == 0) {
+				close(pipe_fd[0]);
+				if (!verbose)
+					freopen("/dev/null", "w", stdout);
+				run_image(&images[i], &results[i]);
+				if (write(pipe_fd[1], &results[i], sizeof(result_t)) != sizeof(result_t))
+					_exit(1);
+				fflush(stdout);
+				_exit(0);
+			}
+			close(pipe_fd[1]);
+			if (pid[i] < 0)
+				close(pipe_fd[0]);
+			else {
+				fd[i] = pipe_fd[0];
+				running++;
+			}
+		}
+		else {
+			pid_t done = wait(NULL);
+			if (done < 0)
+				break;
+			for (i = 0; i < next; i++) {
+				if (pid[i] != done)
+					continue;
+				/* a worker that died leaves the result at 0: not run */
+				if (read(fd[i], &results[i], sizeof(result_t)) != sizeof(result_t))
+					memset(&results[i], 0, sizeof(result_t));
+				close(fd[i]);
+				pid[i] = -1;
+				running--;
+			}
+		}
+	}
+}
+#endif
+
+static void run_images(int num_images, int jobs, int verbose)
+{
+#ifdef _WIN32
+	int i;
+#endif
+
+#ifndef _WIN32
+	run_images_parallel(num_images, jobs, verbose);
+#else
+	/* one after another, in this process */
+	for (i = 0; i < num_images; i++)
+		run_image(&images[i], &results[i]);
+#endif
+}
+
+static int read_manifest(const char *filename, int num_images)
+{
+	FILE *fp = fopen(filename, "r");
+	const char *slash = strrchr(filename, '/');
+	size_t dir_len = slash == NULL ? 0 : (size_t) (slash - filename) + 1;
+	int line_no = 0;
+
+	if (fp == NULL) {
+		printf("%s: can't open\n", filename);
+		return -1;
+	}
+	while (num_images < MAX_IMAGES && fgets(images[num_images].line, MAX_LINE, fp) != NULL) {
+		image_t *image = &images[num_images];
+		char *tokens[MAX_OPTIONS + 4];
+		int num_tokens = 0;
+		size_t prefix_len;
+		char *token;
+
+		line_no++;
+		for (token = strtok(image->line, " \t\r\n"); token != NULL; token = strtok(NULL, " \t\r\n")) {
+			if (token[0] == '#')
+				break;
+			if (num_tokens < MAX_OPTIONS + 4)
+				tokens[num_tokens++] = token;
+		}
+		if (num_tokens == 0)
+			continue;
+		if (num_tokens < 4 || atoi(tokens[1]) <= 0) {
+			printf("%s:%d: expected image, frames, audio hash and screen hash\n", filename, line_no);
+			continue;
+		}
+		image->image = tokens[0];
+		prefix_len = dir_len;
+		if (tokens[0][0] == '/' || prefix_len + strlen(tokens[0]) >= MAX_LINE)
+			prefix_len = 0;
+		sprintf(image->path, "%.*s%s", (int) prefix_len, filename, tokens[0]);
+		image->num_frames = atoi(tokens[1]);
+		image->audio = tokens[2];
+		image->screen = tokens[3];
+		image->num_options = num_tokens - 4;
+		memcpy(image->options, tokens + 4, image->num_options * sizeof(char *));
+		num_images++;
+	}
+	fclose(fp);
+	return num_images;
+}
+
+static int check_hash(const char *expected, uint64_t hash)
+{
+	/* strtoull is not C89 */
+	uint64_t value = 0;
+	const char *p;
+
+	if (strcmp(expected, "-") == 0)
+		return TRUE;
+	for (p = expected; *p != '\0'; p++) {
+		const char *digits = "0123456789abcdef";
+		const char *digit = strchr(digits, *p | 0x20);
+		if (digit == NULL)
+			return FALSE;
+		value = (value << 4) | (uint64_t) (digit - digits);
+	}
+	return value == hash;
+}
+
+/* Prints the result of image I; returns TRUE if it passed. An emulation
+   error such as a CPU crash fails the image whatever the hashes. */
+static int report(int i, int record)
+{
+	image_t *image = &images[i];
+	result_t *result = &results[i];
+	double seconds = result->seconds > 0 ? result->seconds : 1e-9;
+	int passed;
+	int j;
+
+	if (record) {
+		printf("%s %d", image->image, image->num_frames);
+		if (result->ok)
+			printf(" %016llx %016llx", (unsigned long long) result->audio_hash,
+			       (unsigned long long) result->screen_hash);
+		else
+			printf(" - -");
+		for (j = 0; j < image->num_options; j++)
+			printf(" %s", image->options[j]);
+		printf("\n");
+		return result->ok;
+	}
+
+	passed = result->ok && result->error_code == 0
+		&& check_hash(image->audio, result->audio_hash)
+		&& check_hash(image->screen, result->screen_hash);
+	printf("%s: %s", image->image, passed ? "PASS" : "FAIL");
+	if (!result->ok)
+		printf(" (not run)\n");
+	else {
+		if (!check_hash(image->audio, result->audio_hash))
+			printf(" (audio %016llx)", (unsigned long long) result->audio_hash);
+		if (!check_hash(image->screen, result->screen_hash))
+			printf(" (screen %016llx)", (unsigned long long) result->screen_hash);
+		if (result->error_code) {
+			libatari800_error_code = result->error_code;
+			printf(" (%s)", libatari800_error_message());
+		}
+		printf("  %d frames  %.1f frames/s  %.0f audio samples/s\n", result->frames,
+		       result->frames / seconds, result->audio_samples / seconds);
+	}
+	return passed;
+}
+
+static void usage(void)
+{
+	printf("Usage: regress [-j jobs] [-record] [-v] manifest...\n"
+	       "\t-j jobs\t\tRun up to this many images at a time\n"
+	       "\t-record\t\tPrint the manifest with the hashes obtained\n"
+	       "\t-v\t\tShow the emulator's messages\n");
+}
+
+int main(int argc, char **argv)
+{
+	int num_images = 0;
+	int jobs = 1;
+	int record = FALSE;
+	int verbose = FALSE;
+	int failures = 0;
+	int i;
+
+#if !defined(_WIN32) && defined(_SC_NPROCESSORS_ONLN)
+	jobs = (int) sysconf(_SC_NPROCESSORS_ONLN);
+	if (jobs < 1)
+		jobs = 1;
+#endif
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+			jobs = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-record") == 0)
+			record = TRUE;
+		else if (strcmp(argv[i], "-v") == 0)
+			verbose = TRUE;
+		else if (argv[i][0] == '-') {
+			usage();
+			return 2;
+		}
+		else if ((num_images = read_manifest(argv[i], num_images)) < 0)
+			return 2;
+	}
+	if (num_images == 0) {
+		usage();
+		return 2;
+	}
+	if (jobs < 1)
+		jobs = 1;
+
+	run_images(num_images, jobs, verbose);
+	for (i = 0; i < num_images; i++) {
+		if (!report(i, record))
+			failures++;
+	}
+	if (!record)
+		printf("%d passed, %d failed\n", num_images - failures, failures);
+	return failures ? 1 : 0;
+}
@@ -24,7 +24,6 @@
 */
 
 #include "config.h"
-#include <string.h>
 
 #include "atari.h"
 #include "log.h"
@@ -35,33 +34,15 @@
 
 int debug_sound;
 
-UBYTE *LIBATARI800_Sound_array;
-
-static unsigned int hw_buffer_size = 0;
+/* There is no audio device. With SYNCHRONIZED_SOUND these are not called
+   and the program reads each frame's samples through libatari800_get_audio;
+   without it the library produces no sound. */
 
 int PLATFORM_SoundSetup(Sound_setup_t *setup)
 {
-#if 0
 	if (setup->buffer_frames == 0)
-	    /* Set buffer_frames automatically. */
+		/* Set buffer_frames automatically. */
 		setup->buffer_frames = Sound_NextPow2(setup->freq * 4 / 50);
-
-	 = setup->freq;
-	 = setup->channels;
-	 = setup->sample_size == 2;
-	 = TRUE;
-	hw_buffer_size = setup->buffer_frames * setup->sample_size * setup->channels;
-	if (hw_buffer_size == 0)
-	        return FALSE;
-	setup->buffer_frames = hw_buffer_size / setup->sample_size / setup->channels;
-#endif
-	/* fake the buffer size with known good values so that the actual 
-	calculation of buffer_frames below will produce a reasonable value */
-	hw_buffer_size = 1024 * setup->sample_size / setup->channels;
-	setup->buffer_frames = hw_buffer_size / setup->sample_size / setup->channels;
-
-	LIBATARI800_Sound_array = Util_malloc(hw_buffer_size);
-
 	return TRUE;
 }
 
@@ -79,14 +60,9 @@ void PLATFORM_SoundContinue(void)
 
 unsigned int PLATFORM_SoundAvailable(void)
 {
-	/*return buffer_frames*channels*sample_size;*/
-	return hw_buffer_size;
+	return 0;
 }
 
 void PLATFORM_SoundWrite(UBYTE const *buffer, unsigned int size)
 {
-	if (debug_sound) {
-		printf("copying %d bytes\n", size);
-	}
-	memcpy(LIBATARI800_Sound_array, buffer, size);
 }
@@ -22,7 +22,4 @@
 #define LIBATARI800_SOUND_BUFFER_FRAMES 136
 
 
-extern UBYTE *LIBATARI800_Sound_array;
-
-
 #endif /* LIBATARI800_SOUND_H_ */
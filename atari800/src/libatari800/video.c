@@ -26,6 +26,7 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "atari.h"
 #include "platform.h"
 #include "screen.h"
 #include "libatari800/video.h"
@@ -33,6 +34,89 @@
 void PLATFORM_DisplayScreen(void){
 }
 
+/* Screen hashing in the manner of xxHash64. Each line is read as
+   little-endian 64-bit words in four independent lanes, which keeps the
+   multipliers busy and gives the same hashes on every host. */
+
+#define PRIME1 0x9E3779B185EBCA87ULL
+#define PRIME2 0xC2B2AE3D27D4EB4FULL
+#define PRIME3 0x165667B19E3779F9ULL
+#define PRIME4 0x85EBCA77C2B2AE63ULL
+#define PRIME5 0x27D4EB2F165667C5ULL
+#define ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+static uint64_t Read64(const UBYTE *p)
+{
+	return (uint64_t) p[0] | ((uint64_t) p[1] << 8) | ((uint64_t) p[2] << 16)
+		| ((uint64_t) p[3] << 24) | ((uint64_t) p[4] << 32) | ((uint64_t) p[5] << 40)
+		| ((uint64_t) p[6] << 48) | ((uint64_t) p[7] << 56);
+}
+
+static uint64_t Round(uint64_t acc, uint64_t input)
+{
+	acc += input * PRIME2;
+	acc = ROTL(acc, 31);
+	return acc * PRIME1;
+}
+
+static uint64_t Merge(uint64_t hash, uint64_t value)
+{
+	hash ^= Round(0, value);
+	return ROTL(hash, 27) * PRIME1 + PRIME4;
+}
+
+static uint64_t Avalanche(uint64_t hash)
+{
+	hash ^= hash >> 33;
+	hash *= PRIME2;
+	hash ^= hash >> 29;
+	hash *= PRIME3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+static uint64_t HashLine(const UBYTE *p, int len)
+{
+	uint64_t v1 = PRIME1 + PRIME2;
+	uint64_t v2 = PRIME2;
+	uint64_t v3 = 0;
+	uint64_t v4 = 0 - PRIME1;
+	uint64_t hash;
+
+	for (; len >= 32; len -= 32, p += 32) {
+		v1 = Round(v1, Read64(p));
+		v2 = Round(v2, Read64(p + 8));
+		v3 = Round(v3, Read64(p + 16));
+		v4 = Round(v4, Read64(p + 24));
+	}
+	hash = ROTL(v1, 1) + ROTL(v2, 7) + ROTL(v3, 12) + ROTL(v4, 18);
+	for (; len >= 8; len -= 8, p += 8)
+		hash = Merge(hash, Read64(p));
+	for (; len > 0; len--, p++) {
+		hash ^= *p * PRIME5;
+		hash = ROTL(hash, 11) * PRIME1;
+	}
+	return Avalanche(hash);
+}
+
+uint64_t LIBATARI800_Video_HashScreen(uint64_t *line_hashes)
+{
+	const UBYTE *screen = (const UBYTE *) Screen_atari;
+	uint64_t hash = PRIME5;
+	int y;
+
+	for (y = 0; y < Screen_HEIGHT; y++) {
+		if (y < Screen_visible_y1 || y >= Screen_visible_y2) {
+			line_hashes[y] = 0;
+			continue;
+		}
+		line_hashes[y] = HashLine(screen + y * Screen_WIDTH + Screen_visible_x1,
+		                          Screen_visible_x2 - Screen_visible_x1);
+		hash = Merge(hash, line_hashes[y]);
+	}
+	return Avalanche(hash);
+}
+
 int LIBATARI800_Video_Initialise(int *argc, char *argv[]) {
 	return TRUE;
 }
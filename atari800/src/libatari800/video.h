@@ -2,10 +2,16 @@
 #define LIBATARI800_VIDEO_H_
 
 #include <stdio.h>
+#include <stdint.h>
 
 #include "config.h"
 
 int LIBATARI800_Video_Initialise(int *argc, char *argv[]);
 void LIBATARI800_Video_Exit(void);
 
+/* Stores a 64-bit hash of the visible part of every line of Screen_atari in
+   LINE_HASHES (Screen_HEIGHT entries, 0 for lines that can't be seen) and
+   returns the hash of the whole visible area. */
+uint64_t LIBATARI800_Video_HashScreen(uint64_t *line_hashes);
+
 #endif /* LIBATARI800_VIDEO_H_ */
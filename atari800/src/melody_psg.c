@@ -29,6 +29,7 @@
 #define COUNT_CYCLES
 
 #include "melody_psg.h"
+#include "cartridge.h"
 #include "pokeysnd.h"
 #include "atari.h"
 #include "antic.h"
@@ -247,6 +248,7 @@ void MELODY_PSG_Init(unsigned long freq17, int playback_freq, int n_pokeys, int
 	if (restore_psg_state2)
 		AYEMU_read_state(AYEMU_CHIP_MELODY_PSG_RIGHT_INDEX, &psg_state2);
 	melody_initialize(freq17, playback_freq, n_pokeys, b16, restore_psg_state ? &psg_state : NULL, restore_psg_state2 ? &psg_state2 : NULL);
+	CARTRIDGE_UpdateD5Map();
 }
 
 void MELODY_PSG_Exit(void)
@@ -286,6 +288,7 @@ void MELODY_PSG_Reset(void)
 		psg_register2 = 0x00;
 	}
 	melody_initialize(main_freq, dsprate, num_pokeys, bit16, NULL, NULL);
+	CARTRIDGE_UpdateD5Map();
 }
 
 void MELODY_PSG_Reinit(int playback_freq)
@@ -418,6 +421,7 @@ void MELODY_PSG_D5PutByte(UWORD addr, UBYTE byte)
 			else if (addr == (base_address + 0xdc)) {
 				/* base address for chip registers */
 				chip_base_addr = byte & 0xe0;
+				CARTRIDGE_UpdateD5Map();
 			}
 			else if (addr == (base_address + 0xdd)) {
 				/* configuration register */
@@ -438,6 +442,24 @@ void MELODY_PSG_D5PutByte(UWORD addr, UBYTE byte)
 	}
 }
 
+/* Returns TRUE if the Melody is enabled but none of its PSGs can be heard
+   until the next register write. */
+int MELODY_PSG_IsSilent(void)
+{
+	return MELODY_PSG_enable
+		&& (MELODY_PSG_model == MELODY_PSG_CHIP_NO || AYEMU_is_silent(AYEMU_CHIP_MELODY_PSG_LEFT_INDEX))
+		&& (MELODY_PSG_model2 == MELODY_PSG_CHIP_NO || AYEMU_is_silent(AYEMU_CHIP_MELODY_PSG_RIGHT_INDEX));
+}
+
+/* Advances the enabled PSGs by SAMPLES output samples without rendering. */
+static void skip_samples(int samples)
+{
+	if (MELODY_PSG_model != MELODY_PSG_CHIP_NO)
+		AYEMU_skip(AYEMU_CHIP_MELODY_PSG_LEFT_INDEX, samples);
+	if (MELODY_PSG_model2 != MELODY_PSG_CHIP_NO)
+		AYEMU_skip(AYEMU_CHIP_MELODY_PSG_RIGHT_INDEX, samples);
+}
+
 static UBYTE* psg_generate_samples(UBYTE *sndbuffer, int samples)
 {
 	int ticks;
@@ -448,6 +470,10 @@ static UBYTE* psg_generate_samples(UBYTE *sndbuffer, int samples)
 
 	if (( (MELODY_PSG_model != MELODY_PSG_CHIP_NO) || (MELODY_PSG_model2 != MELODY_PSG_CHIP_NO) ) && (!reset)) {
 		/*Log_print("psg_generate_samples %d", buflen);*/
+		if (MELODY_PSG_IsSilent()) {
+			skip_samples(buflen);
+			return sndbuffer + buflen * (bit16 ? 2 : 1) * pokeys_count;
+		}
 		while (buflen > 0) {
 			count = 0;
 			ticks = buflen * psg_ticks_per_sample;
@@ -553,6 +579,10 @@ static unsigned int psg_generate_sync(UBYTE *buffer_begin, UBYTE *buffer_end, un
 		ticks = int_part;
 		/*Log_print("Melody_GenerateSync");*/
 		/*Log_print("psg_ticks=%d, num_ticks=%d", ticks, num_ticks);*/
+		if (MELODY_PSG_IsSilent()) {
+			skip_samples(samples_count);
+			return samples_count * sample_size;
+		}
 		if (ticks > 0) {
 			if (MELODY_PSG_model != MELODY_PSG_CHIP_NO)
 				count = AYEMU_calculate_sample(AYEMU_CHIP_MELODY_PSG_LEFT_INDEX, ticks, psg_buffer, samples_count);
@@ -30,6 +30,7 @@ int MELODY_PSG_InSlot(UWORD addr);
 int MELODY_PSG_D5GetByte(UWORD addr, int no_side_effects);
 void MELODY_PSG_D5PutByte(UWORD addr, UBYTE byte);
 void MELODY_PSG_Process(void *sndbuffer, int sndn);
+int MELODY_PSG_IsSilent(void);
 #ifdef SYNCHRONIZED_SOUND
 unsigned int MELODY_PSG_GenerateSync(UBYTE *buffer_begin, UBYTE *buffer_end, unsigned int ticks, unsigned int sndn);
 #endif
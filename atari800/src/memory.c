@@ -34,6 +34,7 @@
 #include "roms/altirra_5200_os.h"
 #include "esc.h"
 #include "gtia.h"
+#include "iostats.h"
 #include "log.h"
 #include "memory.h"
 #include "pbi.h"
@@ -46,11 +47,21 @@
 
 UBYTE MEMORY_mem[65536 + 2];
 
+#ifdef MEMORY_DIRTY_PAGES
+#ifdef CPU_JIT
+#error The 6502 JIT stores to MEMORY_mem without marking dirty pages
+#endif
+UBYTE MEMORY_dirty[256];
+#endif
+
 int MEMORY_ram_size = 64;
 
 #ifndef PAGED_ATTRIB
 
 UBYTE MEMORY_attrib[65536];
+#ifdef MEMORY_DIRTY_PAGES
+UBYTE MEMORY_attrib_dirty[256];
+#endif
 
 #else /* PAGED_ATTRIB */
 
@@ -91,6 +102,54 @@ int MEMORY_cartA0BF_enabled = FALSE;
 static UBYTE *atarixe_memory = NULL;
 static ULONG atarixe_memory_size = 0;
 
+#ifdef MEMORY_DIRTY_PAGES
+/* Pages changed since the last state delta, like MEMORY_dirty. */
+static UBYTE under_atarixl_os_dirty[sizeof(under_atarixl_os) >> 8];
+static UBYTE under_cartA0BF_dirty[sizeof(under_cartA0BF) >> 8];
+static UBYTE *atarixe_dirty = NULL;
+#ifdef PAGED_ATTRIB
+/* MEMORY_attrib as saved, for the pages whose MEMORY_writemap entry was
+   last seen as attrib_image_writemap */
+static UBYTE attrib_image[65536];
+static MEMORY_wrfunc attrib_image_writemap[256];
+static int attrib_image_valid = FALSE;
+static UBYTE attrib_dirty[256];
+#else
+#define attrib_dirty MEMORY_attrib_dirty
+#endif
+/* OFFSET and SIZE are multiples of 256. */
+#define MARK_DIRTY(flags, offset, size) memset((flags) + ((offset) >> 8), 1, (size) >> 8)
+#define DIRTY(flags) (flags)
+#else
+#define MARK_DIRTY(flags, offset, size)
+#define DIRTY(flags) NULL
+#endif
+
+#ifdef XE_BANK_PTR
+UBYTE *MEMORY_bank_ptr = MEMORY_mem + 0x4000;
+
+/* Number of the XE or Axlon bank whose contents are held in
+   MEMORY_mem[0x4000..0x7fff]; all other banks live in atarixe_memory or
+   axlon_ram. State files store the bank selected by the CPU there. */
+static int window_bank = 0;
+/* Value of window_bank after reading a state file older than version 7,
+   whose PORTB is only known later: the bank the CPU had selected. */
+#define WINDOW_BANK_CPU (-1)
+
+/* Returns the memory of XE bank BANK (0 = base RAM). */
+static UBYTE *xe_bank_ptr(int bank)
+{
+	return bank == window_bank ? MEMORY_mem + 0x4000 : atarixe_memory + (bank << 14);
+}
+#else /* XE_BANK_PTR */
+/* Returns the memory of XE bank BANK (0 = base RAM) while it is not the
+   bank selected by the CPU. */
+#define xe_bank_ptr(bank) (atarixe_memory + ((bank) << 14))
+#endif /* XE_BANK_PTR */
+
+/* TRUE if ANTIC sees a different 0x4000-0x7fff bank than the CPU. */
+#define ANTIC_SEPARATE_BANK ((ANTIC_xe_ptr != NULL ? ANTIC_xe_ptr : MEMORY_mem + 0x4000) != MEMORY_bank_ptr)
+
 /* RAM shadowed by Self-Test in the XE bank seen by ANTIC, when ANTIC/CPU
    separate XE access is active. */
 static UBYTE antic_bank_under_selftest[0x800];
@@ -107,6 +166,13 @@ static int axlon_current_bankmask = 0;
 int axlon_curbank = 0;
 int MEMORY_axlon_num_banks = 0x00;
 int MEMORY_axlon_0f_mirror = FALSE; /* The real Axlon had a mirror bank register at 0x0fc0-0x0fff, compatibles did not*/
+#ifdef XE_BANK_PTR
+/* Returns the memory of Axlon bank BANK. */
+static UBYTE *axlon_bank_ptr(int bank)
+{
+	return bank == window_bank ? MEMORY_mem + 0x4000 : axlon_ram + bank * 0x4000;
+}
+#endif /* XE_BANK_PTR */
 static UBYTE *mosaic_ram = NULL;
 static int mosaic_current_num_banks = 0;
 static int mosaic_curbank = 0x3f;
@@ -163,6 +229,10 @@ static void AllocXEMemory(void)
 			atarixe_memory = (UBYTE *) Util_malloc(size);
 			atarixe_memory_size = size;
 			memset(atarixe_memory, 0, size);
+#ifdef MEMORY_DIRTY_PAGES
+			atarixe_dirty = (UBYTE *) Util_realloc(atarixe_dirty, size >> 8);
+			memset(atarixe_dirty, 1, size >> 8);
+#endif
 		}
 	}
 	/* atarixe_memory not needed, free it */
@@ -170,6 +240,10 @@ static void AllocXEMemory(void)
 		free(atarixe_memory);
 		atarixe_memory = NULL;
 		atarixe_memory_size = 0;
+#ifdef MEMORY_DIRTY_PAGES
+		free(atarixe_dirty);
+		atarixe_dirty = NULL;
+#endif
 	}
 }
 
@@ -186,6 +260,30 @@ static void AllocMapRAM(void)
 	}
 }
 
+#ifdef MEMORY_DIRTY_PAGES
+void MEMORY_DirtyRange(UWORD addr, int size)
+{
+	int page;
+	for (page = addr >> 8; page <= (addr + size - 1) >> 8; page++)
+		MEMORY_dirty[page & 0xff] = 1;
+}
+
+static void MarkAllDirty(void)
+{
+	memset(MEMORY_dirty, 1, sizeof(MEMORY_dirty));
+	memset(attrib_dirty, 1, sizeof(attrib_dirty));
+#ifdef PAGED_ATTRIB
+	attrib_image_valid = FALSE;
+#endif
+	memset(under_atarixl_os_dirty, 1, sizeof(under_atarixl_os_dirty));
+	memset(under_cartA0BF_dirty, 1, sizeof(under_cartA0BF_dirty));
+	if (atarixe_dirty != NULL)
+		memset(atarixe_dirty, 1, atarixe_memory_size >> 8);
+}
+#else
+#define MarkAllDirty()
+#endif
+
 int MEMORY_SizeValid(int size)
 {
 	return size == 8 || size == 16 || size == 24 || size == 32
@@ -201,6 +299,10 @@ void MEMORY_InitialiseMachine(void)
 	                    : 0x4000;
 	int const os_rom_start = 0x10000 - os_size;
 	ANTIC_xe_ptr = NULL;
+#ifdef XE_BANK_PTR
+	MEMORY_bank_ptr = MEMORY_mem + 0x4000;
+	window_bank = 0;
+#endif
 	cart809F_enabled = FALSE;
 	MEMORY_cartA0BF_enabled = FALSE;
 	if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
@@ -334,11 +436,35 @@ void MEMORY_InitialiseMachine(void)
 	axlon_curbank = 0;
 	mosaic_curbank = 0x3f;
 	AllocMapRAM();
+	MarkAllDirty();
+	CPU_PredecodeFlush();
 	Atari800_Coldstart();
 }
 
 #ifndef BASIC
 
+#ifdef PAGED_ATTRIB
+/* Fills the 256 bytes of MEMORY_attrib that page I would have. */
+static void GetAttribPage(int i, UBYTE *attrib_page)
+{
+	if (MEMORY_writemap[i] == NULL)
+		memset(attrib_page, MEMORY_RAM, 256);
+	else if (MEMORY_writemap[i] == MEMORY_ROM_PutByte)
+		memset(attrib_page, MEMORY_ROM, 256);
+	else if (i == 0x4f || i == 0x5f || i == 0x8f || i == 0x9f) {
+		/* special case: Bounty Bob bank switching registers */
+		memset(attrib_page, MEMORY_ROM, 256);
+		attrib_page[0xf6] = MEMORY_HARDWARE;
+		attrib_page[0xf7] = MEMORY_HARDWARE;
+		attrib_page[0xf8] = MEMORY_HARDWARE;
+		attrib_page[0xf9] = MEMORY_HARDWARE;
+	}
+	else {
+		memset(attrib_page, MEMORY_HARDWARE, 256);
+	}
+}
+#endif /* PAGED_ATTRIB */
+
 void MEMORY_StateSave(UBYTE SaveVerbose)
 {
 	int temp;
@@ -350,7 +476,17 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 		if (MEMORY_axlon_num_banks > 0){
 			StateSav_SaveINT(&axlon_curbank, 1);
 			StateSav_SaveINT(&MEMORY_axlon_0f_mirror, 1);
+#ifdef XE_BANK_PTR
+			{
+				/* The current bank is saved with the base RAM, as if
+				   it had been copied there. */
+				int i;
+				for (i = 0; i < MEMORY_axlon_num_banks; i++)
+					StateSav_SaveUBYTE(i == axlon_curbank ? axlon_ram + i * 0x4000 : axlon_bank_ptr(i), 0x4000);
+			}
+#else
 			StateSav_SaveUBYTE(axlon_ram, MEMORY_axlon_num_banks * 0x4000);
+#endif
 		}
 		StateSav_SaveINT(&mosaic_current_num_banks, 1);
 		if (mosaic_current_num_banks > 0) {
@@ -363,10 +499,37 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 	temp = MEMORY_ram_size > 64 ? 64 : MEMORY_ram_size;
 	StateSav_SaveINT(&temp, 1);
 	STATESAV_TAG(base_ram);
-	StateSav_SaveUBYTE(&MEMORY_mem[0], 65536);
+#ifdef XE_BANK_PTR
+#ifdef MEMORY_DIRTY_PAGES
+	if (MEMORY_bank_ptr >= atarixe_memory && MEMORY_bank_ptr < atarixe_memory + atarixe_memory_size) {
+		/* The bank seen by the CPU is also saved with the XE banks. */
+		int i;
+		for (i = 0; i < 0x40; i++)
+			atarixe_dirty[((MEMORY_bank_ptr - atarixe_memory) >> 8) + i] |= MEMORY_dirty[0x40 + i];
+	}
+#endif
+	StateSav_SavePages(&MEMORY_mem[0], 0x4000, DIRTY(MEMORY_dirty));
+	StateSav_SavePages(MEMORY_bank_ptr, 0x4000, DIRTY(MEMORY_dirty + 0x40));
+	StateSav_SavePages(&MEMORY_mem[0x8000], 0x8000, DIRTY(MEMORY_dirty + 0x80));
+#else
+	StateSav_SavePages(&MEMORY_mem[0], 65536, DIRTY(MEMORY_dirty));
+#endif
 	STATESAV_TAG(base_ram_attrib);
 #ifndef PAGED_ATTRIB
-	StateSav_SaveUBYTE(&MEMORY_attrib[0], 65536);
+	StateSav_SavePages(&MEMORY_attrib[0], 65536, DIRTY(attrib_dirty));
+#elif defined(MEMORY_DIRTY_PAGES)
+	{
+		int i;
+		for (i = 0; i < 256; i++) {
+			if (!attrib_image_valid || MEMORY_writemap[i] != attrib_image_writemap[i]) {
+				GetAttribPage(i, attrib_image + (i << 8));
+				attrib_image_writemap[i] = MEMORY_writemap[i];
+				attrib_dirty[i] = 1;
+			}
+		}
+		attrib_image_valid = TRUE;
+		StateSav_SavePages(attrib_image, 65536, attrib_dirty);
+	}
 #else
 	{
 		/* I assume here that consecutive calls to StateSav_SaveUBYTE()
@@ -375,21 +538,7 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 		UBYTE attrib_page[256];
 		int i;
 		for (i = 0; i < 256; i++) {
-			if (MEMORY_writemap[i] == NULL)
-				memset(attrib_page, MEMORY_RAM, 256);
-			else if (MEMORY_writemap[i] == MEMORY_ROM_PutByte)
-				memset(attrib_page, MEMORY_ROM, 256);
-			else if (i == 0x4f || i == 0x5f || i == 0x8f || i == 0x9f) {
-				/* special case: Bounty Bob bank switching registers */
-				memset(attrib_page, MEMORY_ROM, 256);
-				attrib_page[0xf6] = MEMORY_HARDWARE;
-				attrib_page[0xf7] = MEMORY_HARDWARE;
-				attrib_page[0xf8] = MEMORY_HARDWARE;
-				attrib_page[0xf9] = MEMORY_HARDWARE;
-			}
-			else {
-				memset(attrib_page, MEMORY_HARDWARE, 256);
-			}
+			GetAttribPage(i, attrib_page);
 			StateSav_SaveUBYTE(&attrib_page[0], 256);
 		}
 	}
@@ -398,11 +547,11 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 	if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
 		if (SaveVerbose != 0)
 			StateSav_SaveUBYTE(&MEMORY_basic[0], 8192);
-		StateSav_SaveUBYTE(&under_cartA0BF[0], 8192);
+		StateSav_SavePages(&under_cartA0BF[0], 8192, DIRTY(under_cartA0BF_dirty));
 
 		if (SaveVerbose != 0)
 			StateSav_SaveUBYTE(&MEMORY_os[0], 16384);
-		StateSav_SaveUBYTE(&under_atarixl_os[0], 16384);
+		StateSav_SavePages(&under_atarixl_os[0], 16384, DIRTY(under_atarixl_os_dirty));
 		if (SaveVerbose != 0)
 			StateSav_SaveUBYTE(MEMORY_xegame, 0x2000);
 	}
@@ -423,8 +572,19 @@ void MEMORY_StateSave(UBYTE SaveVerbose)
 	StateSav_SaveINT(&MEMORY_cartA0BF_enabled, 1);
 
 	if (MEMORY_ram_size > 64) {
-		StateSav_SaveUBYTE(&atarixe_memory[0], atarixe_memory_size);
-		if (ANTIC_xe_ptr != NULL && MEMORY_selftest_enabled)
+#ifdef XE_BANK_PTR
+		int i;
+		for (i = 0; i < (int) (atarixe_memory_size >> 14); i++) {
+			UBYTE *bank = xe_bank_ptr(i);
+			/* The bank seen by the CPU is saved with the base RAM. */
+			if (bank == MEMORY_bank_ptr)
+				bank = atarixe_memory + (i << 14);
+			StateSav_SavePages(bank, 0x4000, DIRTY(atarixe_dirty + (i << 6)));
+		}
+#else
+		StateSav_SavePages(&atarixe_memory[0], atarixe_memory_size, DIRTY(atarixe_dirty));
+#endif
+		if (ANTIC_SEPARATE_BANK && MEMORY_selftest_enabled)
 			StateSav_SaveUBYTE(antic_bank_under_selftest, 0x800);
 	}
 
@@ -481,6 +641,11 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 		/* Read amount of base RAM in kilobytes. */
 		StateSav_ReadINT(&base_ram_kb, 1);
 	StateSav_ReadUBYTE(&MEMORY_mem[0], 65536);
+#ifdef XE_BANK_PTR
+	/* The bank selected by the CPU is stored in base RAM. */
+	MEMORY_bank_ptr = MEMORY_mem + 0x4000;
+	window_bank = Atari800_machine_type == Atari800_MACHINE_800 ? axlon_curbank : WINDOW_BANK_CPU;
+#endif
 #ifndef PAGED_ATTRIB
 	StateSav_ReadUBYTE(&MEMORY_attrib[0], 65536);
 #else
@@ -627,6 +792,10 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 			}
 		}
 		/* In savestate version <= 6 this variable is read in PIA_StateRead. */
+#ifdef XE_BANK_PTR
+		if (MEMORY_ram_size > 64)
+			window_bank = (portb & 0x10) ? 0 : MEMORY_xe_bank;
+#endif
 		MEMORY_selftest_enabled = (portb & 0x81) == 0x01
 		                          && !((portb & 0x30) != 0x30 && MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP)
 		                          && !((portb & 0x10) == 0 && MEMORY_ram_size == 1088);
@@ -678,6 +847,8 @@ void MEMORY_StateRead(UBYTE SaveVerbose, UBYTE StateVersion)
 			StateSav_ReadUBYTE(mapram_memory, 0x800);
 		}
 	}
+	MarkAllDirty();
+	CPU_PredecodeFlush();
 }
 
 #endif /* BASIC */
@@ -699,6 +870,53 @@ void MEMORY_CopyToMem(const UBYTE *from, UWORD to, int size)
 	}
 }
 
+#ifdef XE_BANK_PTR
+/* Returns the number of bytes from ADDR, but at most SIZE, that are
+   contiguous in host memory. */
+static int contiguous_size(unsigned int addr, int size)
+{
+	unsigned int end = addr < 0x4000 ? 0x4000 : addr < 0x8000 ? 0x8000 : 0x10002;
+	return end - addr < (unsigned int) size ? (int) (end - addr) : size;
+}
+
+void MEMORY_dCopyFromMem(UWORD from, UBYTE *to, int size)
+{
+	unsigned int addr = from;
+	while (size > 0) {
+		int n = contiguous_size(addr, size);
+		memcpy(to, MEMORY_dPtr(addr), n);
+		addr += n;
+		to += n;
+		size -= n;
+	}
+}
+
+void MEMORY_dCopyToMem(const UBYTE *from, UWORD to, int size)
+{
+	unsigned int addr = to;
+	MEMORY_STORE_RANGE(to, size);
+	while (size > 0) {
+		int n = contiguous_size(addr, size);
+		memcpy(MEMORY_dPtr(addr), from, n);
+		addr += n;
+		from += n;
+		size -= n;
+	}
+}
+
+void MEMORY_dFillMem(UWORD addr1, UBYTE value, int length)
+{
+	unsigned int addr = addr1;
+	MEMORY_STORE_RANGE(addr1, length);
+	while (length > 0) {
+		int n = contiguous_size(addr, length);
+		memset(MEMORY_dPtr(addr), value, n);
+		addr += n;
+		length -= n;
+	}
+}
+#endif /* XE_BANK_PTR */
+
 
 /* Returns NULL if both builtin BASIC and XEGS game are disabled.
    Otherwise returns a pointer to an 8KB array containing either
@@ -730,6 +948,9 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 	int mapram_selected = FALSE;
 	int new_mapram_selected = FALSE;
 
+	/* Any of 0x4000-0xffff may change. */
+	CPU_PredecodeInvalidate(0x4000, 0xc000);
+
 	/* MapRAM is selected if RAM > 20 KB, Self Test is enabled while OS ROM is disabled,
 	   and both CPU & ANTIC have access to base RAM. */
 	if (mapram_memory != NULL && MEMORY_ram_size > 20) {
@@ -739,8 +960,9 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 
 	if (mapram_selected && !new_mapram_selected) {
 		/* Restore RAM hidden by MapRAM. */
-		memcpy(mapram_memory, MEMORY_mem + 0x5000, 0x800);
-		memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
+		memcpy(mapram_memory, MEMORY_bank_ptr + 0x1000, 0x800);
+		memcpy(MEMORY_bank_ptr + 0x1000, under_atarixl_os + 0x1000, 0x800);
+		MEMORY_DirtyRange(0x5000, 0x800);
 	}
 
 	/* Switch XE memory bank in 0x4000-0x7fff */
@@ -774,6 +996,10 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		new_cpu_bank = (byte & 0x10) ? 0 : bank;
 		antic_bank = (oldval & 0x20) ? 0 : MEMORY_xe_bank;
 		new_antic_bank = (byte & 0x20) ? 0 : bank;
+#ifdef XE_BANK_PTR
+		if (window_bank == WINDOW_BANK_CPU)
+			window_bank = cpu_bank;
+#endif
 
 		/* Note: in Compy Shop bit 5 (ANTIC access) disables Self Test */
 		if (MEMORY_selftest_enabled
@@ -781,20 +1007,43 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		        || antic_bank != new_antic_bank
 		        || (MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP && (byte & 0x20) == 0))) {
 			/* Disable Self Test ROM */
-			memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
-			if (ANTIC_xe_ptr != NULL)
+			memcpy(MEMORY_bank_ptr + 0x1000, under_atarixl_os + 0x1000, 0x800);
+			MEMORY_DirtyRange(0x5000, 0x800);
+			if (ANTIC_SEPARATE_BANK) {
 				/* Also disable Self Test from XE bank accessed by ANTIC. */
-				memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
+				memcpy(xe_bank_ptr(antic_bank) + 0x1000, antic_bank_under_selftest, 0x800);
+				MARK_DIRTY(atarixe_dirty, (antic_bank << 14) + 0x1000, 0x800);
+			}
 			MEMORY_SetRAM(0x5000, 0x57ff);
 			MEMORY_selftest_enabled = FALSE;
 		}
+#ifdef XE_BANK_PTR
+		if (cpu_bank != new_cpu_bank) {
+			/* The banks may move between MEMORY_mem and atarixe_memory
+			   in the state save; see MEMORY_StateSave. */
+			MEMORY_DirtyRange(0x4000, 0x4000);
+			MARK_DIRTY(atarixe_dirty, cpu_bank << 14, 0x4000);
+			MARK_DIRTY(atarixe_dirty, new_cpu_bank << 14, 0x4000);
+		}
+		MEMORY_bank_ptr = xe_bank_ptr(new_cpu_bank);
+		/* ANTIC reads memory through ANTIC_xe_ptr unless it is in MEMORY_mem. */
+		if (MEMORY_ram_size == 128 || MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP)
+			ANTIC_xe_ptr = xe_bank_ptr(new_antic_bank);
+		else
+			ANTIC_xe_ptr = MEMORY_bank_ptr;
+		if (ANTIC_xe_ptr == MEMORY_mem + 0x4000)
+			ANTIC_xe_ptr = NULL;
+#else
 		if (cpu_bank != new_cpu_bank) {
 			memcpy(atarixe_memory + (cpu_bank << 14), MEMORY_mem + 0x4000, 0x4000);
 			memcpy(MEMORY_mem + 0x4000, atarixe_memory + (new_cpu_bank << 14), 0x4000);
+			MARK_DIRTY(atarixe_dirty, cpu_bank << 14, 0x4000);
+			MEMORY_DirtyRange(0x4000, 0x4000);
 		}
 
 		if (MEMORY_ram_size == 128 || MEMORY_ram_size == MEMORY_RAM_320_COMPY_SHOP)
 			ANTIC_xe_ptr = new_antic_bank == new_cpu_bank ? NULL : atarixe_memory + (new_antic_bank << 14);
+#endif
 
 		MEMORY_xe_bank = bank;
 		antic_bank = new_antic_bank;
@@ -807,11 +1056,15 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 			if (MEMORY_ram_size > 48) {
 				memcpy(under_atarixl_os, MEMORY_mem + 0xc000, 0x1000);
 				memcpy(under_atarixl_os + 0x1800, MEMORY_mem + 0xd800, 0x2800);
+				MARK_DIRTY(under_atarixl_os_dirty, 0, 0x1000);
+				MARK_DIRTY(under_atarixl_os_dirty, 0x1800, 0x2800);
 				MEMORY_SetROM(0xc000, 0xcfff);
 				MEMORY_SetROM(0xd800, 0xffff);
 			}
 			memcpy(MEMORY_mem + 0xc000, MEMORY_os, 0x1000);
 			memcpy(MEMORY_mem + 0xd800, MEMORY_os + 0x1800, 0x2800);
+			MEMORY_DirtyRange(0xc000, 0x1000);
+			MEMORY_DirtyRange(0xd800, 0x2800);
 			ESC_PatchOS();
 		}
 		else {
@@ -819,6 +1072,8 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 			if (MEMORY_ram_size > 48) {
 				memcpy(MEMORY_mem + 0xc000, under_atarixl_os, 0x1000);
 				memcpy(MEMORY_mem + 0xd800, under_atarixl_os + 0x1800, 0x2800);
+				MEMORY_DirtyRange(0xc000, 0x1000);
+				MEMORY_DirtyRange(0xd800, 0x2800);
 				MEMORY_SetRAM(0xc000, 0xcfff);
 				MEMORY_SetRAM(0xd800, 0xffff);
 			} else {
@@ -828,10 +1083,13 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 			/* When OS ROM is disabled we also have to disable Self Test - Jindroush */
 			if (MEMORY_selftest_enabled) {
 				if (MEMORY_ram_size > 20) {
-					memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
-					if (ANTIC_xe_ptr != NULL)
+					memcpy(MEMORY_bank_ptr + 0x1000, under_atarixl_os + 0x1000, 0x800);
+					MEMORY_DirtyRange(0x5000, 0x800);
+					if (ANTIC_SEPARATE_BANK) {
 						/* Also disable Self Test from XE bank accessed by ANTIC. */
-						memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
+						memcpy(xe_bank_ptr(antic_bank) + 0x1000, antic_bank_under_selftest, 0x800);
+						MARK_DIRTY(atarixe_dirty, (antic_bank << 14) + 0x1000, 0x800);
+					}
 					MEMORY_SetRAM(0x5000, 0x57ff);
 				}
 				else
@@ -848,18 +1106,22 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		if (builtin_cart_old != builtin_cart_new) {
 			if (builtin_cart_old == NULL && MEMORY_ram_size > 40) { /* switching RAM out */
 				memcpy(under_cartA0BF, MEMORY_mem + 0xa000, 0x2000);
+				MARK_DIRTY(under_cartA0BF_dirty, 0, 0x2000);
 				MEMORY_SetROM(0xa000, 0xbfff);
 			}
 			if (builtin_cart_new == NULL) { /* switching RAM in */
 				if (MEMORY_ram_size > 40) {
 					memcpy(MEMORY_mem + 0xa000, under_cartA0BF, 0x2000);
+					MEMORY_DirtyRange(0xa000, 0x2000);
 					MEMORY_SetRAM(0xa000, 0xbfff);
 				}
 				else
 					MEMORY_dFillMem(0xa000, 0xff, 0x2000);
 			}
-			else
+			else {
 				memcpy(MEMORY_mem + 0xa000, builtin_cart_new, 0x2000);
+				MEMORY_DirtyRange(0xa000, 0x2000);
+			}
 		}
 	}
 
@@ -868,10 +1130,13 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		if (MEMORY_selftest_enabled) {
 			/* Disable Self Test ROM */
 			if (MEMORY_ram_size > 20) {
-				memcpy(MEMORY_mem + 0x5000, under_atarixl_os + 0x1000, 0x800);
-				if (ANTIC_xe_ptr != NULL)
+				memcpy(MEMORY_bank_ptr + 0x1000, under_atarixl_os + 0x1000, 0x800);
+				MEMORY_DirtyRange(0x5000, 0x800);
+				if (ANTIC_SEPARATE_BANK) {
 					/* Also disable Self Test from XE bank accessed by ANTIC. */
-					memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, antic_bank_under_selftest, 0x800);
+					memcpy(xe_bank_ptr(antic_bank) + 0x1000, antic_bank_under_selftest, 0x800);
+					MARK_DIRTY(atarixe_dirty, (antic_bank << 14) + 0x1000, 0x800);
+				}
 				MEMORY_SetRAM(0x5000, 0x57ff);
 			}
 			else
@@ -888,22 +1153,28 @@ void MEMORY_HandlePORTB(UBYTE byte, UBYTE oldval)
 		&& !((byte & 0x10) == 0 && MEMORY_ram_size == 1088)) {
 			/* Enable Self Test ROM */
 			if (MEMORY_ram_size > 20) {
-				memcpy(under_atarixl_os + 0x1000, MEMORY_mem + 0x5000, 0x800);
-				if (ANTIC_xe_ptr != NULL)
+				memcpy(under_atarixl_os + 0x1000, MEMORY_bank_ptr + 0x1000, 0x800);
+				MARK_DIRTY(under_atarixl_os_dirty, 0x1000, 0x800);
+				if (ANTIC_SEPARATE_BANK)
 					/* Also backup RAM under Self Test from XE bank accessed by ANTIC. */
-					memcpy(antic_bank_under_selftest, atarixe_memory + (antic_bank << 14) + 0x1000, 0x800);
+					memcpy(antic_bank_under_selftest, xe_bank_ptr(antic_bank) + 0x1000, 0x800);
 				MEMORY_SetROM(0x5000, 0x57ff);
 			}
-			memcpy(MEMORY_mem + 0x5000, MEMORY_os + 0x1000, 0x800);
-			if (ANTIC_xe_ptr != NULL)
+			memcpy(MEMORY_bank_ptr + 0x1000, MEMORY_os + 0x1000, 0x800);
+			MEMORY_DirtyRange(0x5000, 0x800);
+			if (ANTIC_SEPARATE_BANK) {
 				/* Also enable Self Test in the XE bank accessed by ANTIC. */
-				memcpy(atarixe_memory + (antic_bank << 14) + 0x1000, MEMORY_os + 0x1000, 0x800);
+				memcpy(xe_bank_ptr(antic_bank) + 0x1000, MEMORY_os + 0x1000, 0x800);
+				MARK_DIRTY(atarixe_dirty, (antic_bank << 14) + 0x1000, 0x800);
+			}
 			MEMORY_selftest_enabled = TRUE;
 		}
 		else if (!mapram_selected && new_mapram_selected) {
 			/* Enable MapRAM */
-			memcpy(under_atarixl_os + 0x1000, MEMORY_mem + 0x5000, 0x800);
-			memcpy(MEMORY_mem + 0x5000, mapram_memory, 0x800);
+			memcpy(under_atarixl_os + 0x1000, MEMORY_bank_ptr + 0x1000, 0x800);
+			memcpy(MEMORY_bank_ptr + 0x1000, mapram_memory, 0x800);
+			MARK_DIRTY(under_atarixl_os_dirty, 0x1000, 0x800);
+			MEMORY_DirtyRange(0x5000, 0x800);
 		}
 	}
 }
@@ -942,6 +1213,8 @@ static void MosaicPutByte(UWORD addr, UBYTE byte)
 		memcpy(MEMORY_mem + 0xc000, mosaic_ram + newbank*0x1000, 0x1000);
 		MEMORY_SetRAM(0xc000, 0xcfff);
 	}
+	CPU_PredecodeInvalidate(0xc000, 0x1000);
+	MEMORY_DirtyRange(0xc000, 0x1000);
 	mosaic_curbank = newbank;
 }
 
@@ -968,15 +1241,22 @@ static void AxlonPutByte(UWORD addr, UBYTE byte)
 {
 	int newbank;
 	/*Write-through to RAM if it is the page 0x0f shadow*/
-	if ((addr&0xff00) == 0x0f00) MEMORY_mem[addr] = byte;
+	if ((addr&0xff00) == 0x0f00) MEMORY_dPutByte(addr, byte);
 	if ((addr&0xff) < 0xc0) return; /*0xffc0-0xffff and 0x0fc0-0x0fff only*/
 #ifdef DEBUG
 	Log_print("AxlonPutByte:%4X:%2X", addr, byte);
 #endif
 	newbank = (byte&axlon_current_bankmask);
 	if (newbank == axlon_curbank) return;
+#ifdef XE_BANK_PTR
+	MEMORY_bank_ptr = axlon_bank_ptr(newbank);
+	ANTIC_xe_ptr = MEMORY_bank_ptr == MEMORY_mem + 0x4000 ? NULL : MEMORY_bank_ptr;
+#else
 	memcpy(axlon_ram + axlon_curbank*0x4000, MEMORY_mem + 0x4000, 0x4000);
 	memcpy(MEMORY_mem + 0x4000, axlon_ram + newbank*0x4000, 0x4000);
+#endif
+	CPU_PredecodeInvalidate(0x4000, 0x4000);
+	MEMORY_DirtyRange(0x4000, 0x4000);
 	axlon_curbank = newbank;
 }
 
@@ -997,6 +1277,8 @@ void MEMORY_Cart809fDisable(void)
 		}
 		else
 			MEMORY_dFillMem(0x8000, 0xff, 0x2000);
+		CPU_PredecodeInvalidate(0x8000, 0x2000);
+		MEMORY_DirtyRange(0x8000, 0x2000);
 		cart809F_enabled = FALSE;
 	}
 }
@@ -1028,6 +1310,8 @@ void MEMORY_CartA0bfDisable(void)
 		}
 		else
 			memcpy(MEMORY_mem + 0xa000, builtin, 0x2000);
+		CPU_PredecodeInvalidate(0xa000, 0x2000);
+		MEMORY_DirtyRange(0xa000, 0x2000);
 		MEMORY_cartA0BF_enabled = FALSE;
 		if (Atari800_machine_type == Atari800_MACHINE_XLXE) {
 			GTIA_TRIG[3] = 0;
@@ -1045,6 +1329,7 @@ void MEMORY_CartA0bfEnable(void)
 		if (MEMORY_ram_size > 40 && builtin_cart(PIA_PORTB | PIA_PORTB_mask) == NULL) {
 			/* Back-up 0xa000-0xbfff RAM */
 			memcpy(under_cartA0BF, MEMORY_mem + 0xa000, 0x2000);
+			MARK_DIRTY(under_cartA0BF_dirty, 0, 0x2000);
 			MEMORY_SetROM(0xa000, 0xbfff);
 		}
 		MEMORY_cartA0BF_enabled = TRUE;
@@ -1065,6 +1350,8 @@ void MEMORY_GetCharset(UBYTE *cs)
 UBYTE MEMORY_HwGetByte(UWORD addr, int no_side_effects)
 {
 	UBYTE byte = 0xff;
+	if (IOSTATS_enabled && !no_side_effects)
+		IOSTATS_Read(addr);
 	switch (addr & 0xff00) {
 	case 0x4f00:
 	case 0x8f00:
@@ -1146,6 +1433,8 @@ UBYTE MEMORY_HwGetByte(UWORD addr, int no_side_effects)
 
 void MEMORY_HwPutByte(UWORD addr, UBYTE byte)
 {
+	if (IOSTATS_enabled)
+		IOSTATS_Write(addr, byte);
 	switch (addr & 0xff00) {
 	case 0x4f00:
 	case 0x8f00:
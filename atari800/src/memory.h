@@ -6,18 +6,65 @@
 
 #include "atari.h"
 
+extern UBYTE MEMORY_mem[65536 + 2];
+
+#if defined(CPU_PREDECODE) || defined(CPU_JIT)
+#include "cpu.h"
+/* Stores drop predecoded 6502 code of the written pages. */
+#define MEMORY_CODE_WRITE(x)				CPU_PredecodeWrite(x)
+#define MEMORY_CODE_WRITE_WORD(x)			CPU_PredecodeWriteWord(x)
+#define MEMORY_CODE_WRITE_RANGE(x, size)	CPU_PredecodeInvalidate(x, size)
+#else
+#define MEMORY_CODE_WRITE(x)				(x)
+#define MEMORY_CODE_WRITE_WORD(x)			(x)
+#define MEMORY_CODE_WRITE_RANGE(x, size)	((void) 0)
+#endif
+
+#ifdef MEMORY_DIRTY_PAGES
+/* MEMORY_dirty[page] is set by every change to that page of MEMORY_mem and
+   cleared when a state delta saves it (see StateSav_SaveAtariStateDelta).
+   Code that changes memory other than through the MEMORY_d* macros must call
+   MEMORY_DirtyRange. */
+extern UBYTE MEMORY_dirty[256];
+void MEMORY_DirtyRange(UWORD addr, int size);
+
+/* Returns ADDR after marking its page. */
+static inline unsigned int MEMORY_DirtyWrite(unsigned int addr)
+{
+	MEMORY_dirty[(addr >> 8) & 0xff] = 1;
+	return addr;
+}
+
+static inline unsigned int MEMORY_DirtyWriteWord(unsigned int addr)
+{
+	MEMORY_DirtyWrite(addr + 1);
+	return MEMORY_DirtyWrite(addr);
+}
+
+#define MEMORY_STORE(x)					MEMORY_DirtyWrite(MEMORY_CODE_WRITE(x))
+#define MEMORY_STORE_WORD(x)			MEMORY_DirtyWriteWord(MEMORY_CODE_WRITE_WORD(x))
+#define MEMORY_STORE_RANGE(x, size)		(MEMORY_DirtyRange(x, size), MEMORY_CODE_WRITE_RANGE(x, size))
+#else
+#define MEMORY_DirtyRange(addr, size)	((void) 0)
+#define MEMORY_STORE(x)					MEMORY_CODE_WRITE(x)
+#define MEMORY_STORE_WORD(x)			MEMORY_CODE_WRITE_WORD(x)
+#define MEMORY_STORE_RANGE(x, size)		MEMORY_CODE_WRITE_RANGE(x, size)
+#endif
+
+#ifndef XE_BANK_PTR
+
 #define MEMORY_dGetByte(x)				(MEMORY_mem[x])
-#define MEMORY_dPutByte(x, y)			(MEMORY_mem[x] = y)
+#define MEMORY_dPutByte(x, y)			(MEMORY_mem[MEMORY_STORE(x)] = y)
 
 #ifndef WORDS_BIGENDIAN
 #ifdef WORDS_UNALIGNED_OK
 #define MEMORY_dGetWord(x)				UNALIGNED_GET_WORD(MEMORY_mem+(x), memory_read_word_stat)
-#define MEMORY_dPutWord(x, y)			UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_word_stat)
+#define MEMORY_dPutWord(x, y)			UNALIGNED_PUT_WORD(MEMORY_mem+MEMORY_STORE_WORD(x), (y), memory_write_word_stat)
 #define MEMORY_dGetWordAligned(x)		UNALIGNED_GET_WORD(MEMORY_mem+(x), memory_read_aligned_word_stat)
-#define MEMORY_dPutWordAligned(x, y)	UNALIGNED_PUT_WORD(MEMORY_mem+(x), (y), memory_write_aligned_word_stat)
+#define MEMORY_dPutWordAligned(x, y)	UNALIGNED_PUT_WORD(MEMORY_mem+MEMORY_STORE_WORD(x), (y), memory_write_aligned_word_stat)
 #else	/* WORDS_UNALIGNED_OK */
 #define MEMORY_dGetWord(x)				(MEMORY_mem[x] + (MEMORY_mem[(x) + 1] << 8))
-#define MEMORY_dPutWord(x, y)			(MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
+#define MEMORY_dPutWord(x, y)			(MEMORY_mem[MEMORY_STORE_WORD(x)] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
 /* faster versions of MEMORY_jdGetWord and MEMORY_dPutWord for even addresses */
 /* TODO: guarantee that memory is UWORD-aligned and use UWORD access */
 #define MEMORY_dGetWordAligned(x)		MEMORY_dGetWord(x)
@@ -26,16 +73,76 @@
 #else	/* WORDS_BIGENDIAN */
 /* can't do any word optimizations for big endian machines */
 #define MEMORY_dGetWord(x)				(MEMORY_mem[x] + (MEMORY_mem[(x) + 1] << 8))
-#define MEMORY_dPutWord(x, y)			(MEMORY_mem[x] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
+#define MEMORY_dPutWord(x, y)			(MEMORY_mem[MEMORY_STORE_WORD(x)] = (UBYTE) (y), MEMORY_mem[(x) + 1] = (UBYTE) ((y) >> 8))
 #define MEMORY_dGetWordAligned(x)		MEMORY_dGetWord(x)
 #define MEMORY_dPutWordAligned(x, y)	MEMORY_dPutWord(x, y)
 #endif	/* WORDS_BIGENDIAN */
 
 #define MEMORY_dCopyFromMem(from, to, size)	memcpy(to, MEMORY_mem + (from), size)
-#define MEMORY_dCopyToMem(from, to, size)		memcpy(MEMORY_mem + (to), from, size)
-#define MEMORY_dFillMem(addr1, value, length)	memset(MEMORY_mem + (addr1), value, length)
-
-extern UBYTE MEMORY_mem[65536 + 2];
+#define MEMORY_dCopyToMem(from, to, size)		(MEMORY_STORE_RANGE(to, size), memcpy(MEMORY_mem + (to), from, size))
+#define MEMORY_dFillMem(addr1, value, length)	(MEMORY_STORE_RANGE(addr1, length), memset(MEMORY_mem + (addr1), value, length))
+
+/* RAM seen by the CPU at 0x4000-0x7fff. Banks are switched by copying,
+   so it is always in MEMORY_mem. */
+#define MEMORY_bank_ptr (MEMORY_mem + 0x4000)
+
+#else /* XE_BANK_PTR */
+
+/* RAM seen by the CPU at 0x4000-0x7fff. Switching an XE or Axlon bank only
+   changes this pointer; the contents of MEMORY_mem[0x4000..0x7fff] are then
+   not what the CPU sees and must not be accessed directly. */
+extern UBYTE *MEMORY_bank_ptr;
+
+/* Returns the location of the byte seen by the CPU at ADDR (0..0x10001). */
+static inline UBYTE *MEMORY_dPtr(unsigned int addr)
+{
+	if ((addr & 0xc000) == 0x4000)
+		return MEMORY_bank_ptr + (addr - 0x4000);
+	return MEMORY_mem + addr;
+}
+
+/* Words that have a byte in the bank window are assembled from bytes. */
+static inline UWORD MEMORY_dGetWordBanked(unsigned int addr)
+{
+	if ((UWORD) (addr - 0x3fff) > 0x4000) {
+#if !defined(WORDS_BIGENDIAN) && defined(WORDS_UNALIGNED_OK)
+		return UNALIGNED_GET_WORD(MEMORY_mem + addr, memory_read_word_stat);
+#else
+		return MEMORY_mem[addr] + (MEMORY_mem[addr + 1] << 8);
+#endif
+	}
+	return *MEMORY_dPtr(addr) + (*MEMORY_dPtr(addr + 1) << 8);
+}
+
+static inline void MEMORY_dPutWordBanked(unsigned int addr, UWORD value)
+{
+	(void) MEMORY_STORE_WORD(addr);
+	if ((UWORD) (addr - 0x3fff) > 0x4000) {
+#if !defined(WORDS_BIGENDIAN) && defined(WORDS_UNALIGNED_OK)
+		UNALIGNED_PUT_WORD(MEMORY_mem + addr, value, memory_write_word_stat);
+#else
+		MEMORY_mem[addr] = (UBYTE) value;
+		MEMORY_mem[addr + 1] = (UBYTE) (value >> 8);
+#endif
+	}
+	else {
+		*MEMORY_dPtr(addr) = (UBYTE) value;
+		*MEMORY_dPtr(addr + 1) = (UBYTE) (value >> 8);
+	}
+}
+
+#define MEMORY_dGetByte(x)				(*MEMORY_dPtr(x))
+#define MEMORY_dPutByte(x, y)			(*MEMORY_dPtr(MEMORY_STORE(x)) = (y))
+#define MEMORY_dGetWord(x)				MEMORY_dGetWordBanked(x)
+#define MEMORY_dPutWord(x, y)			MEMORY_dPutWordBanked(x, y)
+#define MEMORY_dGetWordAligned(x)		MEMORY_dGetWordBanked(x)
+#define MEMORY_dPutWordAligned(x, y)	MEMORY_dPutWordBanked(x, y)
+
+void MEMORY_dCopyFromMem(UWORD from, UBYTE *to, int size);
+void MEMORY_dCopyToMem(const UBYTE *from, UWORD to, int size);
+void MEMORY_dFillMem(UWORD addr1, UBYTE value, int length);
+
+#endif /* XE_BANK_PTR */
 
 /* RAM size in kilobytes.
    Valid values for Atari800_MACHINE_800 are: 16, 48, 52.
@@ -55,13 +162,20 @@ extern int MEMORY_ram_size;
 extern UBYTE MEMORY_attrib[65536];
 /* Reads a byte from ADDR. Can potentially have side effects, when reading
    from hardware area. */
-#define MEMORY_GetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, FALSE) : MEMORY_mem[addr])
+#define MEMORY_GetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, FALSE) : MEMORY_dGetByte(addr))
 /* Reads a byte from ADDR, but without any side effects. */
-#define MEMORY_SafeGetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, TRUE) : MEMORY_mem[addr])
-#define MEMORY_PutByte(addr, byte)	 do { if (MEMORY_attrib[addr] == MEMORY_RAM) MEMORY_mem[addr] = byte; else if (MEMORY_attrib[addr] == MEMORY_HARDWARE) MEMORY_HwPutByte(addr, byte); } while (0)
-#define MEMORY_SetRAM(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_RAM, (addr2) - (addr1) + 1)
-#define MEMORY_SetROM(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_ROM, (addr2) - (addr1) + 1)
-#define MEMORY_SetHARDWARE(addr1, addr2) memset(MEMORY_attrib + (addr1), MEMORY_HARDWARE, (addr2) - (addr1) + 1)
+#define MEMORY_SafeGetByte(addr)		(MEMORY_attrib[addr] == MEMORY_HARDWARE ? MEMORY_HwGetByte(addr, TRUE) : MEMORY_dGetByte(addr))
+#define MEMORY_PutByte(addr, byte)	 do { if (MEMORY_attrib[addr] == MEMORY_RAM) MEMORY_dPutByte(addr, byte); else if (MEMORY_attrib[addr] == MEMORY_HARDWARE) MEMORY_HwPutByte(addr, byte); } while (0)
+#ifdef MEMORY_DIRTY_PAGES
+/* Same as MEMORY_dirty for MEMORY_attrib. */
+extern UBYTE MEMORY_attrib_dirty[256];
+#define MEMORY_DIRTY_ATTRIB(addr1, addr2) memset(MEMORY_attrib_dirty + ((addr1) >> 8), 1, ((addr2) >> 8) - ((addr1) >> 8) + 1)
+#else
+#define MEMORY_DIRTY_ATTRIB(addr1, addr2) ((void) 0)
+#endif
+#define MEMORY_SetRAM(addr1, addr2) (MEMORY_DIRTY_ATTRIB(addr1, addr2), memset(MEMORY_attrib + (addr1), MEMORY_RAM, (addr2) - (addr1) + 1))
+#define MEMORY_SetROM(addr1, addr2) (MEMORY_DIRTY_ATTRIB(addr1, addr2), memset(MEMORY_attrib + (addr1), MEMORY_ROM, (addr2) - (addr1) + 1))
+#define MEMORY_SetHARDWARE(addr1, addr2) (MEMORY_DIRTY_ATTRIB(addr1, addr2), memset(MEMORY_attrib + (addr1), MEMORY_HARDWARE, (addr2) - (addr1) + 1))
 
 #else /* PAGED_ATTRIB */
 
@@ -73,10 +187,10 @@ extern MEMORY_wrfunc MEMORY_writemap[256];
 void MEMORY_ROM_PutByte(UWORD addr, UBYTE byte);
 /* Reads a byte from ADDR. Can potentially have side effects, when reading
    from hardware area. */
-#define MEMORY_GetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, FALSE) : MEMORY_mem[addr])
+#define MEMORY_GetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, FALSE) : MEMORY_dGetByte(addr))
 /* Reads a byte from ADDR, but without any side effects. */
-#define MEMORY_SafeGetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, TRUE) : MEMORY_mem[addr])
-#define MEMORY_PutByte(addr,byte)	(MEMORY_writemap[(addr) >> 8] ? ((*MEMORY_writemap[(addr) >> 8])(addr, byte), 0) : (MEMORY_mem[addr] = byte))
+#define MEMORY_SafeGetByte(addr)		(MEMORY_readmap[(addr) >> 8] ? (*MEMORY_readmap[(addr) >> 8])(addr, TRUE) : MEMORY_dGetByte(addr))
+#define MEMORY_PutByte(addr,byte)	(MEMORY_writemap[(addr) >> 8] ? ((*MEMORY_writemap[(addr) >> 8])(addr, byte), 0) : MEMORY_dPutByte(addr, byte))
 #define MEMORY_SetRAM(addr1, addr2) do { \
 		int i; \
 		for (i = (addr1) >> 8; i <= (addr2) >> 8; i++) { \
@@ -116,7 +230,7 @@ void MEMORY_Cart809fDisable(void);
 void MEMORY_Cart809fEnable(void);
 void MEMORY_CartA0bfDisable(void);
 void MEMORY_CartA0bfEnable(void);
-#define MEMORY_CopyROM(addr1, addr2, src) memcpy(MEMORY_mem + (addr1), src, (addr2) - (addr1) + 1)
+#define MEMORY_CopyROM(addr1, addr2, src) (MEMORY_STORE_RANGE(addr1, (addr2) - (addr1) + 1), memcpy(MEMORY_mem + (addr1), src, (addr2) - (addr1) + 1))
 void MEMORY_GetCharset(UBYTE *cs);
 
 /* Mosaic and Axlon 400/800 RAM extensions */
@@ -41,8 +41,16 @@
 
 #include "antic.h"
 #include "atari.h"
+#include "cartridge.h"
 #include "cpu.h"
+#ifdef MONITOR_PROFILE
+#include "cpuprof.h"
+#endif
+#ifdef MONITOR_TRACE
+#include "cputrace.h"
+#endif
 #include "gtia.h"
+#include "iostats.h"
 #include "memory.h"
 #include "monitor.h"
 #include "pia.h"
@@ -52,6 +60,9 @@
 #include "pokeysnd.h"
 #endif
 #include "platform.h"
+#ifdef SOUND_THIN_API
+#include "sound.h"
+#endif
 #include "statesav.h"
 #ifdef SLIGHTSID
 #include "slightsid.h"
@@ -2192,8 +2203,13 @@ static void monitor_read_from_file(UWORD *addr)
 			if (f == NULL)
 				perror(filename);
 			else {
-				if (fread(&MEMORY_mem[*addr], 1, nbytes, f) == 0)
+				UBYTE *buf = (UBYTE *) Util_malloc(nbytes);
+				size_t n = fread(buf, 1, nbytes, f);
+				if (n == 0)
 					perror(filename);
+				else
+					MEMORY_dCopyToMem(buf, *addr, (int) n);
+				free(buf);
 				fclose(f);
 			}
 		}
@@ -2273,8 +2289,13 @@ static void monitor_write_to_file(void)
 				wbytes += 6;
 			}
 
-			if (fwrite(&MEMORY_mem[addr1], 1, addr2 - addr1 + 1, f) < nbytes)
-				perror(filename);
+			{
+				UBYTE *buf = (UBYTE *) Util_malloc(nbytes);
+				MEMORY_dCopyFromMem(addr1, buf, (int) nbytes);
+				if (fwrite(buf, 1, nbytes, f) < nbytes)
+					perror(filename);
+				free(buf);
+			}
 
 			wbytes += nbytes;
 
@@ -3910,7 +3931,9 @@ static void show_help(void)
 	if(pager()) return;
 #ifdef MONITOR_TRACE
 	printf(
-		"TRACE [filename]               - Output 6502 trace on/off\n");
+		"TRACE [filename]               - Output 6502 trace on/off\n"
+		"BTRACE [ON|OFF|SAVE file]      - Record binary trace, save recent part\n"
+		"BTRACE FILE [file]             - Write whole binary trace to file/stop\n");
 #endif
 #ifdef MONITOR_BREAK
 	printf(
@@ -3936,6 +3959,7 @@ static void show_help(void)
 		"A [startaddr]                  - Start simple assembler\n"
 #endif
 		"ANTIC, GTIA, PIA, POKEY        - Display hardware registers\n"
+		"D5MAP                          - Display devices answering D500-D5FF\n"
 #ifdef SLIGHTSID
 		"SLIGHTSID                      - Display SlightSID registers\n"
 #endif
@@ -3954,12 +3978,23 @@ static void show_help(void)
 #ifdef YAMARI
 		"YAMARI                         - Display YAMari registers\n"
 #endif
+#ifdef SOUND_THIN_API
+		"SNDSTATS [RESET]               - Display or clear sound statistics\n"
+#endif
+#ifdef CPU_PREDECODE
+		"PREDECODE [RESET]              - Display or clear predecode statistics\n"
+#endif
+		"IDLE [ON|OFF|RESET]            - Display idle loop statistics, skip loops\n"
+		"IOSTATS [ON|OFF|RESET|page]    - Count hardware register accesses\n"
+		"IOSTATS DUMP file|LOG [file]   - Write access counts/log of writes\n"
 	);
 	printf(
 		"DLIST [startaddr]              - Show Display List\n"
 #ifdef MONITOR_PROFILE
 		"PROFILE                        - Display profiling statistics\n"
-		"COV [argument...]              - Coverage statistics (\"COV ?\" for help)\n");
+		"COV [argument...]              - Coverage statistics (\"COV ?\" for help)\n"
+		"CALLPROF [ON|OFF|RESET|TOP [n]]- Call graph profiler, show top routines\n"
+		"CALLPROF CALLGRIND|FOLDED file - Write call graph profile\n");
 	printf(
 #endif
 #ifdef MONITOR_HINTS
@@ -4147,10 +4182,12 @@ static void print_fp_dbl(unsigned char *fp)
 static void mem_to_fp(void)
 {
 	UWORD addr;
+	UBYTE fp[6];
 
 	if(!get_hex(&addr)) addr = 0xd4; /* FR0 */
 
-	print_fp_dbl(&MEMORY_mem[addr]);
+	MEMORY_dCopyFromMem(addr, fp, 6);
+	print_fp_dbl(fp);
 }
 
 /* Read 2 to 6 hex bytes from command line, interpret
@@ -4311,7 +4348,7 @@ static char *command_generator(const char *text, int state)
 	static const char *commands[] = {
 		"CONT", "SHOW", "STACK", "LOOP", "HARDWARE", "READ", "WRITE",
 #ifdef MONITOR_TRACE
-		"TRACE",
+		"TRACE", "BTRACE",
 #endif
 #if defined(MONITOR_BREAK) || !defined(NO_YPOS_BREAK_FLICKER)
 		"BLINE",
@@ -4320,8 +4357,15 @@ static char *command_generator(const char *text, int state)
 		"BBRK", "HISTORY", "JUMPS",
 #endif
 		"ANTIC", "GTIA", "PIA", "POKEY", "DLIST",
+#ifdef SOUND_THIN_API
+		"SNDSTATS",
+#endif
+#ifdef CPU_PREDECODE
+		"PREDECODE",
+#endif
+		"IDLE", "IOSTATS",
 #ifdef MONITOR_PROFILE
-		"PROFILE",
+		"PROFILE", "CALLPROF",
 #endif
 		"LABELS",
 		"SAVESTATE", "LOADSTATE",
@@ -4451,6 +4495,10 @@ static int cmd_wants_filename(void) {
 #ifdef MONITOR_TRACE
 	if(spaces == 1 && Util_strnicmp(rl_line_buffer, "trace ", 6) == 0)
 		return TRUE;
+
+	if(spaces == 2 && (Util_strnicmp(rl_line_buffer, "btrace save ", 12) == 0
+		|| Util_strnicmp(rl_line_buffer, "btrace file ", 12) == 0))
+		return TRUE;
 #endif
 
 #ifdef HAVE_STRSTR
@@ -4701,12 +4749,62 @@ int MONITOR_Run(void)
 			const char *filename = get_token();
 			set_trace_file(filename);
 		}
+		else if (strcmp(t, "BTRACE") == 0) {
+			t = get_token();
+			if (t == NULL)
+				CPUTRACE_PrintStatus();
+			else if (Util_stricmp(t, "ON") == 0)
+				CPUTRACE_Start();
+			else if (Util_stricmp(t, "OFF") == 0)
+				CPUTRACE_Stop();
+			else if (Util_stricmp(t, "SAVE") == 0) {
+				const char *filename = get_token();
+				if (filename == NULL)
+					printf("Missing filename!\n");
+				else if (CPUTRACE_Save(filename))
+					printf("Trace written\n");
+			}
+			else if (Util_stricmp(t, "FILE") == 0) {
+				if (CPUTRACE_Stream(get_token()))
+					CPUTRACE_PrintStatus();
+			}
+			else
+				printf("Invalid argument!\n");
+		}
 #endif /* MONITOR_TRACE */
 #ifdef MONITOR_PROFILE
 		else if (strcmp(t, "PROFILE") == 0)
 			command_PROFILE();
 		else if (strcmp(t, "COV") == 0)
 			coverage();
+		else if (strcmp(t, "CALLPROF") == 0) {
+			t = get_token();
+			if (t == NULL)
+				printf("Call graph profiler is %s\n", CPUPROF_enabled ? "on" : "off");
+			else if (Util_stricmp(t, "ON") == 0)
+				CPUPROF_Start();
+			else if (Util_stricmp(t, "OFF") == 0)
+				CPUPROF_Stop();
+			else if (Util_stricmp(t, "RESET") == 0)
+				CPUPROF_Reset();
+			else if (Util_stricmp(t, "TOP") == 0) {
+				int count;
+				if (!get_dec(&count))
+					count = 20;
+				CPUPROF_PrintTop(stdout, count);
+			}
+			else if (Util_stricmp(t, "CALLGRIND") == 0 || Util_stricmp(t, "FOLDED") == 0) {
+				const char *filename = get_token();
+				if (filename == NULL)
+					printf("Missing filename!\n");
+				else if (Util_stricmp(t, "CALLGRIND") == 0)
+					CPUPROF_WriteCallgrind(filename);
+				else
+					CPUPROF_WriteFolded(filename);
+			}
+			else
+				printf("Invalid argument!\n");
+		}
 #endif /* MONITOR_PROFILE */
 		else if (strcmp(t, "SHOW") == 0)
 			show_state();
@@ -4780,6 +4878,8 @@ int MONITOR_Run(void)
 			show_GTIA();
 		else if (strcmp(t, "POKEY") == 0)
 			show_POKEY();
+		else if (strcmp(t, "D5MAP") == 0)
+			CARTRIDGE_PrintD5Map(stdout);
 #ifdef SLIGHTSID
 		else if (strcmp(t, "SLIGHTSID") == 0)
 			show_SlightSID();
@@ -4804,6 +4904,67 @@ int MONITOR_Run(void)
 		else if (strcmp(t, "YAMARI") == 0)
 			show_YAMari();
 #endif
+#ifdef SOUND_THIN_API
+		else if (strcmp(t, "SNDSTATS") == 0) {
+			t = get_token();
+			if (t != NULL && Util_stricmp(t, "RESET") == 0)
+				Sound_StatsReset();
+			else
+				Sound_StatsPrint(stdout);
+		}
+#endif
+#ifdef CPU_PREDECODE
+		else if (strcmp(t, "PREDECODE") == 0) {
+			t = get_token();
+			if (t != NULL && Util_stricmp(t, "RESET") == 0)
+				CPU_PredecodeStatsReset();
+			else
+				CPU_PredecodeStatsPrint(stdout);
+		}
+#endif
+		else if (strcmp(t, "IDLE") == 0) {
+			t = get_token();
+			if (t == NULL)
+				CPU_IdleStatsPrint(stdout);
+			else if (Util_stricmp(t, "ON") == 0)
+				CPU_idle_skip = TRUE;
+			else if (Util_stricmp(t, "OFF") == 0)
+				CPU_idle_skip = FALSE;
+			else if (Util_stricmp(t, "RESET") == 0)
+				CPU_IdleStatsReset();
+			else
+				printf("Invalid argument!\n");
+		}
+		else if (strcmp(t, "IOSTATS") == 0) {
+			int page;
+			t = get_token();
+			if (t == NULL) {
+				printf("Counting is %s\n", IOSTATS_enabled ? "on" : "off");
+				IOSTATS_Print(stdout, -1);
+			}
+			else if (Util_stricmp(t, "ON") == 0)
+				IOSTATS_Start();
+			else if (Util_stricmp(t, "OFF") == 0)
+				IOSTATS_Stop();
+			else if (Util_stricmp(t, "RESET") == 0)
+				IOSTATS_Reset();
+			else if (Util_stricmp(t, "DUMP") == 0) {
+				const char *filename = get_token();
+				if (filename == NULL)
+					printf("Missing filename!\n");
+				else
+					IOSTATS_Dump(filename);
+			}
+			else if (Util_stricmp(t, "LOG") == 0) {
+				const char *filename = get_token();
+				if (IOSTATS_Log(filename) && filename != NULL)
+					IOSTATS_Start();
+			}
+			else if ((page = Util_sscanhex(t)) >= 0 && page <= 0xff)
+				IOSTATS_Print(stdout, page);
+			else
+				printf("Invalid argument!\n");
+		}
 #ifdef MONITOR_ASSEMBLER
 		else if (strcmp(t, "A") == 0) {
 			get_hex(&addr);
@@ -24,6 +24,7 @@
 
 #include "config.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #ifdef ASAP /* external project, see http://asap.sf.net */
@@ -121,6 +122,10 @@ static double ticks_per_sample;
 static double samp_pos;
 #endif /* SYNCHRONIZED_SOUND */
 
+/* State of the dithering noise generator. It isn't rand(), whose sequence
+   is shared with the rest of the program and differs between C libraries. */
+static ULONG dither_seed = 1;
+
 /* State variables for single Pokey Chip */
 typedef struct stPokeyState
 {
@@ -1435,6 +1440,52 @@ int MZPOKEYSND_Init(ULONG freq17, int playback_freq, UBYTE num_pokeys,
 	return 0; /* OK */
 }
 
+/* Changes the resampling filter quality without touching the chip registers.
+   The change queues wrap at filter_size, so they are collapsed to the current
+   output level first; this only drops the filter's transient response. */
+void MZPOKEYSND_SetQuality(int quality)
+{
+    double cutoff;
+    int i;
+
+    if (quality == snd_quality)
+        return;
+
+    for (i = 0; i < NPOKEYS; i++) {
+        PokeyState *ps = pokey_states + i;
+        if (ps->qebeg != ps->qeend)
+            ps->ovola = ps->qev[(ps->qeend == 0 ? filter_size : ps->qeend) - 1];
+        ps->qebeg = 0;
+        ps->qeend = 0;
+    }
+
+    snd_quality = quality;
+    filter_size = remez_filter_table((double)POKEYSND_playback_freq/pokey_frq,
+                                     &cutoff, quality);
+    audible_frq = (int) (cutoff * pokey_frq);
+}
+
+#ifdef SYNCHRONIZED_SOUND
+size_t MZPOKEYSND_SyncStateSize(void)
+{
+    return sizeof(pokey_states) + sizeof(samp_pos) + sizeof(dither_seed);
+}
+
+void MZPOKEYSND_GetSyncState(void *state)
+{
+    memcpy(state, pokey_states, sizeof(pokey_states));
+    memcpy((UBYTE *) state + sizeof(pokey_states), &samp_pos, sizeof(samp_pos));
+    memcpy((UBYTE *) state + sizeof(pokey_states) + sizeof(samp_pos), &dither_seed, sizeof(dither_seed));
+}
+
+void MZPOKEYSND_SetSyncState(const void *state)
+{
+    memcpy(pokey_states, state, sizeof(pokey_states));
+    memcpy(&samp_pos, (const UBYTE *) state + sizeof(pokey_states), sizeof(samp_pos));
+    memcpy(&dither_seed, (const UBYTE *) state + sizeof(pokey_states) + sizeof(samp_pos), sizeof(dither_seed));
+}
+#endif /* SYNCHRONIZED_SOUND */
+
 
 static void Update_readout_0(PokeyState* ps)
 {
@@ -2319,6 +2370,13 @@ void mzpokeysnd_debugreset(UBYTE chip)
 
 #define MAX_SAMPLE 152
 
+/* Returns dithering noise in the range 0 to 1. */
+static double dither(void)
+{
+    dither_seed = dither_seed * 1103515245 + 12345;
+    return (double) ((dither_seed >> 16) & 0x7fff) / 0x7fff;
+}
+
 static void mzpokeysnd_process_8(void* sndbuffer, int sndn)
 {
     int i;
@@ -2353,15 +2411,15 @@ static void mzpokeysnd_process_8(void* sndbuffer, int sndn)
 
 #ifdef VOL_ONLY_SOUND
         buffer[0] = (UBYTE)floor((generate_sample(pokey_states) + POKEYSND_sampout)
-         * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
+         * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * dither() - 0.25);
 #else
         buffer[0] = (UBYTE)floor(generate_sample(pokey_states)
-         * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
+         * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * dither() - 0.25);
 #endif
         for(i=1; i<num_cur_pokeys; i++)
         {
             buffer[i] = (UBYTE)floor(generate_sample(pokey_states + i)
-             * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
+             * (255.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 128 + 0.5 + 0.5 * dither() - 0.25);
         }
         buffer += num_cur_pokeys;
         nsam -= num_cur_pokeys;
@@ -2401,15 +2459,15 @@ static void mzpokeysnd_process_16(void* sndbuffer, int sndn)
 #endif
 #ifdef VOL_ONLY_SOUND
         buffer[0] = (SWORD)floor((generate_sample(pokey_states) + POKEYSND_sampout)
-         * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
+         * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * dither() - 0.25);
 #else
         buffer[0] = (SWORD)floor(generate_sample(pokey_states)
-         * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
+         * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * dither() - 0.25);
 #endif
         for(i=1; i<num_cur_pokeys; i++)
         {
             buffer[i] = (SWORD)floor(generate_sample(pokey_states + i)
-             * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * rand() / RAND_MAX - 0.25);
+             * (65535.0 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95) + 0.5 + 0.5 * dither() - 0.25);
         }
         buffer += num_cur_pokeys;
         nsam -= num_cur_pokeys;
@@ -2446,7 +2504,7 @@ static unsigned int generate_sync(UBYTE *buffer_begin, UBYTE *buffer_end, unsign
 				*((SWORD *)buffer) = (SWORD)floor(
 					interp_read_resam_all(pokey_states + i, samp_pos)
 					* (volume.s16 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95)
-					+ 0.5 + 0.5 * rand() / RAND_MAX - 0.25
+					+ 0.5 + 0.5 * dither() - 0.25
 				);
 				buffer += 2;
 			}
@@ -2454,7 +2512,7 @@ static unsigned int generate_sync(UBYTE *buffer_begin, UBYTE *buffer_end, unsign
 				*buffer++ = (UBYTE)floor(
 					interp_read_resam_all(pokey_states + i, samp_pos)
 					* (volume.s8 / 2 / MAX_SAMPLE / 4 * M_PI * 0.95)
-					+ 128 + 0.5 + 0.5 * rand() / RAND_MAX - 0.25
+					+ 128 + 0.5 + 0.5 * dither() - 0.25
 				);
 		}
 	}
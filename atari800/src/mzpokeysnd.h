@@ -12,5 +12,14 @@ int MZPOKEYSND_Init(ULONG freq17,
                         , int clear_regs
 #endif
                        );
+void MZPOKEYSND_SetQuality(int quality);
+
+#ifdef SYNCHRONIZED_SOUND
+/* The chips' state in the sound generator, which isn't in the state save.
+   It holds the sound still queued in the resampling filter. */
+size_t MZPOKEYSND_SyncStateSize(void);
+void MZPOKEYSND_GetSyncState(void *state);
+void MZPOKEYSND_SetSyncState(const void *state);
+#endif
 
 #endif /* MZPOKEYSND_H_ */
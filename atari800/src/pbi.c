@@ -246,6 +246,8 @@ void PBI_D1PutByte(UWORD addr, UBYTE byte)
 			/* reactivate the floating point rom */
 			if (!fp_active) {
 				memcpy(MEMORY_mem + 0xd800, MEMORY_os + 0x1800, 0x800);
+				CPU_PredecodeInvalidate(0xd800, 0x800);
+				MEMORY_DirtyRange(0xd800, 0x800);
 				D(printf("Floating point rom activated\n"));
 				fp_active = TRUE;
 			}
@@ -306,7 +308,7 @@ void PBI_D6PutByte(UWORD addr, UBYTE byte)
 	else
 #endif
 	/* XLD/1090 has ram here */
-	if (PBI_D6D7ram) MEMORY_mem[addr]=byte;
+	if (PBI_D6D7ram) MEMORY_dPutByte(addr, byte);
 }
 
 /* read page $D7xx */
@@ -328,7 +330,7 @@ void PBI_D7PutByte(UWORD addr, UBYTE byte)
 		EVIE_D67PutByte(addr, byte);
 	else
 #endif
-	if (PBI_D6D7ram) MEMORY_mem[addr]=byte;
+	if (PBI_D6D7ram) MEMORY_dPutByte(addr, byte);
 }
 
 #ifndef BASIC
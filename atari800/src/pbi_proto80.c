@@ -29,6 +29,7 @@
 #include "util.h"
 #include "log.h"
 #include "memory.h"
+#include "cpu.h"
 #include <stdlib.h>
 
 #define PROTO80_PBI_NUM 2
@@ -118,6 +119,8 @@ int PBI_PROTO80_D1ffPutByte(UBYTE byte)
 	int result = 0; /* handled */
 	if (PBI_PROTO80_enabled && byte == PROTO80_MASK) {
 		memcpy(MEMORY_mem + 0xd800, proto80rom, 0x800);
+		CPU_PredecodeInvalidate(0xd800, 0x800);
+		MEMORY_DirtyRange(0xd800, 0x800);
 		D(printf("PROTO80 rom activated\n"));
 	}
 	else result = PBI_NOT_HANDLED;
@@ -109,6 +109,16 @@ void POKEY_SetRandomCounter(ULONG value)
 	random_scanline_counter = value;
 }
 
+int POKEY_GetPotScanline(void)
+{
+	return pot_scanline;
+}
+
+void POKEY_SetPotScanline(int value)
+{
+	pot_scanline = value;
+}
+
 UBYTE POKEY_GetByte(UWORD addr, int no_side_effects)
 {
 	UBYTE byte = 0xff;
@@ -51,6 +51,8 @@ extern UBYTE POKEY_POT_input[8];
 
 ULONG POKEY_GetRandomCounter(void);
 void POKEY_SetRandomCounter(ULONG value);
+int POKEY_GetPotScanline(void);
+void POKEY_SetPotScanline(int value);
 UBYTE POKEY_GetByte(UWORD addr, int no_side_effects);
 void POKEY_PutByte(UWORD addr, UBYTE byte);
 int POKEY_Initialise(int *argc, char *argv[]);
@@ -24,6 +24,7 @@
 
 #include "config.h"
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #ifdef ASAP /* external project, see http://asap.sf.net */
@@ -59,10 +60,34 @@
 #ifdef YAMARI
 #include "yamari.h"
 #endif
+#if defined(SLIGHTSID) || defined(EVIE) || defined(SIDARI)
+#include "resid.h"
+#endif
 #include "antic.h"
 #include "gtia.h"
 #include "util.h"
 #include "log.h"
+#ifdef SOUND_THIN_API
+#include "sound.h"
+#endif
+
+#ifdef SOUND_THIN_API
+/* Runs RENDER and, when sound statistics are enabled, adds its duration to
+   the render time of CHIP. IDLE tells whether the chip is silent and will
+   skip synthesis; it is evaluated before RENDER. */
+#define STATS_RENDER(chip, idle, render) do { \
+		if (Sound_stats_enabled) { \
+			int stats_idle = (idle); \
+			double stats_start = Util_time(); \
+			render; \
+			Sound_StatsChipTime(chip, stats_idle, Util_time() - stats_start); \
+		} \
+		else \
+			render; \
+	} while (0)
+#else /* !SOUND_THIN_API */
+#define STATS_RENDER(chip, idle, render) render
+#endif /* !SOUND_THIN_API */
 
 #ifdef WORDS_UNALIGNED_OK
 #  define READ_U32(x)     (*(ULONG *) (x))
@@ -197,6 +222,26 @@ int POKEYSND_stereo_enabled = FALSE;
 
 int POKEYSND_volume = 0x100;
 
+#ifndef ASAP
+/* Adaptive quality governor */
+int POKEYSND_governor_enabled = FALSE;
+int POKEYSND_governor_level = 0;
+static int governor_pending_level = 0;
+static int governor_base_mz_quality;
+static double governor_synth_time = 0.0;	/* host seconds spent synthesizing since last frame */
+static double governor_synth_avg = 0.0;		/* averaged fraction of the frame budget */
+static double governor_spare_avg = 1.0;
+static int governor_trend_frames = 0;		/* >0: frames under pressure, <0: frames idle */
+
+/* The governor steps down after half a second of pressure, and waits five
+   seconds with plenty of spare time before stepping back up. */
+#define GOVERNOR_DOWN_FRAMES	25
+#define GOVERNOR_UP_FRAMES	250
+#define GOVERNOR_MIN_SPARE	0.05
+#define GOVERNOR_MIN_SYNTH	0.10
+#define GOVERNOR_UP_SPARE	0.25
+#endif /* ASAP */
+
 /* multiple sound engine interface */
 static void pokeysnd_process_8(void *sndbuffer, int sndn);
 static void pokeysnd_process_16(void *sndbuffer, int sndn);
@@ -232,7 +277,19 @@ void (*POKEYSND_UpdateVolOnly)(void) = null_vol_only_sound;
 UBYTE *POKEYSND_process_buffer = NULL;
 unsigned int POKEYSND_process_buffer_length;
 unsigned int POKEYSND_process_buffer_fill;
+const UBYTE *POKEYSND_frame_buffer = NULL;
+unsigned int POKEYSND_frame_length = 0;
 static unsigned int prev_update_tick;
+/* Two buffers of POKEYSND_process_buffer_length bytes: POKEYSND_process_buffer
+   is the one being filled, POKEYSND_frame_buffer the other one. */
+static UBYTE *process_buffers = NULL;
+#ifdef SOUND_THIN_API
+/* The sound of each chip on its own, laid out like process_buffers. */
+static UBYTE *stem_buffers[Sound_CHIP_COUNT];
+static int stems_requested = FALSE;
+static int stems_enabled = FALSE;
+static int frame_has_stems = FALSE;
+#endif /* SOUND_THIN_API */
 
 static unsigned int Generate_sync_rf(UBYTE *buffer_begin, UBYTE *buffer_end, unsigned int num_ticks);
 static unsigned int null_generate_sync(UBYTE *buffer_begin, UBYTE *buffer_end, unsigned int num_ticks) { return 0; }
@@ -242,6 +299,65 @@ static double ticks_per_sample;
 static double samp_pos;
 static int speaker;
 static int const CONSOLE_VOL = 32;
+
+#ifdef SOUND_THIN_API
+/* Turns STEM, a copy of SIZE bytes of BUFFER made before a chip added its
+   sound, into the sound that the chip added. */
+static void take_stem(UBYTE *stem, UBYTE const *buffer, unsigned int size)
+{
+	int val;
+	if (POKEYSND_snd_flags & POKEYSND_BIT16) {
+		SWORD *dst = (SWORD *)stem;
+		SWORD const *src = (SWORD const *)buffer;
+		for (size /= 2; size > 0; size--) {
+			val = *src++ - *dst;
+			if (val > 32767) val = 32767;
+			else if (val < -32768) val = -32768;
+			*dst++ = val;
+		}
+	}
+	else {
+		for (; size > 0; size--) {
+			val = *buffer++ - *stem + 0x80;
+			if (val > 255) val = 255;
+			else if (val < 0) val = 0;
+			*stem++ = val;
+		}
+	}
+}
+
+/* Allocates or frees the stems after they have been switched on or off, or
+   when RESIZED because the process buffers changed. Only called between
+   frames, so that a frame has all the stems or none. */
+static void update_stems(int resized)
+{
+	int chip;
+	if (stems_enabled == stems_requested && !resized)
+		return;
+	for (chip = 0; chip < Sound_CHIP_COUNT; chip++) {
+		free(stem_buffers[chip]);
+		stem_buffers[chip] = NULL;
+		if (stems_requested) {
+			stem_buffers[chip] = (UBYTE *)Util_malloc(2 * POKEYSND_process_buffer_length);
+			/* chips that are not emulated stay silent */
+			memset(stem_buffers[chip], (POKEYSND_snd_flags & POKEYSND_BIT16) ? 0 : 0x80, 2 * POKEYSND_process_buffer_length);
+		}
+	}
+	stems_enabled = stems_requested;
+}
+
+void POKEYSND_SetStems(int enable)
+{
+	stems_requested = enable;
+}
+
+const UBYTE *POKEYSND_GetFrameStem(int chip)
+{
+	if (!frame_has_stems || chip < 0 || chip >= Sound_CHIP_COUNT)
+		return NULL;
+	return stem_buffers[chip] + (POKEYSND_frame_buffer - process_buffers);
+}
+#endif /* SOUND_THIN_API */
 #endif /* SYNCHRONIZED_SOUND */
 
 /*****************************************************************************/
@@ -350,9 +466,16 @@ int POKEYSND_Init(ULONG freq17, int playback_freq, UBYTE num_pokeys,
 		unsigned int max_ticks_per_frame = ticks_per_frame + surplus_ticks;
 		double ticks_per_sample = (double)ticks_per_frame / samples_per_frame;
 		POKEYSND_process_buffer_length = POKEYSND_num_pokeys * (unsigned int)ceil((double)max_ticks_per_frame / ticks_per_sample) * ((POKEYSND_snd_flags & POKEYSND_BIT16) ? 2:1);
-		free(POKEYSND_process_buffer);
-		POKEYSND_process_buffer = (UBYTE *)Util_malloc(POKEYSND_process_buffer_length);
+		free(process_buffers);
+		process_buffers = (UBYTE *)Util_malloc(2 * POKEYSND_process_buffer_length);
+		POKEYSND_process_buffer = process_buffers;
 		POKEYSND_process_buffer_fill = 0;
+		POKEYSND_frame_buffer = process_buffers + POKEYSND_process_buffer_length;
+		POKEYSND_frame_length = 0;
+#ifdef SOUND_THIN_API
+		frame_has_stems = FALSE;
+		update_stems(TRUE);
+#endif /* SOUND_THIN_API */
 	    prev_update_tick = ANTIC_CPU_CLOCK;
 	}
 #endif /* SYNCHRONIZED_SOUND */
@@ -386,29 +509,125 @@ void POKEYSND_SetMzQuality(int quality)	/* specially for win32, perhaps not need
 	mz_quality = quality;
 }
 
+#ifndef ASAP
+static double governor_start(void)
+{
+	return POKEYSND_governor_enabled ? Util_time() : 0.0;
+}
+
+static void governor_stop(double start)
+{
+	if (POKEYSND_governor_enabled)
+		governor_synth_time += Util_time() - start;
+}
+
+/* Switches synthesis quality to the level requested by POKEYSND_GovernorFrame.
+   Called only between generated blocks, when no chip is in the middle of
+   rendering. Level 0 restores the user's settings. */
+static void governor_apply(void)
+{
+	int level = governor_pending_level;
+
+	if (level == POKEYSND_governor_level)
+		return;
+	if (POKEYSND_governor_level == 0)
+		governor_base_mz_quality = mz_quality;
+	POKEYSND_governor_level = level;
+
+#if defined(SLIGHTSID) || defined(EVIE) || defined(SIDARI)
+	/* RESAMPLE_INTERPOLATE -> RESAMPLE_FAST -> INTERPOLATE. RESID_init takes
+	   the faster of this and the configured RESID_resample_method, which is
+	   left alone so the governor's choice never gets saved. */
+	if (RESID_governor_resample_method != level) {
+		RESID_governor_resample_method = level;
+#ifdef SLIGHTSID
+		SLIGHTSID_Reinit(POKEYSND_playback_freq);
+#endif
+#ifdef EVIE
+		EVIE_Reinit(POKEYSND_playback_freq);
+#endif
+#ifdef SIDARI
+		SIDARI_Reinit(POKEYSND_playback_freq);
+#endif
+	}
+#endif
+	if (POKEYSND_enable_new_pokey) {
+		int quality = POKEYSND_GOVERNOR_MAX_LEVEL - level;
+		MZPOKEYSND_SetQuality(governor_base_mz_quality < quality ? governor_base_mz_quality : quality);
+	}
+}
+
+void POKEYSND_GovernorFrame(double frame_time, double spare_time)
+{
+	static double const alpha = 2.0/(1.0+25.0);
+	double synth = governor_synth_time / frame_time;
+	double spare = spare_time > 0.0 ? spare_time / frame_time : 0.0;
+
+	governor_synth_time = 0.0;
+	if (!POKEYSND_governor_enabled) {
+		governor_pending_level = 0;
+		governor_trend_frames = 0;
+		return;
+	}
+	governor_synth_avg += alpha * (synth - governor_synth_avg);
+	governor_spare_avg += alpha * (spare - governor_spare_avg);
+
+	if (governor_spare_avg < GOVERNOR_MIN_SPARE && governor_synth_avg > GOVERNOR_MIN_SYNTH) {
+		/* Late on frames and synthesis is a noticeable part of the cost. */
+		if (governor_trend_frames < 0)
+			governor_trend_frames = 0;
+		if (++governor_trend_frames >= GOVERNOR_DOWN_FRAMES) {
+			if (governor_pending_level < POKEYSND_GOVERNOR_MAX_LEVEL)
+				governor_pending_level++;
+			governor_trend_frames = 0;
+		}
+	}
+	else if (governor_spare_avg > 2 * governor_synth_avg + GOVERNOR_UP_SPARE) {
+		/* Enough spare time to absorb roughly doubled synthesis cost. */
+		if (governor_trend_frames > 0)
+			governor_trend_frames = 0;
+		if (--governor_trend_frames <= -GOVERNOR_UP_FRAMES) {
+			if (governor_pending_level > 0)
+				governor_pending_level--;
+			governor_trend_frames = 0;
+		}
+	}
+	else
+		governor_trend_frames = 0;
+}
+#endif /* ASAP */
+
 void POKEYSND_Process(void *sndbuffer, int sndn)
 {
-	POKEYSND_Process_ptr(sndbuffer, sndn);
+#ifndef ASAP
+	double start;
+	governor_apply();
+	start = governor_start();
+#endif
+	STATS_RENDER(Sound_CHIP_POKEY, FALSE, POKEYSND_Process_ptr(sndbuffer, sndn));
 #if defined(PBI_XLD) || defined (VOICEBOX)
-	VOTRAXSND_Process(sndbuffer, sndn);
+	STATS_RENDER(Sound_CHIP_VOTRAX, FALSE, VOTRAXSND_Process(sndbuffer, sndn));
 #endif
 #if defined(SLIGHTSID)
-	SLIGHTSID_Process(sndbuffer, sndn);
+	STATS_RENDER(Sound_CHIP_SLIGHTSID, SLIGHTSID_IsSilent(), SLIGHTSID_Process(sndbuffer, sndn));
 #endif
 #if defined(EVIE)
-	EVIE_Process(sndbuffer, sndn);
+	STATS_RENDER(Sound_CHIP_EVIE, EVIE_IsSilent(), EVIE_Process(sndbuffer, sndn));
 #endif
 #if defined(SIDARI)
-	SIDARI_Process(sndbuffer, sndn);
+	STATS_RENDER(Sound_CHIP_SIDARI, SIDARI_IsSilent(), SIDARI_Process(sndbuffer, sndn));
 #endif
 #if defined(SONARI)
-	SONARI_Process(sndbuffer, sndn);
+	STATS_RENDER(Sound_CHIP_SONARI, SONARI_IsSilent(), SONARI_Process(sndbuffer, sndn));
 #endif
 #if defined(MELODY_PSG)
-	MELODY_PSG_Process(sndbuffer, sndn);
+	STATS_RENDER(Sound_CHIP_MELODY_PSG, MELODY_PSG_IsSilent(), MELODY_PSG_Process(sndbuffer, sndn));
 #endif
 #if defined(YAMARI)
-	YAMARI_Process(sndbuffer, sndn);
+	STATS_RENDER(Sound_CHIP_YAMARI, YAMARI_IsSilent(), YAMARI_Process(sndbuffer, sndn));
+#endif
+#ifndef ASAP
+	governor_stop(start);
 #endif
 #if !defined(__PLUS) && !defined(ASAP)
 	SndSave_WriteToSoundFile((const unsigned char *)sndbuffer, sndn);
@@ -416,30 +635,52 @@ void POKEYSND_Process(void *sndbuffer, int sndn)
 }
 
 #ifdef SYNCHRONIZED_SOUND
+#ifdef SOUND_THIN_API
+/* Renders a chip that adds its sound to POKEY's and, when stems are on,
+   keeps what it added in the chip's stem. */
+#define RENDER_SYNC(chip, idle, generate) do { \
+		UBYTE *stem_begin = stems_enabled ? stem_buffers[chip] + (buffer_begin - process_buffers) : NULL; \
+		if (stem_begin != NULL) \
+			memcpy(stem_begin, buffer_begin, sndn); \
+		STATS_RENDER(chip, idle, generate(buffer_begin, buffer_end, ticks, sndn)); \
+		if (stem_begin != NULL) \
+			take_stem(stem_begin, buffer_begin, sndn); \
+	} while (0)
+#else /* !SOUND_THIN_API */
+#define RENDER_SYNC(chip, idle, generate) STATS_RENDER(chip, idle, generate(buffer_begin, buffer_end, ticks, sndn))
+#endif /* !SOUND_THIN_API */
+
 static void Update_synchronized_sound(void)
 {
 	unsigned int ticks = ANTIC_CPU_CLOCK - prev_update_tick;
 	UBYTE *buffer_begin = POKEYSND_process_buffer + POKEYSND_process_buffer_fill;
 	UBYTE *buffer_end = POKEYSND_process_buffer + POKEYSND_process_buffer_length;
-	unsigned int sndn = POKEYSND_GenerateSync(buffer_begin, buffer_end, ticks);
+	double start = governor_start();
+	unsigned int sndn;
+	STATS_RENDER(Sound_CHIP_POKEY, FALSE, sndn = POKEYSND_GenerateSync(buffer_begin, buffer_end, ticks));
+#ifdef SOUND_THIN_API
+	if (stems_enabled)
+		memcpy(stem_buffers[Sound_CHIP_POKEY] + (buffer_begin - process_buffers), buffer_begin, sndn);
+#endif
 #if defined(SLIGHTSID)
-	SLIGHTSID_GenerateSync(buffer_begin, buffer_end, ticks, sndn);
+	RENDER_SYNC(Sound_CHIP_SLIGHTSID, SLIGHTSID_IsSilent(), SLIGHTSID_GenerateSync);
 #endif
 #if defined(EVIE)
-	EVIE_GenerateSync(buffer_begin, buffer_end, ticks, sndn);
+	RENDER_SYNC(Sound_CHIP_EVIE, EVIE_IsSilent(), EVIE_GenerateSync);
 #endif
 #if defined(SIDARI)
-	SIDARI_GenerateSync(buffer_begin, buffer_end, ticks, sndn);
+	RENDER_SYNC(Sound_CHIP_SIDARI, SIDARI_IsSilent(), SIDARI_GenerateSync);
 #endif
 #if defined(SONARI)
-	SONARI_GenerateSync(buffer_begin, buffer_end, ticks, sndn);
+	RENDER_SYNC(Sound_CHIP_SONARI, SONARI_IsSilent(), SONARI_GenerateSync);
 #endif
 #if defined(MELODY_PSG)
-	MELODY_PSG_GenerateSync(buffer_begin, buffer_end, ticks, sndn);
+	RENDER_SYNC(Sound_CHIP_MELODY_PSG, MELODY_PSG_IsSilent(), MELODY_PSG_GenerateSync);
 #endif
 #if defined(YAMARI)
-	YAMARI_GenerateSync(buffer_begin, buffer_end, ticks, sndn);
+	RENDER_SYNC(Sound_CHIP_YAMARI, YAMARI_IsSilent(), YAMARI_GenerateSync);
 #endif
+	governor_stop(start);
 	POKEYSND_process_buffer_fill += sndn;
 	prev_update_tick = ANTIC_CPU_CLOCK;
 }
@@ -447,18 +688,83 @@ static void Update_synchronized_sound(void)
 int POKEYSND_UpdateProcessBuffer(void)
 {
 	int sndn;
+	unsigned int fill;
 	Update_synchronized_sound();
-	sndn = POKEYSND_process_buffer_fill / ((POKEYSND_snd_flags & POKEYSND_BIT16) ? 2 : 1);
+	/* The frame's audio is complete - a safe point to switch quality. */
+	governor_apply();
+	fill = POKEYSND_process_buffer_fill;
+	sndn = fill / ((POKEYSND_snd_flags & POKEYSND_BIT16) ? 2 : 1);
 	POKEYSND_process_buffer_fill = 0;
 
 #if defined(PBI_XLD) || defined (VOICEBOX)
-	VOTRAXSND_Process(POKEYSND_process_buffer, sndn);
+#ifdef SOUND_THIN_API
+	if (stems_enabled) {
+		UBYTE *stem = stem_buffers[Sound_CHIP_VOTRAX] + (POKEYSND_process_buffer - process_buffers);
+		memcpy(stem, POKEYSND_process_buffer, fill);
+		STATS_RENDER(Sound_CHIP_VOTRAX, FALSE, VOTRAXSND_Process(POKEYSND_process_buffer, sndn));
+		take_stem(stem, POKEYSND_process_buffer, fill);
+	}
+	else
+#endif /* SOUND_THIN_API */
+	STATS_RENDER(Sound_CHIP_VOTRAX, FALSE, VOTRAXSND_Process(POKEYSND_process_buffer, sndn));
 #endif
 #if !defined(__PLUS) && !defined(ASAP)
 	SndSave_WriteToSoundFile((const unsigned char *)POKEYSND_process_buffer, sndn);
 #endif
+
+	/* Hand the frame over and fill the other buffer with the next one. */
+	POKEYSND_frame_buffer = POKEYSND_process_buffer;
+	POKEYSND_frame_length = fill;
+	if (POKEYSND_process_buffer == process_buffers)
+		POKEYSND_process_buffer = process_buffers + POKEYSND_process_buffer_length;
+	else
+		POKEYSND_process_buffer = process_buffers;
+#ifdef SOUND_THIN_API
+	frame_has_stems = stems_enabled && stems_requested;
+	update_stems(FALSE);
+#endif /* SOUND_THIN_API */
 	return sndn;
 }
+
+/* The state starts with the ticks not yet rendered, counted from the start
+   of the scan line, and the samples of the frame rendered so far. The mz
+   engine's state follows; the older engine keeps the running machine's. */
+typedef struct {
+	unsigned int ticks;
+	unsigned int fill;
+} sync_state_t;
+
+static size_t engine_sync_state_size(void)
+{
+	return POKEYSND_GenerateSync == Generate_sync_rf ? 0 : MZPOKEYSND_SyncStateSize();
+}
+
+size_t POKEYSND_SyncStateSize(void)
+{
+	return sizeof(sync_state_t) + POKEYSND_process_buffer_length + engine_sync_state_size();
+}
+
+void POKEYSND_GetSyncState(void *state)
+{
+	sync_state_t *sync = (sync_state_t *) state;
+	UBYTE *samples = (UBYTE *) state + sizeof(sync_state_t);
+	sync->ticks = ANTIC_screenline_cpu_clock - prev_update_tick;
+	sync->fill = POKEYSND_process_buffer_fill;
+	memcpy(samples, POKEYSND_process_buffer, POKEYSND_process_buffer_fill);
+	if (engine_sync_state_size() != 0)
+		MZPOKEYSND_GetSyncState(samples + POKEYSND_process_buffer_length);
+}
+
+void POKEYSND_SetSyncState(const void *state)
+{
+	const sync_state_t *sync = (const sync_state_t *) state;
+	const UBYTE *samples = (const UBYTE *) state + sizeof(sync_state_t);
+	prev_update_tick = ANTIC_screenline_cpu_clock - sync->ticks;
+	POKEYSND_process_buffer_fill = sync->fill;
+	memcpy(POKEYSND_process_buffer, samples, sync->fill);
+	if (engine_sync_state_size() != 0)
+		MZPOKEYSND_SetSyncState(samples + POKEYSND_process_buffer_length);
+}
 #endif /* SYNCHRONIZED_SOUND */
 
 #ifdef SYNCHRONIZED_SOUND
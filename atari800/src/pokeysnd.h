@@ -141,6 +141,20 @@ void POKEYSND_UpdateYAMari(void);
 void POKEYSND_Process(void *sndbuffer, int sndn);
 int POKEYSND_DoInit(void);
 void POKEYSND_SetMzQuality(int quality);
+
+#ifndef ASAP
+/* Adaptive quality governor. When enabled, synthesis time of all sound chips
+   is measured and compared with the frame budget. Under sustained pressure the
+   reSID sampling method and mzpokeysnd filter quality are lowered, and raised
+   again when there is enough spare time. Level 0 is the user's configured
+   quality. */
+#define POKEYSND_GOVERNOR_MAX_LEVEL 2
+extern int POKEYSND_governor_enabled;
+extern int POKEYSND_governor_level;
+/* Called once per emulated frame with the frame budget and the time left
+   before the frame deadline (negative if late), both in seconds. */
+void POKEYSND_GovernorFrame(double frame_time, double spare_time);
+#endif /* ASAP */
 void POKEYSND_SetVolume(int vol);
 
 /* Volume only emulations declarations */
@@ -164,7 +178,29 @@ extern UBYTE *POKEYSND_process_buffer;
 extern unsigned int POKEYSND_process_buffer_length;
 extern unsigned int POKEYSND_process_buffer_fill;
 extern unsigned int (*POKEYSND_GenerateSync)(UBYTE *buffer_begin, UBYTE *buffer_end, unsigned int num_ticks);
+/* Completes the frame's samples and returns their number. They stay in
+   POKEYSND_frame_buffer, POKEYSND_frame_length bytes, until the end of the
+   next frame, while the next frame is rendered in the other half of a double
+   buffer. */
 int POKEYSND_UpdateProcessBuffer(void);
+extern const UBYTE *POKEYSND_frame_buffer;
+extern unsigned int POKEYSND_frame_length;
+/* The progress of the sound generator, which isn't in the state save. Put
+   it back after reading a state for the machine to carry on sounding as it
+   did when saved; it's POKEYSND_SyncStateSize() bytes until the next
+   POKEYSND_Init. */
+size_t POKEYSND_SyncStateSize(void);
+void POKEYSND_GetSyncState(void *state);
+void POKEYSND_SetSyncState(const void *state);
+#ifdef SOUND_THIN_API
+/* Stems are the sound that each chip (Sound_CHIP_*) added to the frame, in
+   the format of POKEYSND_frame_buffer; the frame itself is the same with or
+   without them. Switching them on
+   or off takes effect at the end of a frame. POKEYSND_GetFrameStem returns
+   the stem of the last frame, or NULL if the frame was made without stems. */
+void POKEYSND_SetStems(int enable);
+const UBYTE *POKEYSND_GetFrameStem(int chip);
+#endif /* SOUND_THIN_API */
 #endif /* SYNCHRONIZED_SOUND */
 
 #ifdef __cplusplus
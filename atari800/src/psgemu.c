@@ -159,6 +159,65 @@ int AYEMU_calculate_sample(int psg_index, int delta, SWORD *buf, int nr)
 	return (int)(next - buf) / chip->sndfmt.channels;
 }
 
+int AYEMU_is_silent(int psg_index)
+{
+	ayemu_ay_t *chip = psg[psg_index];
+	int m;
+
+	/* Volume tables are only valid after the first generated block. */
+	if (chip == NULL || chip->dirty)
+		return FALSE;
+	if (chip->regs.env_a || chip->regs.env_b || chip->regs.env_c
+	    || chip->regs.vol_a != 0 || chip->regs.vol_b != 0 || chip->regs.vol_c != 0)
+		return FALSE;
+	/* Volume 0 of each channel selects vols[][1]. */
+	for (m = 0; m < 6; m++)
+		if (chip->vols[m][1] != 0)
+			return FALSE;
+	return TRUE;
+}
+
+/* Advances a ++cnt >= period counter by TACTS steps and returns the number
+   of times it wrapped, mirroring the loop in ayemu_gen_sound. */
+static int advance_counter(int *cnt, int period, int tacts)
+{
+	int first;
+	if (period < 1)
+		period = 1;
+	first = *cnt < period ? period - *cnt : 1;
+	if (tacts < first) {
+		*cnt += tacts;
+		return 0;
+	}
+	tacts -= first;
+	*cnt = tacts % period;
+	return 1 + tacts / period;
+}
+
+void AYEMU_skip(int psg_index, int nr)
+{
+	ayemu_ay_t *chip = psg[psg_index];
+	int tacts = nr * chip->ChipTacts_per_outcount;
+	int n;
+
+	if (advance_counter(&chip->cnt_a, chip->regs.tone_a, tacts) & 1)
+		chip->bit_a = !chip->bit_a;
+	if (advance_counter(&chip->cnt_b, chip->regs.tone_b, tacts) & 1)
+		chip->bit_b = !chip->bit_b;
+	if (advance_counter(&chip->cnt_c, chip->regs.tone_c, tacts) & 1)
+		chip->bit_c = !chip->bit_c;
+	n = advance_counter(&chip->cnt_n, chip->regs.noise * 2, tacts);
+	if (n > 0) {
+		while (n-- > 0)
+			chip->Cur_Seed = (chip->Cur_Seed * 2 + 1) ^ (((chip->Cur_Seed >> 16) ^ (chip->Cur_Seed >> 13)) & 1);
+		chip->bit_n = (chip->Cur_Seed >> 16) & 1;
+	}
+	n = advance_counter(&chip->cnt_e, chip->regs.env_freq, tacts);
+	chip->env_pos += n;
+	if (chip->env_pos > 127)
+		chip->env_pos = 64 + (chip->env_pos - 128) % 64;
+}
+
 void AYEMU_read_state(int psg_index, AYEMU_State *state)
 {
 	int i, j;
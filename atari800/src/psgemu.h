@@ -88,6 +88,11 @@ UBYTE AYEMU_read(int psg_index, UBYTE addr);
 void AYEMU_write(int psg_index, UBYTE addr, UBYTE byte);
 void AYEMU_reset(int psg_index);
 int AYEMU_calculate_sample(int psg_index, int delta, SWORD *buf, int nr);
+/* Returns TRUE if the chip's output is exactly zero until the next
+   register write. Rendering may then be replaced with AYEMU_skip. */
+int AYEMU_is_silent(int psg_index);
+/* Advances the chip's generators as if NR samples were produced. */
+void AYEMU_skip(int psg_index, int nr);
 void AYEMU_read_state(int psg_index, AYEMU_State *state);
 void AYEMU_write_state(int psg_index, AYEMU_State *state);
 
@@ -34,6 +34,7 @@ extern "C" {
 
 
 int RESID_resample_method = RESID_SYNTHESIS_METHOD_RESAMPLE_INTERPOLATE;
+int RESID_governor_resample_method = RESID_SYNTHESIS_METHOD_RESAMPLE_INTERPOLATE;
 
 static SID *sid[] = {
 	NULL,	/* SlightSID left */
@@ -43,6 +44,41 @@ static SID *sid[] = {
 	NULL,	/* SIDari right */
 };
 
+/* Silence tracking. A SID is audibly silent when its master volume is zero
+   or all voices' envelopes are at zero and can't rise without a register
+   write. Its output then settles to zero through the external filter, so it
+   is only considered silent after quiet_samples has reached grace_samples. */
+static struct {
+	int quiet_samples;
+	int grace_samples;
+	UBYTE reg[0x20];
+} silence[sizeof(sid) / sizeof(sid[0])];
+
+static int is_quiet(int sid_index)
+{
+	SID::State state = sid[sid_index]->read_state();
+	if ((state.sid_register[0x18] & 0x0f) == 0)
+		return TRUE;
+	for (int i = 0; i < 3; i++) {
+		if (state.envelope_counter[i] != 0 || state.envelope_state[i] == EnvelopeGenerator::ATTACK)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* A closed SID is kept for the next RESID_open of its index, along with
+   the parameters of its last set_sampling_parameters. Chips are closed and
+   reopened by every state load, and building the resampling filter again
+   takes milliseconds. A reused SID starts its output afresh, as the samples
+   it holds may come from another machine's context. */
+static struct {
+	SID *spare;
+	int valid;
+	double clock;
+	sampling_method method;
+	double sample_rate;
+} sampling[sizeof(sid) / sizeof(sid[0])];
+
 static const int autochoose_order_resample_method[] = { 0, 1, 2, 3,
                                                  -1 };
 static const int cfg_vals[] = {
@@ -62,17 +98,41 @@ static const char * cfg_strings[] = {
 
 void RESID_open(int sid_index)
 {
-	sid[sid_index] = new SID();
+	if (sampling[sid_index].spare != NULL) {
+		sid[sid_index] = sampling[sid_index].spare;
+		sampling[sid_index].spare = NULL;
+		sid[sid_index]->reset();
+		sid[sid_index]->reset_sampling();
+		sid[sid_index]->input(0);
+	}
+	else {
+		sid[sid_index] = new SID();
+		sampling[sid_index].valid = FALSE;
+	}
+	silence[sid_index].quiet_samples = 0;
+	silence[sid_index].grace_samples = 0;
+	memset(silence[sid_index].reg, 0, sizeof(silence[sid_index].reg));
 }
 
 void RESID_close(int sid_index)
 {
 	if (sid[sid_index] != NULL) {
-		delete sid[sid_index];
+		delete sampling[sid_index].spare;
+		sampling[sid_index].spare = sid[sid_index];
 		sid[sid_index] = NULL;
 	}
 }
 
+void RESID_Exit(void)
+{
+	unsigned int i;
+	for (i = 0; i < sizeof(sampling) / sizeof(sampling[0]); i++) {
+		delete sampling[i].spare;
+		sampling[i].spare = NULL;
+		sampling[i].valid = FALSE;
+	}
+}
+
 int RESID_is_opened(int sid_index)
 {
 	return sid[sid_index] != NULL;
@@ -93,7 +153,9 @@ int RESID_init(int sid_index, double cycles_per_sec, int sid_model, double sampl
 	}
 
 	sampling_method method;
-	switch (RESID_resample_method) {
+	int resample_method = RESID_resample_method > RESID_governor_resample_method
+	                      ? RESID_resample_method : RESID_governor_resample_method;
+	switch (resample_method) {
 	case RESID_SYNTHESIS_METHOD_FAST:
 		method = SAMPLE_FAST;
 		break;
@@ -111,7 +173,19 @@ int RESID_init(int sid_index, double cycles_per_sec, int sid_model, double sampl
 	sid[sid_index]->set_chip_model(model);
 	sid[sid_index]->enable_filter(sid_model != RESID_SID_FILTER_NONE);
 	sid[sid_index]->enable_external_filter(true);
-	int result = sid[sid_index]->set_sampling_parameters(cycles_per_sec, method, sample_rate);
+	int result = TRUE;
+	if (!sampling[sid_index].valid || sampling[sid_index].clock != cycles_per_sec
+	    || sampling[sid_index].method != method || sampling[sid_index].sample_rate != sample_rate) {
+		result = sid[sid_index]->set_sampling_parameters(cycles_per_sec, method, sample_rate);
+		sampling[sid_index].valid = result;
+		sampling[sid_index].clock = cycles_per_sec;
+		sampling[sid_index].method = method;
+		sampling[sid_index].sample_rate = sample_rate;
+	}
+	/* Output must stay quiet for 200 ms - about 20 time constants of the
+	   external filter's high-pass stage - before rendering is skipped. */
+	silence[sid_index].grace_samples = (int)(sample_rate / 5);
+	silence[sid_index].quiet_samples = 0;
 	return result;
 }
 
@@ -122,12 +196,20 @@ UBYTE RESID_read(int sid_index, UBYTE addr)
 
 void RESID_write(int sid_index, UBYTE addr, UBYTE byte)
 {
+	UBYTE old = silence[sid_index].reg[addr & 0x1f];
 	sid[sid_index]->write(addr, byte);
+	silence[sid_index].reg[addr & 0x1f] = byte;
+	/* A change of filter or volume settings moves the DC level of the
+	   output even when all envelopes are zero. */
+	if ((addr >= 0x15 && addr <= 0x18 && byte != old) || !is_quiet(sid_index))
+		silence[sid_index].quiet_samples = 0;
 }
 
 void RESID_reset(int sid_index)
 {
 	sid[sid_index]->reset();
+	silence[sid_index].quiet_samples = 0;
+	memset(silence[sid_index].reg, 0, sizeof(silence[sid_index].reg));
 }
 
 void RESID_input(int sid_index, int sample)
@@ -137,7 +219,25 @@ void RESID_input(int sid_index, int sample)
 
 int RESID_calculate_sample(int sid_index, int delta, SWORD *buf, int nr)
 {
-	return sid[sid_index]->clock(delta, buf, nr);
+	int count = sid[sid_index]->clock(delta, buf, nr);
+	if (is_quiet(sid_index)) {
+		if (silence[sid_index].quiet_samples < silence[sid_index].grace_samples)
+			silence[sid_index].quiet_samples += count;
+	}
+	else
+		silence[sid_index].quiet_samples = 0;
+	return count;
+}
+
+int RESID_is_silent(int sid_index)
+{
+	return sid[sid_index] != NULL && silence[sid_index].grace_samples > 0
+		&& silence[sid_index].quiet_samples >= silence[sid_index].grace_samples;
+}
+
+void RESID_skip(int sid_index, int delta)
+{
+	sid[sid_index]->clock(delta);
 }
 
 void RESID_read_state(int sid_index, RESID_State *state)
@@ -179,6 +279,9 @@ void RESID_write_state(int sid_index, RESID_State *state)
 		sid_state.hold_zero[i] = state->hold_zero[i];
 	}
 	sid[sid_index]->write_state(sid_state);
+	silence[sid_index].quiet_samples = 0;
+	for (int i = 0; i < 0x20; i++)
+		silence[sid_index].reg[i] = state->sid_register[i];
 }
 
 
@@ -52,6 +52,10 @@ typedef struct {
 } RESID_State;
 
 extern int RESID_resample_method;
+/* Lowest quality method the sound quality governor allows, used instead of
+   RESID_resample_method when it is faster. Neither saved in the config nor
+   in state saves. */
+extern int RESID_governor_resample_method;
 
 void RESID_open(int sid_index);
 void RESID_close(int sid_index);
@@ -62,10 +66,17 @@ void RESID_write(int sid_index, UBYTE addr, UBYTE byte);
 void RESID_reset(int sid_index);
 void RESID_input(int sid_index, int sample);
 int RESID_calculate_sample(int sid_index, int delta, SWORD *buf, int nr);
+/* Returns TRUE if the chip's output is known to stay silent until the next
+   register write. Rendering may then be replaced with RESID_skip. */
+int RESID_is_silent(int sid_index);
+/* Advances the chip by DELTA cycles without producing samples. */
+void RESID_skip(int sid_index, int delta);
 void RESID_read_state(int sid_index, RESID_State *state);
 void RESID_write_state(int sid_index, RESID_State *state);
 
 int RESID_Initialise(int *argc, char *argv[]);
+/* Frees the chips kept for reuse. Call after closing all the chips. */
+void RESID_Exit(void);
 int RESID_ReadConfig(char *string, char *ptr);
 void RESID_WriteConfig(FILE *fp);
 void RESID_StateSave(void);
@@ -0,0 +1,344 @@
+/*
+ * rewind.c - in-memory snapshots to go back in time
+ *
+ * Copyright (c) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "config.h"
+#include <stdlib.h>
+#include <string.h>
+
+#include "atari.h"
+#include "log.h"
+#include "rewind.h"
+#include "statesav.h"
+#include "util.h"
+
+#define DEFAULT_RING_KB 8192
+/* the state buffers grow up to this when a machine has more memory */
+#define MAX_STATE_SIZE 0x1000000
+#define MAX_RECORDS 4096
+/* equal bytes that end a run of literals */
+#define MIN_ZEROS 4
+
+/* The XOR of a snapshot with the one taken after it. */
+typedef struct {
+	size_t offset;		/* in ring */
+	size_t size;		/* of the encoded XOR */
+	size_t state_len;	/* of the older snapshot */
+} record_t;
+
+int REWIND_enabled = FALSE;
+
+static int interval = 0;
+static int frames;			/* since the newest snapshot */
+static int have_snapshot = FALSE;
+
+/* The newest snapshot is state[current], the other buffer takes the next
+   one. Both are kept zero beyond state_len. */
+static UBYTE *state[2] = { NULL, NULL };
+static size_t state_len[2];
+static size_t state_size;
+static int current;
+static UBYTE *scratch = NULL;
+
+static UBYTE *ring = NULL;
+static size_t ring_size = DEFAULT_RING_KB * 1024;
+static size_t ring_head;	/* where the next record goes */
+static record_t records[MAX_RECORDS];
+static int first_record;	/* the oldest */
+static int num_records = 0;
+
+static UBYTE *PutNumber(UBYTE *p, size_t n)
+{
+	while (n >= 0x80) {
+		*p++ = (UBYTE) (n | 0x80);
+		n >>= 7;
+	}
+	*p++ = (UBYTE) n;
+	return p;
+}
+
+static const UBYTE *GetNumber(const UBYTE *p, size_t *n)
+{
+	size_t value = 0;
+	int shift = 0;
+	UBYTE byte;
+	do {
+		byte = *p++;
+		value |= (size_t) (byte & 0x7f) << shift;
+		shift += 7;
+	} while (byte & 0x80);
+	*n = value;
+	return p;
+}
+
+/* Encodes NEW_STATE XOR OLD_STATE as pairs of a count of zeros and a count
+   of literals followed by the literals. A run of literals ends only at
+   MIN_ZEROS zeros, so the output is at most a few bytes longer than LEN. */
+static size_t Encode(const UBYTE *new_state, const UBYTE *old_state, size_t len, UBYTE *out)
+{
+	UBYTE *p = out;
+	size_t i = 0;
+	while (i < len) {
+		size_t start = i;
+		size_t end;
+		while (i < len && new_state[i] == old_state[i])
+			i++;
+		p = PutNumber(p, i - start);
+		end = i;
+		while (end < len) {
+			size_t k = end;
+			while (k < len && k - end < MIN_ZEROS && new_state[k] == old_state[k])
+				k++;
+			if (k == len || k - end == MIN_ZEROS)
+				break;
+			end = k + 1;
+		}
+		p = PutNumber(p, end - i);
+		while (i < end) {
+			*p++ = new_state[i] ^ old_state[i];
+			i++;
+		}
+	}
+	return p - out;
+}
+
+static void Decode(UBYTE *dest, const UBYTE *in, size_t size)
+{
+	const UBYTE *end = in + size;
+	while (in < end) {
+		size_t n;
+		in = GetNumber(in, &n);
+		dest += n;
+		in = GetNumber(in, &n);
+		while (n-- > 0)
+			*dest++ ^= *in++;
+	}
+}
+
+static void DropOldest(void)
+{
+	first_record = (first_record + 1) % MAX_RECORDS;
+	num_records--;
+}
+
+/* Returns the offset for SIZE bytes, dropping the oldest records to make
+   room. SIZE must not be bigger than the ring. */
+static size_t Allocate(size_t size)
+{
+	for (;;) {
+		size_t tail;
+		if (num_records == 0) {
+			first_record = 0;
+			return 0;
+		}
+		if (num_records < MAX_RECORDS) {
+			tail = records[first_record].offset;
+			if (ring_head > tail) {
+				if (ring_size - ring_head >= size)
+					return ring_head;
+				if (tail >= size)
+					return 0;
+			}
+			else if (tail - ring_head >= size)
+				return ring_head;
+		}
+		DropOldest();
+	}
+}
+
+static void AllocateStates(size_t size)
+{
+	int i;
+	for (i = 0; i < 2; i++) {
+		state[i] = (UBYTE *) Util_realloc(state[i], size);
+		memset(state[i] + state_size, 0, size - state_size);
+	}
+	/* see Encode */
+	scratch = (UBYTE *) Util_realloc(scratch, size + 16);
+	state_size = size;
+}
+
+static void Snapshot(void)
+{
+	int next = 1 - current;
+	size_t len;
+	while ((len = StateSav_SaveAtariStateMem(state[next], state_size)) == 0) {
+		if (state_size >= MAX_STATE_SIZE) {
+			Log_print("Rewind: cannot save the state");
+			REWIND_SetInterval(0);
+			return;
+		}
+		/* keep it zero beyond state_len */
+		memset(state[next], 0, state_size);
+		state_len[next] = 0;
+		AllocateStates(state_size * 2);
+	}
+	if (state_len[next] > len)
+		memset(state[next] + len, 0, state_len[next] - len);
+	state_len[next] = len;
+	frames = 0;
+	if (have_snapshot) {
+		size_t xor_len = len > state_len[current] ? len : state_len[current];
+		size_t size = Encode(state[next], state[current], xor_len, scratch);
+		if (size > ring_size) {
+			num_records = 0;
+		}
+		else {
+			record_t *record;
+			size_t offset = Allocate(size);
+			memcpy(ring + offset, scratch, size);
+			ring_head = offset + size;
+			record = &records[(first_record + num_records) % MAX_RECORDS];
+			record->offset = offset;
+			record->size = size;
+			record->state_len = state_len[current];
+			num_records++;
+		}
+	}
+	current = next;
+	have_snapshot = TRUE;
+}
+
+void REWIND_Reset(void)
+{
+	have_snapshot = FALSE;
+	num_records = 0;
+}
+
+void REWIND_SetInterval(int n)
+{
+	interval = n;
+	REWIND_enabled = n > 0;
+	if (!REWIND_enabled) {
+		REWIND_Reset();
+		free(ring);
+		ring = NULL;
+		free(scratch);
+		scratch = NULL;
+		free(state[0]);
+		free(state[1]);
+		state[0] = state[1] = NULL;
+		state_size = 0;
+		return;
+	}
+	if (ring == NULL) {
+		state_len[0] = state_len[1] = 0;
+		AllocateStates(STATESAV_MAX_SIZE);
+		ring = (UBYTE *) Util_malloc(ring_size);
+		current = 0;
+	}
+}
+
+void REWIND_Frame(void)
+{
+	if (!REWIND_enabled)
+		return;
+	if (!have_snapshot || ++frames >= interval)
+		Snapshot();
+}
+
+int REWIND_Back(void)
+{
+	if (!have_snapshot)
+		return FALSE;
+	if (frames == 0) {
+		/* the newest snapshot is the current frame; go to the one before */
+		record_t *record;
+		if (num_records == 0)
+			return FALSE;
+		num_records--;
+		record = &records[(first_record + num_records) % MAX_RECORDS];
+		Decode(state[current], ring + record->offset, record->size);
+		state_len[current] = record->state_len;
+		ring_head = record->offset;
+	}
+	frames = 0;
+	return StateSav_ReadAtariStateMem(state[current], state_len[current]);
+}
+
+int REWIND_Count(void)
+{
+	if (!have_snapshot)
+		return 0;
+	return num_records + (frames > 0);
+}
+
+int REWIND_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	int n = 0;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-rewind") == 0) {
+			if (i_a) {
+				n = Util_sscandec(argv[++i]);
+				if (n <= 0) {
+					Log_print("Invalid rewind interval, must be at least 1 frame");
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-rewind-size") == 0) {
+			if (i_a) {
+				int kb = Util_sscandec(argv[++i]);
+				if (kb < 64) {
+					Log_print("Invalid rewind buffer size, must be at least 64 KB");
+					return FALSE;
+				}
+				ring_size = (size_t) kb * 1024;
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-rewind <frames>     Keep a snapshot to rewind to every <frames> frames");
+				Log_print("\t-rewind-size <kb>    Memory for rewind snapshots (default %d)", DEFAULT_RING_KB);
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	/* the ring may have been allocated with another size */
+	REWIND_SetInterval(0);
+	if (n > 0)
+		REWIND_SetInterval(n);
+	return TRUE;
+}
+
+void REWIND_Exit(void)
+{
+	REWIND_SetInterval(0);
+}
+
+/*
+vim:ts=4:sw=4:
+*/
@@ -0,0 +1,29 @@
+#ifndef REWIND_H_
+#define REWIND_H_
+
+#include "config.h"
+#include "atari.h"
+
+/* Snapshots of the whole machine taken every few frames. The newest one is
+   kept as a plain state save, the older ones as the XOR of each snapshot
+   with the next, run-length encoded, in a ring that drops the oldest when
+   it is full. */
+
+extern int REWIND_enabled;
+
+int REWIND_Initialise(int *argc, char *argv[]);
+void REWIND_Exit(void);
+
+/* Frames between snapshots; 0 stops rewinding and frees the buffers. */
+void REWIND_SetInterval(int frames);
+/* Forgets all snapshots. */
+void REWIND_Reset(void);
+/* Called after each frame. */
+void REWIND_Frame(void);
+/* Goes back to the newest snapshot taken before the current frame and
+   forgets the newer ones. Returns FALSE if there is none. */
+int REWIND_Back(void);
+/* Number of snapshots that can be gone back to. */
+int REWIND_Count(void);
+
+#endif /* REWIND_H_ */
@@ -39,6 +39,9 @@
 #include "colours.h"
 #include "log.h"
 #include "pia.h"
+#if defined(SOUND) && !defined(__PLUS)
+#include "pokeysnd.h"
+#endif
 #include "screen.h"
 #include "sio.h"
 #include "util.h"
@@ -206,6 +209,7 @@ void Screen_WriteConfig(FILE *fp)
 #define SMALLFONT_D        12
 #define SMALLFONT_L        13
 #define SMALLFONT_SLASH    14
+#define SMALLFONT_Q        15
 #define SMALLFONT_____ 0x00
 #define SMALLFONT___X_ 0x02
 #define SMALLFONT__X__ 0x04
@@ -217,7 +221,7 @@ void Screen_WriteConfig(FILE *fp)
 
 static void SmallFont_DrawChar(UBYTE *screen, int ch, UBYTE color1, UBYTE color2)
 {
-	static const UBYTE font[15][SMALLFONT_HEIGHT] = {
+	static const UBYTE font[16][SMALLFONT_HEIGHT] = {
 		{
 			SMALLFONT_____,
 			SMALLFONT__X__,
@@ -352,6 +356,15 @@ static void SmallFont_DrawChar(UBYTE *screen, int ch, UBYTE color1, UBYTE color2
 			SMALLFONT__X__,
 			SMALLFONT_X___,
 			SMALLFONT_____
+		},
+		{
+			SMALLFONT_____,
+			SMALLFONT__X__,
+			SMALLFONT_X_X_,
+			SMALLFONT_X_X_,
+			SMALLFONT_XX__,
+			SMALLFONT__XX_,
+			SMALLFONT_____
 		}
 	};
 	int y;
@@ -397,6 +410,14 @@ void Screen_DrawAtariSpeed(double cur_time)
 			          	+ (Screen_visible_y2 - SMALLFONT_HEIGHT) * Screen_WIDTH;
 			SmallFont_DrawChar(screen, SMALLFONT_PERCENT, 0x0c, 0x00);
 			SmallFont_DrawInt(screen - SMALLFONT_WIDTH, percent_display, 0x0c, 0x00);
+#if defined(SOUND) && !defined(__PLUS)
+			/* Sound quality level chosen by the governor, 0 = as configured */
+			if (POKEYSND_governor_enabled) {
+				UBYTE color = POKEYSND_governor_level == 0 ? 0x0c : 0x2b;
+				SmallFont_DrawChar(screen + 2 * SMALLFONT_WIDTH, SMALLFONT_Q, color, 0x00);
+				SmallFont_DrawChar(screen + 3 * SMALLFONT_WIDTH, POKEYSND_governor_level, color, 0x00);
+			}
+#endif
 		}
 	}
 }
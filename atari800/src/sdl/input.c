@@ -696,6 +696,9 @@ int PLATFORM_Keyboard(void)
 	case SDLK_F10:
 		key_pressed = 0;
 		return INPUT_key_shift ? AKEY_SCREENSHOT_INTERLACE : AKEY_SCREENSHOT;
+	case SDLK_F11:
+		key_pressed = 0;
+		return AKEY_REWIND;
 	case SDLK_F12:
 		key_pressed = 0;
 		return AKEY_TURBO;
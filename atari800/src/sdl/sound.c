@@ -46,7 +46,23 @@ int PLATFORM_SoundSetup(Sound_setup_t *setup)
 	}
 
 	desired.freq = setup->freq;
-	desired.format = setup->sample_size == 2 ? AUDIO_S16SYS : AUDIO_U8;
+#if !SDL_VERSION_ATLEAST(2, 0, 0)
+	/* 32-bit sample formats are available since SDL 2.0. */
+	if (setup->sample_size == 4)
+		setup->sample_size = 2;
+#endif
+	switch (setup->sample_size) {
+#if SDL_VERSION_ATLEAST(2, 0, 0)
+	case 4:
+		desired.format = setup->float_samples ? AUDIO_F32SYS : AUDIO_S32SYS;
+		break;
+#endif
+	case 2:
+		desired.format = AUDIO_S16SYS;
+		break;
+	default:
+		desired.format = AUDIO_U8;
+	}
 	desired.channels = setup->channels;
 
 	if (setup->buffer_frames == 0)
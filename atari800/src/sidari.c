@@ -25,6 +25,7 @@
 #define COUNT_CYCLES
 
 #include "sidari.h"
+#include "cartridge.h"
 #include "pokeysnd.h"
 #include "atari.h"
 #include "antic.h"
@@ -237,6 +238,7 @@ void SIDARI_Init(unsigned long freq17, int playback_freq, int n_pokeys, int b16)
 	if (restore_state2)
 		RESID_read_state(RESID_CHIP_SIDARI_RIGHT_INDEX, &state2);
 	sidari_initialize(freq17, playback_freq, n_pokeys, b16, restore_state ? &state : NULL, restore_state2 ? &state2 : NULL);
+	CARTRIDGE_UpdateD5Map();
 }
 
 void SIDARI_Exit(void)
@@ -348,6 +350,23 @@ void SIDARI_D5PutByte(UWORD addr, UBYTE byte)
 	}
 }
 
+/* Returns TRUE if the SIDari is enabled but none of its chips can be heard
+   until the next register write. */
+int SIDARI_IsSilent(void)
+{
+	return SIDARI_version != SIDARI_NO
+		&& RESID_is_silent(RESID_CHIP_SIDARI_LEFT_INDEX)
+		&& (SIDARI_version != SIDARI_STEREO || RESID_is_silent(RESID_CHIP_SIDARI_RIGHT_INDEX));
+}
+
+/* Advances silent chips by TICKS SID cycles without rendering. */
+static void skip_ticks(int ticks)
+{
+	RESID_skip(RESID_CHIP_SIDARI_LEFT_INDEX, ticks);
+	if (SIDARI_version == SIDARI_STEREO)
+		RESID_skip(RESID_CHIP_SIDARI_RIGHT_INDEX, ticks);
+}
+
 static UBYTE* generate_samples(UBYTE *sndbuffer, int samples)
 {
 	int ticks;
@@ -355,6 +374,11 @@ static UBYTE* generate_samples(UBYTE *sndbuffer, int samples)
 	unsigned int buflen = samples > sidari_buffer_length ? sidari_buffer_length : samples;
 	unsigned int amount = 0;
 
+	if (SIDARI_IsSilent()) {
+		skip_ticks((int)(buflen * sid_ticks_per_sample));
+		return sndbuffer + buflen * (bit16 ? 2 : 1) * (num_pokeys == 2 ? 2: 1);
+	}
+
 	if (SIDARI_version != SIDARI_STEREO)
 		while (buflen > 0) {
 			ticks = buflen * sid_ticks_per_sample;
@@ -432,6 +456,11 @@ unsigned int SIDARI_GenerateSync(UBYTE *buffer_begin, UBYTE *buffer_end, unsigne
 		ticks = int_part;
 		/*Log_print("SIDari_GenerateSync");*/
 		/*Log_print("sid_ticks=%d, num_ticks=%d", ticks, num_ticks);*/
+		if (SIDARI_IsSilent()) {
+			if (ticks > 0)
+				skip_ticks(ticks);
+			return samples_count * sample_size;
+		}
 		if (ticks > 0) {
 			count = RESID_calculate_sample(RESID_CHIP_SIDARI_LEFT_INDEX, ticks, sidari_buffer, samples_count);
 			if (SIDARI_version == SIDARI_STEREO)
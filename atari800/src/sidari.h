@@ -33,6 +33,7 @@ int SIDARI_InSlot(UWORD addr);
 int SIDARI_D5GetByte(UWORD addr, int no_side_effects);
 void SIDARI_D5PutByte(UWORD addr, UBYTE byte);
 void SIDARI_Process(void *sndbuffer, int sndn);
+int SIDARI_IsSilent(void);
 #ifdef SYNCHRONIZED_SOUND
 unsigned int SIDARI_GenerateSync(UBYTE *buffer_begin, UBYTE *buffer_end, unsigned int ticks, unsigned int sndn);
 #endif
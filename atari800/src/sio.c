@@ -1677,6 +1677,34 @@ int SIO_RotateDisks(void)
 }
 #endif /* !defined(BASIC) && !defined(__PLUS) */
 
+void SIO_GetTransfer(SIO_Transfer *transfer)
+{
+	memcpy(transfer->command_frame, CommandFrame, sizeof(CommandFrame));
+	transfer->command_index = CommandIndex;
+	memcpy(transfer->data_buffer, DataBuffer, sizeof(DataBuffer));
+	transfer->data_index = DataIndex;
+	transfer->transfer_status = TransferStatus;
+	transfer->expected_bytes = ExpectedBytes;
+#ifndef NO_SECTOR_DELAY
+	transfer->delay_counter = delay_counter;
+	transfer->last_ypos = last_ypos;
+#endif
+}
+
+void SIO_SetTransfer(const SIO_Transfer *transfer)
+{
+	memcpy(CommandFrame, transfer->command_frame, sizeof(CommandFrame));
+	CommandIndex = transfer->command_index;
+	memcpy(DataBuffer, transfer->data_buffer, sizeof(DataBuffer));
+	DataIndex = transfer->data_index;
+	TransferStatus = transfer->transfer_status;
+	ExpectedBytes = transfer->expected_bytes;
+#ifndef NO_SECTOR_DELAY
+	delay_counter = transfer->delay_counter;
+	last_ypos = transfer->last_ypos;
+#endif
+}
+
 #ifndef BASIC
 
 void SIO_StateSave(void)
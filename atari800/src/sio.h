@@ -59,4 +59,20 @@ int SIO_WriteSector(int unit, int sector, const UBYTE *buffer);
 void SIO_StateSave(void);
 void SIO_StateRead(void);
 
+/* The serial transfer in progress and the delay of sector 1 reads, which
+   aren't in the state save. */
+typedef struct {
+	UBYTE command_frame[6];
+	int command_index;
+	UBYTE data_buffer[256 + 3];
+	int data_index;
+	int transfer_status;
+	int expected_bytes;
+	int delay_counter;
+	int last_ypos;
+} SIO_Transfer;
+
+void SIO_GetTransfer(SIO_Transfer *transfer);
+void SIO_SetTransfer(const SIO_Transfer *transfer);
+
 #endif	/* SIO_H_ */
@@ -26,6 +26,7 @@
 #define COUNT_CYCLES
 
 #include "slightsid.h"
+#include "cartridge.h"
 #include "pokeysnd.h"
 #include "atari.h"
 #include "antic.h"
@@ -217,6 +218,7 @@ void SLIGHTSID_Init(unsigned long freq17, int playback_freq, int n_pokeys, int b
 	if (restore_state2)
 		RESID_read_state(RESID_CHIP_SLIGHTSID_RIGHT_INDEX, &state2);
 	slightsid_initialize(freq17, playback_freq, n_pokeys, b16, restore_state ? &state : NULL, restore_state2 ? &state2 : NULL);
+	CARTRIDGE_UpdateD5Map();
 }
 
 void SLIGHTSID_Exit(void)
@@ -362,6 +364,23 @@ void SLIGHTSID_D5PutByte(UWORD addr, UBYTE byte)
 	}
 }
 
+/* Returns TRUE if the SlightSID is enabled but none of its chips can be
+   heard until the next register write. */
+int SLIGHTSID_IsSilent(void)
+{
+	return SLIGHTSID_version != SLIGHTSID_NO
+		&& RESID_is_silent(RESID_CHIP_SLIGHTSID_LEFT_INDEX)
+		&& (SLIGHTSID_version != SLIGHTSID_STEREO || RESID_is_silent(RESID_CHIP_SLIGHTSID_RIGHT_INDEX));
+}
+
+/* Advances silent chips by TICKS SID cycles without rendering. */
+static void skip_ticks(int ticks)
+{
+	RESID_skip(RESID_CHIP_SLIGHTSID_LEFT_INDEX, ticks);
+	if (SLIGHTSID_version == SLIGHTSID_STEREO)
+		RESID_skip(RESID_CHIP_SLIGHTSID_RIGHT_INDEX, ticks);
+}
+
 static UBYTE* generate_samples(UBYTE *sndbuffer, int samples)
 {
 	int ticks;
@@ -369,6 +388,10 @@ static UBYTE* generate_samples(UBYTE *sndbuffer, int samples)
 	unsigned int buflen = samples > slightsid_buffer_length ? slightsid_buffer_length : samples;
 	unsigned int amount = 0;
 
+	if (((SLIGHTSID_version != SLIGHTSID_STEREO) || (!reset)) && SLIGHTSID_IsSilent()) {
+		skip_ticks((int)(buflen * sid_ticks_per_sample));
+		return sndbuffer + buflen * (bit16 ? 2 : 1) * (num_pokeys == 2 ? 2: 1);
+	}
 	if ((SLIGHTSID_version != SLIGHTSID_STEREO) || (!reset))
 		while (buflen > 0) {
 			ticks = buflen * sid_ticks_per_sample;
@@ -446,6 +469,11 @@ unsigned int SLIGHTSID_GenerateSync(UBYTE *buffer_begin, UBYTE *buffer_end, unsi
 		ticks = int_part;
 		/*Log_print("SlightSID_GenerateSync");*/
 		/*Log_print("sid_ticks=%d, num_ticks=%d", ticks, num_ticks);*/
+		if (SLIGHTSID_IsSilent()) {
+			if (ticks > 0)
+				skip_ticks(ticks);
+			return samples_count * sample_size;
+		}
 		if (ticks > 0) {
 			count = RESID_calculate_sample(RESID_CHIP_SLIGHTSID_LEFT_INDEX, ticks, slightsid_buffer, samples_count);
 			if (SLIGHTSID_version == SLIGHTSID_STEREO)
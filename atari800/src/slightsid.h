@@ -22,6 +22,7 @@ void SLIGHTSID_WriteConfig(FILE *fp);
 int SLIGHTSID_D5GetByte(UWORD addr, int no_side_effects);
 void SLIGHTSID_D5PutByte(UWORD addr, UBYTE byte);
 void SLIGHTSID_Process(void *sndbuffer, int sndn);
+int SLIGHTSID_IsSilent(void);
 #ifdef SYNCHRONIZED_SOUND
 unsigned int SLIGHTSID_GenerateSync(UBYTE *buffer_begin, UBYTE *buffer_end, unsigned int ticks, unsigned int sndn);
 #endif
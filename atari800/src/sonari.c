@@ -27,6 +27,7 @@
 #define COUNT_CYCLES
 
 #include "sonari.h"
+#include "cartridge.h"
 #include "pokeysnd.h"
 #include "atari.h"
 #include "antic.h"
@@ -277,6 +278,7 @@ void SONARI_Init(unsigned long freq17, int playback_freq, int n_pokeys, int b16)
 	if (restore_psg_state2)
 		AYEMU_read_state(AYEMU_CHIP_SONARI_RIGHT_INDEX, &psg_state2);
 	sonari_initialize(freq17, playback_freq, n_pokeys, b16, restore_psg_state ? &psg_state : NULL, restore_psg_state2 ? &psg_state2 : NULL);
+	CARTRIDGE_UpdateD5Map();
 }
 
 void SONARI_Exit(void)
@@ -447,6 +449,25 @@ void SONARI_D5PutByte(UWORD addr, UBYTE byte)
 	}
 }
 
+/* Returns TRUE if the SONari is enabled but none of its PSGs can be heard
+   until the next register write. */
+int SONARI_IsSilent(void)
+{
+	return SONARI_version != SONARI_NO
+		&& (SONARI_model == SONARI_CHIP_NO || AYEMU_is_silent(AYEMU_CHIP_SONARI_LEFT_INDEX))
+		&& (SONARI_version != SONARI_STEREO || SONARI_model2 == SONARI_CHIP_NO
+		    || AYEMU_is_silent(AYEMU_CHIP_SONARI_RIGHT_INDEX));
+}
+
+/* Advances the enabled PSGs by SAMPLES output samples without rendering. */
+static void skip_samples(int samples)
+{
+	if (SONARI_model != SONARI_CHIP_NO)
+		AYEMU_skip(AYEMU_CHIP_SONARI_LEFT_INDEX, samples);
+	if ( (SONARI_version == SONARI_STEREO) && (SONARI_model2 != SONARI_CHIP_NO) )
+		AYEMU_skip(AYEMU_CHIP_SONARI_RIGHT_INDEX, samples);
+}
+
 static UBYTE* psg_generate_samples(UBYTE *sndbuffer, int samples)
 {
 	int ticks;
@@ -457,6 +478,10 @@ static UBYTE* psg_generate_samples(UBYTE *sndbuffer, int samples)
 
 	if ( ( (SONARI_model != SONARI_CHIP_NO) || ( (SONARI_version == SONARI_STEREO) && (SONARI_model2 != SONARI_CHIP_NO) ) ) ) {
 		/*Log_print("psg_generate_samples %d", buflen);*/
+		if (SONARI_IsSilent()) {
+			skip_samples(buflen);
+			return sndbuffer + buflen * (bit16 ? 2 : 1) * pokeys_count;
+		}
 		while (buflen > 0) {
 			count = 0;
 			ticks = buflen * psg_ticks_per_sample;
@@ -562,6 +587,10 @@ static unsigned int psg_generate_sync(UBYTE *buffer_begin, UBYTE *buffer_end, un
 		ticks = int_part;
 		/*Log_print("SONari_GenerateSync");*/
 		/*Log_print("psg_ticks=%d, num_ticks=%d", ticks, num_ticks);*/
+		if (SONARI_IsSilent()) {
+			skip_samples(samples_count);
+			return samples_count * sample_size;
+		}
 		if (ticks > 0) {
 			if (SONARI_model != SONARI_CHIP_NO)
 				count = AYEMU_calculate_sample(AYEMU_CHIP_SONARI_LEFT_INDEX, ticks, psg_buffer, samples_count);
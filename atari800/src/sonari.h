@@ -39,6 +39,7 @@ int SONARI_InSlot(UWORD addr);
 int SONARI_D5GetByte(UWORD addr, int no_side_effects);
 void SONARI_D5PutByte(UWORD addr, UBYTE byte);
 void SONARI_Process(void *sndbuffer, int sndn);
+int SONARI_IsSilent(void);
 #ifdef SYNCHRONIZED_SOUND
 unsigned int SONARI_GenerateSync(UBYTE *buffer_begin, UBYTE *buffer_end, unsigned int ticks, unsigned int sndn);
 #endif
@@ -31,6 +31,7 @@
 #include "log.h"
 #include "platform.h"
 #include "pokeysnd.h"
+#include "sndsave.h"
 #include "util.h"
 
 #define DEBUG 0
@@ -48,21 +49,62 @@ Sound_setup_t Sound_out;
 
 static int paused = TRUE;
 
+#ifdef SYNCHRONIZED_SOUND
+/* Sound file of -audio-only, opened by the first Sound_Setup. */
+static char audio_only_filename[FILENAME_MAX] = "";
+#endif /* SYNCHRONIZED_SOUND */
+
+/* TRUE when the samples go to no audio device. libatari800 hands each
+   frame's samples to the program straight from POKEYSND_frame_buffer. */
+#if defined(LIBATARI800) && defined(SYNCHRONIZED_SOUND)
+#define NO_AUDIO_DEVICE TRUE
+#else
+#define NO_AUDIO_DEVICE Atari800_audio_only
+#endif
+
+/* Size of samples produced by the sound chips: 1 or 2. For 32-bit output
+   formats the chips render 16-bit samples into render_buffer, which are
+   converted by WidenSamples(). */
+static int render_sample_size;
+static UBYTE *render_buffer = NULL;
+static unsigned int render_buffer_size;
+
 #ifndef SOUND_CALLBACK
 static UBYTE *process_buffer = NULL;
 static unsigned int process_buffer_size;
 #endif /* !SOUND_CALLBACK */
 
 #ifdef SYNCHRONIZED_SOUND
+/* sync_buffer is a single-producer/single-consumer ring. UpdateSyncBuffer
+   (emulation thread) is the only writer and FillBuffer (possibly called
+   from the audio callback thread) the only reader.
+   Both positions run freely and wrap around at UINT_MAX. sync_buffer_size is
+   a power of 2, so the buffer offset is pos & (sync_buffer_size - 1) and
+   the fill is always sync_pos.write - sync_pos.read, which never exceeds
+   sync_buffer_size. Each position is modified by one side only. */
 static UBYTE *sync_buffer = NULL;
 static unsigned int sync_buffer_size;
-/* Two invariants are held:
-   a) 0 <= sync_read_pos < sync_buffer_size
-   b) sync_read_pos <= sync_write_pos <= sync_buffer_size + sync_read_pos
-   sync_write_pos may be >= sync_buffer_size. In such case the actual write
-   position is sync_write_pos % sync_buffer_size. */
-static unsigned int sync_write_pos;
-static unsigned int sync_read_pos;
+
+#if defined(SOUND_CALLBACK) && (defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+/* The positions are published with release/acquire ordering, so the
+   emulation thread never takes PLATFORM_SoundLock while producing audio. */
+#define SYNC_LOCKFREE
+#define SYNC_LOAD(pos) __atomic_load_n(&(pos), __ATOMIC_ACQUIRE)
+#define SYNC_STORE(pos, val) __atomic_store_n(&(pos), (val), __ATOMIC_RELEASE)
+#else
+#define SYNC_LOAD(pos) (pos)
+#define SYNC_STORE(pos, val) ((pos) = (val))
+#endif
+
+/* Keep the producer's and consumer's positions in separate cache lines. */
+enum { CACHE_LINE_SIZE = 64 };
+static struct {
+	char pad0[CACHE_LINE_SIZE];
+	unsigned int write;
+	char pad1[CACHE_LINE_SIZE - sizeof(unsigned int)];
+	unsigned int read;
+	char pad2[CACHE_LINE_SIZE - sizeof(unsigned int)];
+} sync_pos;
 
 unsigned int Sound_latency = 20;
 /* Cumulative audio difference. */
@@ -72,11 +114,26 @@ static unsigned int sync_est_fill;
 /* If sync_est_fill goes outside this bounds, emulation speed is adjusted. */
 static unsigned int sync_min_fill;
 static unsigned int sync_max_fill;
-#ifdef SOUND_CALLBACK
-#endif /* SOUND_CALLBACK */
 /* Time of last write of sudio to output device (either by Sound_Callback or
    WriteOut). */
 double last_audio_write_time;
+
+#ifdef SYNC_LOCKFREE
+#define SET_LAST_WRITE_TIME(t) do { double t_ = (t); __atomic_store(&last_audio_write_time, &t_, __ATOMIC_RELEASE); } while (0)
+static double GetLastWriteTime(void)
+{
+	double t;
+	__atomic_load(&last_audio_write_time, &t, __ATOMIC_ACQUIRE);
+	return t;
+}
+#define SYNC_LOCK()
+#define SYNC_UNLOCK()
+#else /* SYNC_LOCKFREE */
+#define SET_LAST_WRITE_TIME(t) (last_audio_write_time = (t))
+#define GetLastWriteTime() last_audio_write_time
+#define SYNC_LOCK() PLATFORM_SoundLock()
+#define SYNC_UNLOCK() PLATFORM_SoundUnlock()
+#endif /* SYNC_LOCKFREE */
 #endif /* SYNCHRONIZED_SOUND */
 
 enum { MAX_SAMPLE_SIZE = 2, /* for 16-bit */
@@ -88,6 +145,210 @@ enum { MAX_SAMPLE_SIZE = 2, /* for 16-bit */
        MAX_FRAME_SIZE = MAX_SAMPLE_SIZE * MAX_CHANNELS
 };
 
+int Sound_stats_enabled = FALSE;
+int Sound_stats_log_interval = 0;
+char Sound_stats_filename[FILENAME_MAX] = "";
+
+/* Histogram of durations in milliseconds, in power-of-2 buckets:
+   < 0.25, < 0.5, < 1, ..., < 256, >= 256. */
+enum { STATS_BUCKETS = 12 };
+typedef struct stats_hist_t {
+	unsigned long bucket[STATS_BUCKETS];
+	unsigned long count;
+	double sum;
+	double min;
+	double max;
+} stats_hist_t;
+
+/* The write period and underruns are updated by the audio output side
+   (possibly the callback thread), everything else by the emulation thread. */
+static struct {
+	double start_time;
+	stats_hist_t period;
+	stats_hist_t est_fill;
+	stats_hist_t avg_fill;
+	unsigned long underruns;
+	unsigned long underrun_frames;
+	unsigned long overruns;
+	unsigned long adjust_frames;
+	unsigned long speed_ups;
+	unsigned long slow_downs;
+	double chip_time[Sound_CHIP_COUNT];
+	double chip_max[Sound_CHIP_COUNT];
+	unsigned long chip_calls[Sound_CHIP_COUNT];
+	/* Calls in which the chip was silent and its synthesis was skipped. */
+	double chip_idle_time[Sound_CHIP_COUNT];
+	unsigned long chip_idle_calls[Sound_CHIP_COUNT];
+} stats;
+/* Time of the previous audio write, 0 if unknown. */
+static double stats_last_write = 0.0;
+/* Time of the next periodic log line, 0 if not scheduled yet. */
+static double stats_next_log = 0.0;
+static unsigned long stats_logged_underruns;
+static unsigned long stats_logged_overruns;
+
+static void StatsHistAdd(stats_hist_t *h, double ms)
+{
+	int i = 0;
+	double edge = 0.25;
+	while (i < STATS_BUCKETS - 1 && ms >= edge) {
+		edge *= 2.0;
+		i++;
+	}
+	h->bucket[i]++;
+	if (h->count == 0 || ms < h->min)
+		h->min = ms;
+	if (h->count == 0 || ms > h->max)
+		h->max = ms;
+	h->count++;
+	h->sum += ms;
+}
+
+static void StatsHistPrint(FILE *fp, char const *name, stats_hist_t const *h)
+{
+	int i;
+	double edge = 0.25;
+	if (h->count == 0) {
+		fprintf(fp, "%s: no samples\n", name);
+		return;
+	}
+	fprintf(fp, "%s: min %.2f ms, avg %.2f ms, max %.2f ms, %lu samples\n",
+	        name, h->min, h->sum / h->count, h->max, h->count);
+	for (i = 0; i < STATS_BUCKETS; i++) {
+		if (h->bucket[i] > 0) {
+			if (i < STATS_BUCKETS - 1)
+				fprintf(fp, "    < %6.2f ms: %lu\n", edge, h->bucket[i]);
+			else
+				fprintf(fp, "   >= %6.2f ms: %lu\n", edge / 2, h->bucket[i]);
+		}
+		edge *= 2.0;
+	}
+}
+
+/* Records the time since the previous audio write. */
+static void StatsWrite(void)
+{
+	double now = Util_time();
+	if (stats_last_write != 0.0)
+		StatsHistAdd(&stats.period, (now - stats_last_write) * 1000.0);
+	stats_last_write = now;
+}
+
+#ifdef SYNCHRONIZED_SOUND
+/* Converts an amount of bytes in sync_buffer to milliseconds. */
+static double StatsBytesToMs(double bytes)
+{
+	return bytes * 1000.0 / ((double)Sound_out.freq * Sound_out.channels * render_sample_size);
+}
+#endif /* SYNCHRONIZED_SOUND */
+
+static void StatsLog(void)
+{
+	double now = Util_time();
+	if (now < stats_next_log)
+		return;
+	if (stats_next_log != 0.0) {
+#ifdef SYNCHRONIZED_SOUND
+		Log_print("Sound: underruns +%lu, overruns +%lu, fill %.1f ms (avg %.1f ms), period max %.1f ms, speed +%lu/-%lu",
+		          stats.underruns - stats_logged_underruns,
+		          stats.overruns - stats_logged_overruns,
+		          StatsBytesToMs(sync_est_fill), StatsBytesToMs(avg_fill),
+		          stats.period.max, stats.speed_ups, stats.slow_downs);
+#else /* !SYNCHRONIZED_SOUND */
+		Log_print("Sound: underruns +%lu, period max %.1f ms",
+		          stats.underruns - stats_logged_underruns, stats.period.max);
+#endif /* !SYNCHRONIZED_SOUND */
+	}
+	stats_logged_underruns = stats.underruns;
+	stats_logged_overruns = stats.overruns;
+	stats_next_log = now + Sound_stats_log_interval;
+}
+
+static void StatsDump(void)
+{
+	FILE *fp = fopen(Sound_stats_filename, "w");
+	if (fp == NULL) {
+		Log_print("Cannot write sound statistics to %s", Sound_stats_filename);
+		return;
+	}
+	Sound_StatsPrint(fp);
+	fclose(fp);
+}
+
+void Sound_StatsChipTime(int chip, int idle, double seconds)
+{
+	if (idle) {
+		stats.chip_idle_time[chip] += seconds;
+		stats.chip_idle_calls[chip]++;
+	}
+	stats.chip_time[chip] += seconds;
+	if (seconds > stats.chip_max[chip])
+		stats.chip_max[chip] = seconds;
+	stats.chip_calls[chip]++;
+}
+
+void Sound_StatsReset(void)
+{
+	memset(&stats, 0, sizeof(stats));
+	stats.start_time = Util_time();
+	stats_last_write = 0.0;
+	stats_next_log = 0.0;
+	stats_logged_underruns = 0;
+	stats_logged_overruns = 0;
+}
+
+void Sound_StatsPrint(FILE *fp)
+{
+	static char const * const chip_names[Sound_CHIP_COUNT] = {
+		"POKEY", "Votrax", "SlightSID", "Evie", "SIDari", "SONari", "Melody PSG", "YAMari"
+	};
+	int i;
+
+	if (stats.start_time == 0.0)
+		Sound_StatsReset();
+	fprintf(fp, "Sound statistics for the last %.1f s%s\n", Util_time() - stats.start_time,
+	        Sound_stats_enabled ? "" : " (collection disabled)");
+	if (Sound_enabled) {
+		fprintf(fp, "Output: %u Hz, %u channel(s), %d-bit%s, hardware buffer %u ms\n",
+		        Sound_out.freq, Sound_out.channels, Sound_out.sample_size * 8,
+		        Sound_out.sample_size == 4 && Sound_out.float_samples ? " float" : "",
+		        Sound_out.buffer_ms);
+#ifdef SYNCHRONIZED_SOUND
+		fprintf(fp, "Latency: %u ms, fill bounds %.1f..%.1f ms\n", Sound_latency,
+		        StatsBytesToMs(sync_min_fill), StatsBytesToMs(sync_max_fill));
+#endif /* SYNCHRONIZED_SOUND */
+	}
+	fprintf(fp, "Underruns: %lu (%lu frames repeated)\n", stats.underruns, stats.underrun_frames);
+#ifdef SYNCHRONIZED_SOUND
+	fprintf(fp, "Overruns: %lu\n", stats.overruns);
+	fprintf(fp, "Speed corrections: %lu faster, %lu slower in %lu frames\n",
+	        stats.speed_ups, stats.slow_downs, stats.adjust_frames);
+#endif /* SYNCHRONIZED_SOUND */
+	StatsHistPrint(fp, "Write period", &stats.period);
+#ifdef SYNCHRONIZED_SOUND
+	StatsHistPrint(fp, "Estimated fill", &stats.est_fill);
+	StatsHistPrint(fp, "Average fill", &stats.avg_fill);
+#endif /* SYNCHRONIZED_SOUND */
+	for (i = 0; i < Sound_CHIP_COUNT; i++) {
+		if (stats.chip_calls[i] > 0)
+			fprintf(fp, "%-10s render: %.1f ms total, %.2f us avg, %.2f us max, %lu calls\n",
+			        chip_names[i], stats.chip_time[i] * 1000.0,
+			        stats.chip_time[i] * 1e6 / stats.chip_calls[i],
+			        stats.chip_max[i] * 1e6, stats.chip_calls[i]);
+		if (stats.chip_idle_calls[i] > 0) {
+			/* Estimate the saving from the average cost of a rendering call. */
+			unsigned long active_calls = stats.chip_calls[i] - stats.chip_idle_calls[i];
+			double saved = 0.0;
+			if (active_calls > 0)
+				saved = (stats.chip_time[i] - stats.chip_idle_time[i]) / active_calls
+				        * stats.chip_idle_calls[i] - stats.chip_idle_time[i];
+			fprintf(fp, "%-10s silent: %.1f%% of calls skipped, about %.1f ms saved\n",
+			        chip_names[i], stats.chip_idle_calls[i] * 100.0 / stats.chip_calls[i],
+			        saved > 0.0 ? saved * 1000.0 : 0.0);
+		}
+	}
+}
+
 int Sound_ReadConfig(char *option, char *ptr)
 {
 	if (strcmp(option, "SOUND_ENABLED") == 0)
@@ -96,16 +357,24 @@ int Sound_ReadConfig(char *option, char *ptr)
 		return (Sound_desired.freq = Util_sscandec(ptr)) != -1;
 	else if (strcmp(option, "SOUND_BITS") == 0) {
 		int bits = Util_sscandec(ptr);
-		if (bits != 8 && bits != 16)
+		if (bits != 8 && bits != 16 && bits != 32)
 			return FALSE;
 		Sound_desired.sample_size = bits / 8;
 	}
+	else if (strcmp(option, "SOUND_FLOAT") == 0)
+		return (Sound_desired.float_samples = Util_sscanbool(ptr)) != -1;
 	else if (strcmp(option, "SOUND_BUFFER_MS") == 0) {
 		int val = Util_sscandec(ptr);
 		if (val == -1)
 			return FALSE;
 		Sound_desired.buffer_ms = val;
 	}
+	else if (strcmp(option, "SOUND_GOVERNOR") == 0)
+		return (POKEYSND_governor_enabled = Util_sscanbool(ptr)) != -1;
+	else if (strcmp(option, "SOUND_STATS") == 0)
+		return (Sound_stats_enabled = Util_sscanbool(ptr)) != -1;
+	else if (strcmp(option, "SOUND_STATS_LOG") == 0)
+		return (Sound_stats_log_interval = Util_sscandec(ptr)) != -1;
 #ifdef SYNCHRONIZED_SOUND
 	else if (strcmp(option, "SOUND_LATENCY") == 0)
 		return (Sound_latency = Util_sscandec(ptr)) != -1;
@@ -120,7 +389,11 @@ void Sound_WriteConfig(FILE *fp)
 	fprintf(fp, "SOUND_ENABLED=%u\n", Sound_enabled);
 	fprintf(fp, "SOUND_RATE=%u\n", Sound_desired.freq);
 	fprintf(fp, "SOUND_BITS=%u\n", Sound_desired.sample_size * 8);
+	fprintf(fp, "SOUND_FLOAT=%d\n", Sound_desired.float_samples);
 	fprintf(fp, "SOUND_BUFFER_MS=%u\n", Sound_desired.buffer_ms);
+	fprintf(fp, "SOUND_GOVERNOR=%d\n", POKEYSND_governor_enabled);
+	fprintf(fp, "SOUND_STATS=%d\n", Sound_stats_enabled);
+	fprintf(fp, "SOUND_STATS_LOG=%d\n", Sound_stats_log_interval);
 #ifdef SYNCHRONIZED_SOUND
 	fprintf(fp, "SOUND_LATENCY=%u\n", Sound_latency);
 #endif /* SYNCHRONIZED_SOUND */
@@ -159,6 +432,14 @@ int Sound_Initialise(int *argc, char *argv[])
 			Sound_desired.sample_size = 2;
 		else if (strcmp(argv[i], "-audio8") == 0)
 			Sound_desired.sample_size = 1;
+		else if (strcmp(argv[i], "-audio32") == 0) {
+			Sound_desired.sample_size = 4;
+			Sound_desired.float_samples = FALSE;
+		}
+		else if (strcmp(argv[i], "-audiofloat") == 0) {
+			Sound_desired.sample_size = 4;
+			Sound_desired.float_samples = TRUE;
+		}
 		else if (strcmp(argv[i], "snd-buflen") == 0) {
 			if (i_a) {
 				int val = Util_sscandec(argv[++i]);
@@ -169,11 +450,38 @@ int Sound_Initialise(int *argc, char *argv[])
 			}
 			else a_m = TRUE;
 		}
+		else if (strcmp(argv[i], "-sndgovernor") == 0)
+			POKEYSND_governor_enabled = TRUE;
+		else if (strcmp(argv[i], "-nosndgovernor") == 0)
+			POKEYSND_governor_enabled = FALSE;
+		else if (strcmp(argv[i], "-sndstats") == 0)
+			Sound_stats_enabled = TRUE;
+		else if (strcmp(argv[i], "-sndstats-log") == 0) {
+			if (i_a) {
+				Sound_stats_enabled = TRUE;
+				a_i = (Sound_stats_log_interval = Util_sscandec(argv[++i])) == -1;
+			}
+			else a_m = TRUE;
+		}
+		else if (strcmp(argv[i], "-sndstats-file") == 0) {
+			if (i_a) {
+				Sound_stats_enabled = TRUE;
+				Util_strlcpy(Sound_stats_filename, argv[++i], sizeof(Sound_stats_filename));
+			}
+			else a_m = TRUE;
+		}
 #ifdef SYNCHRONIZED_SOUND
 		else if (strcmp(argv[i], "-snddelay") == 0)
 			if (i_a)
 				Sound_latency = Util_sscandec(argv[++i]);
 			else a_m = TRUE;
+		else if (strcmp(argv[i], "-audio-only") == 0) {
+			if (i_a) {
+				Atari800_audio_only = TRUE;
+				Util_strlcpy(audio_only_filename, argv[++i], sizeof(audio_only_filename));
+			}
+			else a_m = TRUE;
+		}
 #endif /* SYNCHRONIZED_SOUND */
 		else {
 			if (strcmp(argv[i], "-help") == 0) {
@@ -184,9 +492,18 @@ int Sound_Initialise(int *argc, char *argv[])
 				Log_print("\t-volume <0 .. 100>   Set sound output volume");
 				Log_print("\t-audio16             Set sound output format to 16-bit");
 				Log_print("\t-audio8              Set sound output format to 8-bit");
+				Log_print("\t-audio32             Set sound output format to 32-bit integer");
+				Log_print("\t-audiofloat          Set sound output format to 32-bit float");
 				Log_print("\t-snd-buflen <ms>     Set length of the hardware sound buffer in milliseconds");
+				Log_print("\t-sndgovernor         Lower sound synthesis quality when emulation is too slow");
+				Log_print("\t-nosndgovernor       Always use the configured sound synthesis quality");
+				Log_print("\t-sndstats            Collect sound latency and underrun statistics");
+				Log_print("\t-sndstats-log <s>    Log sound statistics every <s> seconds");
+				Log_print("\t-sndstats-file <f>   Write sound statistics to file <f> on exit");
 #ifdef SYNCHRONIZED_SOUND
 				Log_print("\t-snddelay <ms>       Set sound latency in milliseconds");
+				Log_print("\t-audio-only <file>   Run as fast as possible without video or sound output,");
+				Log_print("\t                     writing the sound to <file>");
 #endif /* SYNCHRONIZED_SOUND */
 			}
 			argv[j++] = argv[i];
@@ -204,6 +521,12 @@ int Sound_Initialise(int *argc, char *argv[])
 
 	if (help_only)
 		Sound_enabled = FALSE;
+	else if (Atari800_audio_only && !Sound_enabled) {
+		Log_print("-audio-only needs sound to be enabled");
+		return FALSE;
+	}
+
+	Sound_StatsReset();
 
 	return TRUE;
 }
@@ -217,21 +540,28 @@ int Sound_Setup(void)
 	else if (Sound_desired.freq < 1000)
 		/* Such low value is impractical. */
 		Sound_desired.freq = 1000;
-	else if (Sound_desired.freq > 65535)
-		/* POKEY emulation doesn't support rate > 65535 Hz. */
-		Sound_desired.freq = 65535;
+	else if (Sound_desired.freq > Sound_MAX_FREQ)
+		Sound_desired.freq = Sound_MAX_FREQ;
+	if (Sound_desired.sample_size != 1 && Sound_desired.sample_size != 4)
+		Sound_desired.sample_size = 2;
 
 	Sound_desired.buffer_frames = Sound_desired.freq * Sound_desired.buffer_ms / 1000;
 
 	Sound_out = Sound_desired;
-	if (!(Sound_enabled = PLATFORM_SoundSetup(&Sound_out)))
+	if (NO_AUDIO_DEVICE) {
+		/* No audio output, the samples only go to the sound file. */
+		if (Sound_out.buffer_frames == 0)
+			Sound_out.buffer_frames = Sound_NextPow2(Sound_out.freq * 4 / 50);
+		Sound_enabled = TRUE;
+	}
+	else if (!(Sound_enabled = PLATFORM_SoundSetup(&Sound_out)))
 		return FALSE;
 
 	Sound_out.buffer_ms = Sound_out.buffer_frames * 1000 / Sound_out.freq;
 
 	/* Now setup contains actual audio output settings. */
 	if ((POKEYSND_enable_new_pokey && Sound_out.freq < 8192)
-		|| Sound_out.freq < 1000 || Sound_out.freq > 65535) {
+		|| Sound_out.freq < 1000 || Sound_out.freq > Sound_MAX_FREQ) {
 		Log_print("%d frequency not supported", Sound_out.freq);
 		Sound_Exit();
 		return FALSE;
@@ -243,20 +573,39 @@ int Sound_Setup(void)
 	}
 
 	POKEYSND_stereo_enabled = Sound_out.channels == 2;
+	render_sample_size = Sound_out.sample_size > 2 ? 2 : Sound_out.sample_size;
+	free(render_buffer);
+	render_buffer = NULL;
+	if (render_sample_size != Sound_out.sample_size) {
+		render_buffer_size = Sound_out.buffer_frames * Sound_out.channels * render_sample_size;
+		render_buffer = Util_malloc(render_buffer_size);
+	}
 #ifndef SOUND_CALLBACK
 	free(process_buffer);
 	process_buffer_size = Sound_out.buffer_frames * Sound_out.channels * Sound_out.sample_size;
 	process_buffer = Util_malloc(process_buffer_size);
 #endif /* !SOUND_CALLBACK */
 
-	POKEYSND_Init(POKEYSND_FREQ_17_EXACT, Sound_out.freq, Sound_out.channels, Sound_out.sample_size == 2 ? POKEYSND_BIT16 : 0);
+	POKEYSND_Init(POKEYSND_FREQ_17_EXACT, Sound_out.freq, Sound_out.channels, render_sample_size == 2 ? POKEYSND_BIT16 : 0);
 
 #ifdef SYNCHRONIZED_SOUND
-	Sound_SetLatency(Sound_latency);
+	if (NO_AUDIO_DEVICE) {
+		if (audio_only_filename[0] != '\0') {
+			if (!SndSave_OpenSoundFile(audio_only_filename)) {
+				Log_print("Cannot write sound to %s", audio_only_filename);
+				Sound_Exit();
+				return FALSE;
+			}
+			audio_only_filename[0] = '\0';
+		}
+	}
+	else
+		Sound_SetLatency(Sound_latency);
 #endif /* SYNCHRONIZED_SOUND */
 
 	Sound_desired.freq = Sound_out.freq;
 	Sound_desired.sample_size = Sound_out.sample_size;
+	Sound_desired.float_samples = Sound_out.float_samples;
 	Sound_desired.channels = Sound_out.channels;
 	/* buffer_ms and buffer_frames are not copied from Sound_out back to
 	   Sound_desired. The reason is, for some backends (e.g. SDL on PulseAudio)
@@ -271,8 +620,13 @@ int Sound_Setup(void)
 void Sound_Exit(void)
 {
 	if (Sound_enabled) {
-		PLATFORM_SoundExit();
+		if (Sound_stats_enabled && Sound_stats_filename[0] != '\0')
+			StatsDump();
+		if (!NO_AUDIO_DEVICE)
+			PLATFORM_SoundExit();
 		Sound_enabled = FALSE;
+		free(render_buffer);
+		render_buffer = NULL;
 #ifndef SOUND_CALLBACK
 		free(process_buffer);
 		process_buffer = NULL;
@@ -288,7 +642,8 @@ void Sound_Pause(void)
 {
 	if (Sound_enabled && !paused) {
 		/* stop audio output */
-		PLATFORM_SoundPause();
+		if (!NO_AUDIO_DEVICE)
+			PLATFORM_SoundPause();
 		paused = TRUE;
 	}
 }
@@ -298,11 +653,14 @@ void Sound_Continue(void)
 	if (Sound_enabled && paused) {
 		/* start audio output */
 #ifdef SYNCHRONIZED_SOUND
-/*		sync_write_pos = sync_read_pos + sync_min_fill;
+/*		sync_pos.write = sync_pos.read + sync_min_fill;
 		avg_fill = sync_min_fill;*/
-		last_audio_write_time = Util_time();
+		SET_LAST_WRITE_TIME(Util_time());
 #endif /* SYNCHRONIZED_SOUND */
-		PLATFORM_SoundContinue();
+		/* Don't count the pause as a write period. */
+		stats_last_write = 0.0;
+		if (!NO_AUDIO_DEVICE)
+			PLATFORM_SoundContinue();
 		paused = FALSE;
 	}
 }
@@ -311,32 +669,28 @@ void Sound_Continue(void)
 static void FillBuffer(UBYTE *buffer, unsigned int size)
 {
 #ifdef SYNCHRONIZED_SOUND
-	unsigned int new_read_pos;
 	static UBYTE last_frame[MAX_FRAME_SIZE];
-	unsigned int bytes_per_frame = Sound_out.channels * Sound_out.sample_size;
-	unsigned int to_write = sync_write_pos - sync_read_pos;
+	unsigned int bytes_per_frame = Sound_out.channels * render_sample_size;
+	unsigned int read_pos = sync_pos.read;
+	unsigned int to_write = SYNC_LOAD(sync_pos.write) - read_pos;
 
 	if (to_write > 0) {
+		unsigned int offset = read_pos & (sync_buffer_size - 1);
 		if (to_write > size)
 			to_write = size;
 
-		new_read_pos = sync_read_pos + to_write;
-
-		if (new_read_pos <= sync_buffer_size)
+		if (offset + to_write <= sync_buffer_size)
 			/* no wrap */
-			memcpy(buffer, sync_buffer + sync_read_pos, to_write);
+			memcpy(buffer, sync_buffer + offset, to_write);
 		else {
 			/* wraps */
-			unsigned int first_part_size = sync_buffer_size - sync_read_pos;
-			memcpy(buffer, sync_buffer + sync_read_pos, first_part_size);
+			unsigned int first_part_size = sync_buffer_size - offset;
+			memcpy(buffer, sync_buffer + offset, first_part_size);
 			memcpy(buffer + first_part_size, sync_buffer, to_write - first_part_size);
 		}
 
-		sync_read_pos = new_read_pos;
-		if (sync_read_pos > sync_buffer_size) {
-			sync_read_pos -= sync_buffer_size;
-			sync_write_pos -= sync_buffer_size;
-		}
+		/* Hand the consumed space back to the producer. */
+		SYNC_STORE(sync_pos.read, read_pos + to_write);
 		/* Save the last frame as we may need it to fill underflow. */
 		memcpy(last_frame, buffer + to_write - bytes_per_frame, bytes_per_frame);
 	}
@@ -346,31 +700,66 @@ static void FillBuffer(UBYTE *buffer, unsigned int size)
 	if (to_write < size) {
 #if DEBUG
 		Log_print("Sound buffer underflow: fill %d, needed %d",
-		          to_write/Sound_out.channels/Sound_out.sample_size,
-		          size/Sound_out.channels/Sound_out.sample_size);
+		          to_write/Sound_out.channels/render_sample_size,
+		          size/Sound_out.channels/render_sample_size);
 #endif
+		if (Sound_stats_enabled) {
+			stats.underruns++;
+			stats.underrun_frames += (size - to_write) / bytes_per_frame;
+		}
 		do {
 			memcpy(buffer + to_write, last_frame, bytes_per_frame);
 			to_write += bytes_per_frame;
 		} while (to_write < size);
 	}
 #else /* !SYNCHRONIZED_SOUND */
-	POKEYSND_Process(buffer, size / Sound_out.sample_size);
+	POKEYSND_Process(buffer, size / render_sample_size);
 #endif /* !SYNCHRONIZED_SOUND */
 }
 
+/* Converts SAMPLES 16-bit samples from SRC to the 32-bit output format in DST. */
+static void WidenSamples(UBYTE const *src, UBYTE *dst, unsigned int samples)
+{
+	SWORD const *in = (SWORD const *) src;
+	if (Sound_out.float_samples) {
+		float *out = (float *) dst;
+		while (samples-- > 0)
+			*out++ = *in++ / 32768.0f;
+	}
+	else {
+		SLONG *out = (SLONG *) dst;
+		while (samples-- > 0)
+			*out++ = (SLONG) *in++ * 65536;
+	}
+}
+
 #ifdef SOUND_CALLBACK
 void Sound_Callback(UBYTE *buffer, unsigned int size)
 {
 #if DEBUG >= 2
 		Log_print("Callback: fill %u, needed %u",
-		          (sync_write_pos - sync_read_pos) / Sound_out.channels / Sound_out.sample_size,
+		          (sync_pos.write - sync_pos.read) / Sound_out.channels / render_sample_size,
 		          size / Sound_out.channels / Sound_out.sample_size);
 #endif
-	FillBuffer(buffer, size);
+	if (render_buffer != NULL) {
+		/* Render in chunks of render_buffer and widen them into BUFFER. */
+		unsigned int chunk = render_buffer_size / render_sample_size * Sound_out.sample_size;
+		while (size > 0) {
+			unsigned int len = size > chunk ? chunk : size;
+			unsigned int samples = len / Sound_out.sample_size;
+			FillBuffer(render_buffer, samples * render_sample_size);
+			WidenSamples(render_buffer, buffer, samples);
+			buffer += len;
+			size -= len;
+		}
+	}
+	else
+		FillBuffer(buffer, size);
 #ifdef SYNCHRONIZED_SOUND
-	last_audio_write_time = Util_time();
+	SET_LAST_WRITE_TIME(Util_time());
 #endif /* SYNCHRONIZED_SOUND */
+	if (Sound_stats_enabled)
+		StatsWrite();
 }
 #else /* !SOUND_CALLBACK */
 /* Write audio to output device. */
@@ -381,19 +770,27 @@ static void WriteOut(void)
 	if (avail > 0) {
 #if DEBUG >= 2
 		Log_print("WriteOut: fill %u, needed %u",
-		          (sync_write_pos - sync_read_pos) / Sound_out.channels / Sound_out.sample_size,
+		          (sync_pos.write - sync_pos.read) / Sound_out.channels / render_sample_size,
 		          avail / Sound_out.channels / Sound_out.sample_size);
 #endif
 		/* On some platforms (eg. NestedVM) avail may be larger than process_buffer_size. */
 		do {
 			unsigned int len = avail > process_buffer_size ? process_buffer_size : avail;
-			FillBuffer(process_buffer, len);
+			if (render_buffer != NULL) {
+				unsigned int samples = len / Sound_out.sample_size;
+				FillBuffer(render_buffer, samples * render_sample_size);
+				WidenSamples(render_buffer, process_buffer, samples);
+			}
+			else
+				FillBuffer(process_buffer, len);
 			PLATFORM_SoundWrite(process_buffer, len);
 			avail -= len;
 		} while (avail > 0);
 #ifdef SYNCHRONIZED_SOUND
-		last_audio_write_time = Util_time();
+		SET_LAST_WRITE_TIME(Util_time());
 #endif /* SYNCHRONIZED_SOUND */
+		if (Sound_stats_enabled)
+			StatsWrite();
 	}
 }
 #endif /* !SOUND_CALLBACK */
@@ -404,78 +801,81 @@ static void UpdateSyncBuffer(void)
 	unsigned int bytes_written;
 	unsigned int samples_written;
 	unsigned int fill;
-	unsigned int new_write_pos;
+	unsigned int write_pos = sync_pos.write;
+	unsigned int offset;
 
-	PLATFORM_SoundLock();
+	SYNC_LOCK();
 	/* Current fill of the audio buffer. */
-	fill = sync_write_pos - sync_read_pos;
+	fill = write_pos - SYNC_LOAD(sync_pos.read);
 
 	/* Update sync_est_fill. */
 	{
 		unsigned int est_gap;
-		est_gap = (Util_time() - last_audio_write_time)*Sound_out.freq*Sound_out.channels*Sound_out.sample_size;
+		est_gap = (Util_time() - GetLastWriteTime())*Sound_out.freq*Sound_out.channels*render_sample_size;
 		if (fill < est_gap)
 			sync_est_fill = 0;
 		else
 			sync_est_fill = fill - est_gap;
 	}
+	if (Sound_stats_enabled)
+		StatsHistAdd(&stats.est_fill, StatsBytesToMs(sync_est_fill));
 
 	if (Atari800_turbo && sync_est_fill > sync_max_fill) {
-		PLATFORM_SoundUnlock();
+		SYNC_UNLOCK();
 		return;
 	}
 
 	/* produce samples from the sound emulation */
 	samples_written = POKEYSND_UpdateProcessBuffer();
-	bytes_written = Sound_out.sample_size * samples_written;
+	bytes_written = render_sample_size * samples_written;
 
 	/* if there isn't enough room... */
 	if (bytes_written > sync_buffer_size - fill) {
 		/* Overflow of sync_buffer. */
 #if DEBUG
 		Log_print("Sound buffer overflow: free %d, needed %d",
-				  (sync_buffer_size - fill)/Sound_out.channels/Sound_out.sample_size,
-				  bytes_written/Sound_out.channels/Sound_out.sample_size);
+				  (sync_buffer_size - fill)/Sound_out.channels/render_sample_size,
+				  bytes_written/Sound_out.channels/render_sample_size);
 #endif
+		if (Sound_stats_enabled)
+			stats.overruns++;
 		/* Wait until hardware buffer can be filled, or wait until callback
 		   makes place in the buffer. */
 		do {
-			PLATFORM_SoundUnlock();
+			SYNC_UNLOCK();
 #ifndef __MINT__	/* this does more harm than good on Atari */
 			/* Sleep for the duration of one full HW buffer. */
 			Util_sleep((double)Sound_out.buffer_frames / Sound_out.freq);
 #endif
-			PLATFORM_SoundLock();
+			SYNC_LOCK();
 #ifndef SOUND_CALLBACK
 			WriteOut(); /* Write to audio buffer as much as possible. */
 #endif /* SOUND_CALLBACK */
-			fill = sync_write_pos - sync_read_pos;
+			fill = write_pos - SYNC_LOAD(sync_pos.read);
 		} while (bytes_written > sync_buffer_size - fill);
 	}
 	/* Now bytes_written <= audio_buffer_size + dsp_read_pos - dsp_write_pos) */
 
 #if DEBUG >= 2
 	Log_print("UpdateSyncBuffer: est_gap: %f, fill %u, write %u",
-			(Util_time() - last_audio_write_time)*Sound_out.freq,
-	          fill / Sound_out.channels/Sound_out.sample_size,
-	          bytes_written / Sound_out.channels/Sound_out.sample_size);
+			(Util_time() - GetLastWriteTime())*Sound_out.freq,
+	          fill / Sound_out.channels/render_sample_size,
+	          bytes_written / Sound_out.channels/render_sample_size);
 #endif
-	/* now we copy the data into the buffer and adjust the positions */
-	new_write_pos = sync_write_pos + bytes_written;
-	if (new_write_pos/sync_buffer_size == sync_write_pos/sync_buffer_size)
+	/* now we copy the data into the buffer and publish the new position */
+	offset = write_pos & (sync_buffer_size - 1);
+	if (offset + bytes_written <= sync_buffer_size)
 		/* no wrap */
-		memcpy(sync_buffer + sync_write_pos%sync_buffer_size, POKEYSND_process_buffer, bytes_written);
+		memcpy(sync_buffer + offset, POKEYSND_frame_buffer, bytes_written);
 	else {
 		/* wraps */
-		int first_part_size = sync_buffer_size - sync_write_pos%sync_buffer_size;
-		memcpy(sync_buffer + sync_write_pos%sync_buffer_size, POKEYSND_process_buffer, first_part_size);
-		memcpy(sync_buffer, POKEYSND_process_buffer + first_part_size, bytes_written - first_part_size);
+		unsigned int first_part_size = sync_buffer_size - offset;
+		memcpy(sync_buffer + offset, POKEYSND_frame_buffer, first_part_size);
+		memcpy(sync_buffer, POKEYSND_frame_buffer + first_part_size, bytes_written - first_part_size);
 	}
 
-	sync_write_pos = new_write_pos;
-	if (sync_write_pos > sync_read_pos + sync_buffer_size)
-		sync_write_pos -= sync_buffer_size;
-	PLATFORM_SoundUnlock();
+	SYNC_STORE(sync_pos.write, write_pos + bytes_written);
+	SYNC_UNLOCK();
 }
 #endif /* SYNCHRONIZED_SOUND */
 
@@ -484,11 +884,19 @@ void Sound_Update(void)
 	if (!Sound_enabled || paused)
 		return;
 #ifdef SYNCHRONIZED_SOUND
+	if (NO_AUDIO_DEVICE) {
+		/* Nothing plays the frame's samples; they stay in
+		   POKEYSND_frame_buffer and go to the sound file. */
+		POKEYSND_UpdateProcessBuffer();
+		return;
+	}
 	UpdateSyncBuffer();
 #endif /* SYNCHRONIZED_SOUND */
 #ifndef SOUND_CALLBACK
 	WriteOut();
 #endif /* !SOUND_CALLBACK */
+	if (Sound_stats_enabled && Sound_stats_log_interval > 0)
+		StatsLog();
 }
 
 #ifdef SYNCHRONIZED_SOUND
@@ -498,15 +906,16 @@ void Sound_SetLatency(unsigned int latency)
 	if (Sound_enabled) {
 		/* how many fragments in the audio buffer */
 		enum { SYNC_BUFFER_FRAGS = 5 };
-		unsigned int bytes_per_frame = Sound_out.channels * Sound_out.sample_size;
+		unsigned int bytes_per_frame = Sound_out.channels * render_sample_size;
 		unsigned int latency_frames = Sound_out.freq*Sound_latency/1000;
+		/* The callback must not run while the ring is being replaced. */
 		PLATFORM_SoundLock();
-		sync_buffer_size = (latency_frames + SYNC_BUFFER_FRAGS*Sound_out.buffer_frames) * bytes_per_frame;
+		sync_buffer_size = Sound_NextPow2((latency_frames + SYNC_BUFFER_FRAGS*Sound_out.buffer_frames) * bytes_per_frame - 1);
 		sync_min_fill = latency_frames * bytes_per_frame;
 		sync_max_fill = sync_min_fill + Sound_out.buffer_frames * bytes_per_frame;
 		avg_fill = sync_min_fill;
-		sync_read_pos = 0;
-		sync_write_pos = sync_min_fill;
+		sync_pos.read = 0;
+		sync_pos.write = sync_min_fill;
 		free(sync_buffer);
 		sync_buffer = Util_malloc(sync_buffer_size);
 		memset(sync_buffer, 0, sync_buffer_size);
@@ -527,6 +936,14 @@ double Sound_AdjustSpeed(void)
 		else if (avg_fill > sync_max_fill)
 			delay_mult = 1.05;
 #endif
+		if (Sound_stats_enabled) {
+			StatsHistAdd(&stats.avg_fill, StatsBytesToMs(avg_fill));
+			stats.adjust_frames++;
+			if (delay_mult < 1.0)
+				stats.speed_ups++;
+			else if (delay_mult > 1.0)
+				stats.slow_downs++;
+		}
 #if 0
 		if (sync_est_fill < sync_min_fill)
 			delay_mult = 0.95;
@@ -536,11 +953,11 @@ double Sound_AdjustSpeed(void)
 #if DEBUG >= 2
 		Log_print("delay_mult: %f, est_fill: %u, avg_fill: %f, buf_size: %u, min_fill: %u, max_fill: %u",
 		          delay_mult,
-		          sync_est_fill / Sound_out.channels / Sound_out.sample_size,
-		          avg_fill / Sound_out.channels / Sound_out.sample_size,
-		          sync_buffer_size / Sound_out.channels / Sound_out.sample_size,
-		          sync_min_fill / Sound_out.channels / Sound_out.sample_size,
-		          sync_max_fill / Sound_out.channels / Sound_out.sample_size);
+		          sync_est_fill / Sound_out.channels / render_sample_size,
+		          avg_fill / Sound_out.channels / render_sample_size,
+		          sync_buffer_size / Sound_out.channels / render_sample_size,
+		          sync_min_fill / Sound_out.channels / render_sample_size,
+		          sync_max_fill / Sound_out.channels / render_sample_size);
 #endif
 	}
 	return delay_mult;
@@ -24,12 +24,17 @@ void Sound_Reinit(void);
    The word "size", unless additionally specified, means size in bytes.
  */
 
+/* Highest supported sample rate. */
+#define Sound_MAX_FREQ 192000
+
 typedef struct Sound_setup_t {
-	/* Sound sample rate - number of frames per second: 1000..65535. */
+	/* Sound sample rate - number of frames per second: 1000..Sound_MAX_FREQ. */
 	unsigned int freq;
 	/* Number of bytes per each sample, also determines sample format:
 	   1 = unsigned 8-bit format.
-	   2 = signed 16-bit system-endian format. */
+	   2 = signed 16-bit system-endian format.
+	   4 = signed 32-bit or 32-bit float system-endian format,
+	       depending on float_samples. */
 	int sample_size;
 	/* Number of audio channels: 1 = mono, 2 = stereo. */
 	unsigned int channels;
@@ -38,6 +43,12 @@ typedef struct Sound_setup_t {
 	/* Size of the hardware audio buffer in frames. Computed internally,
 	   equals freq * buffer_ms / 1000. */
 	unsigned int buffer_frames;
+	/* Only for sample_size 4: TRUE = float in -1.0..1.0, FALSE = signed
+	   32-bit. Sound chips always render 16-bit samples; they are converted
+	   to the 32-bit formats just before reaching the platform code.
+	   Platforms that can't play a 32-bit format should set sample_size
+	   to 2 in PLATFORM_SoundSetup. */
+	int float_samples;
 } Sound_setup_t;
 
 /* Holds parameters of the audio output desired by user. When calling Sound_Setup(),
@@ -91,6 +102,35 @@ void Sound_SetLatency(unsigned int latency);
 double Sound_AdjustSpeed(void);
 #endif /* SYNCHRONIZED_SOUND */
 
+/* Audio pipeline statistics. Nothing is measured unless Sound_stats_enabled
+   is TRUE. */
+extern int Sound_stats_enabled;
+/* Seconds between statistics lines printed with Log_print; 0 = never. */
+extern int Sound_stats_log_interval;
+/* If not empty, statistics are written to this file on Sound_Exit. */
+extern char Sound_stats_filename[FILENAME_MAX];
+
+/* Sound chips whose render time is measured. */
+enum {
+	Sound_CHIP_POKEY,
+	Sound_CHIP_VOTRAX,
+	Sound_CHIP_SLIGHTSID,
+	Sound_CHIP_EVIE,
+	Sound_CHIP_SIDARI,
+	Sound_CHIP_SONARI,
+	Sound_CHIP_MELODY_PSG,
+	Sound_CHIP_YAMARI,
+	Sound_CHIP_COUNT
+};
+
+/* Adds SECONDS of host time spent rendering audio of chip CHIP. IDLE is
+   TRUE if the chip was silent and its synthesis was skipped. */
+void Sound_StatsChipTime(int chip, int idle, double seconds);
+/* Clears all collected statistics. */
+void Sound_StatsReset(void);
+/* Prints all collected statistics to FP. */
+void Sound_StatsPrint(FILE *fp);
+
 /* Helper function for use when hardware audio buffer size is required to
    equal a power of 2. Returns a power of 2 that is not lower than NUM
    (0 <= NUM < UINT_MAX). */
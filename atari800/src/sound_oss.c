@@ -93,7 +93,19 @@ int PLATFORM_SoundSetup(Sound_setup_t *setup)
 		return FALSE;
 	}
 
-	format = setup->sample_size == 2 ? AFMT_S16_NE : AFMT_U8;
+	switch (setup->sample_size) {
+	case 1:
+		format = AFMT_U8;
+		break;
+#if defined(AFMT_S32_NE) && defined(AFMT_FLOAT)
+	/* OSS 4 only */
+	case 4:
+		format = setup->float_samples ? AFMT_FLOAT : AFMT_S32_NE;
+		break;
+#endif
+	default:
+		format = AFMT_S16_NE;
+	}
 	if (ioctl(dsp_fd, SNDCTL_DSP_SETFMT, &format) == -1) {
 		Log_print("%s: SNDCTL_DSP_SETFMT(%i) failed", dspname, format);
 		close(dsp_fd);
@@ -103,6 +115,16 @@ int PLATFORM_SoundSetup(Sound_setup_t *setup)
 		setup->sample_size = 2;
 	else if (format == AFMT_U8)
 		setup->sample_size = 1;
+#if defined(AFMT_S32_NE) && defined(AFMT_FLOAT)
+	else if (format == AFMT_S32_NE) {
+		setup->sample_size = 4;
+		setup->float_samples = FALSE;
+	}
+	else if (format == AFMT_FLOAT) {
+		setup->sample_size = 4;
+		setup->float_samples = TRUE;
+	}
+#endif
 	else {
 		Log_print("%s: Obtained format %i not supported", dspname, format);
 		close(dsp_fd);
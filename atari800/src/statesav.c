@@ -40,6 +40,10 @@
 #else
 #define gzFile char *
 #define Z_OK 0
+#define Z_BUF_ERROR (-5)
+#endif
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
 #endif
 #ifdef LIBATARI800
 #include "libatari800/init.h"
@@ -97,7 +101,7 @@
 
 #define SAVE_VERSION_NUMBER 8 /* Last changed after Atari800 3.1.0 */
 
-#if defined(MEMCOMPR) || defined(LIBATARI800)
+#ifdef MEMCOMPR
 static gzFile mem_open(const char *name, const char *mode);
 static int mem_close(gzFile stream);
 static size_t mem_read(void *buf, size_t len, gzFile stream);
@@ -106,41 +110,141 @@ static size_t mem_write(const void *buf, size_t len, gzFile stream);
 #define GZCLOSE(X)       mem_close(X)
 #define GZREAD(X, Y, Z)  mem_read(Y, Z, X)
 #define GZWRITE(X, Y, Z) mem_write(Y, Z, X)
-#undef GZERROR
-#elif defined(HAVE_LIBZ) /* above MEMCOMPR, below HAVE_LIBZ */
-#define GZOPEN(X, Y)     gzopen(X, Y)
-#define GZCLOSE(X)       gzclose(X)
-#define GZREAD(X, Y, Z)  gzread(X, Y, Z)
-#define GZWRITE(X, Y, Z) gzwrite(X, (const voidp) Y, Z)
-#define GZERROR(X, Y)    gzerror(X, Y)
+#endif /* MEMCOMPR */
+
+#if defined(HAVE_LIBZ)
+int StateSav_format = StateSav_FORMAT_GZIP;
 #else
-#define GZOPEN(X, Y)     fopen(X, Y)
-#define GZCLOSE(X)       fclose(X)
-#define GZREAD(X, Y, Z)  fread(Y, Z, 1, X)
-#define GZWRITE(X, Y, Z) fwrite(Y, Z, 1, X)
-#undef GZERROR
-#define gzFile  FILE *
-#define Z_OK    0
+int StateSav_format = StateSav_FORMAT_RAW;
 #endif
 
 static gzFile StateFile = NULL;
 static int nFileError = Z_OK;
 
-static void GetGZErrorText(void)
+/* Set by StateSav_SaveAtariStateMem and StateSav_ReadAtariStateMem, which
+   use a buffer instead of StateFile */
+static UBYTE *MemBuffer = NULL;
+static size_t MemSize;
+static size_t MemOffset;
+
+#ifndef MEMCOMPR
+/* State files are saved to and read from here in one piece; MemBuffer is
+   FileBuffer and grows with the state while MemGrow is set. */
+static UBYTE *FileBuffer = NULL;
+static size_t FileBufferSize = 0;
+static int MemGrow = FALSE;
+#endif
+
+/* A state delta is a series of blobs of the state save with the blocks
+   saved by StateSav_SavePages between them:
+
+     4 bytes: length of the blob, then the blob
+     4 bytes: offset of the block in the state made from the previous delta
+     4 bytes: length of the block
+     one bit for each 256-byte page of the block, set if the page follows
+     the pages
+
+   The last blob ends the delta. Numbers are little-endian. */
+typedef struct {
+	const UBYTE *dirty;
+	ULONG offset;	/* in the state made from the delta */
+	int num;
+} delta_block_t;
+
+static int DeltaMode = FALSE;
+/* Blocks of the previous delta; DeltaBlock is the index of the next one
+   in the delta being saved. */
+static delta_block_t *DeltaBlocks = NULL;
+static int DeltaNumBlocks = 0;
+static int DeltaBlocksSize = 0;
+static int DeltaBlock;
+/* Where the length of the current blob goes in MemBuffer */
+static size_t DeltaBlobStart;
+/* Length of the state that the delta being saved makes so far */
+static ULONG DeltaStateLength;
+
+static void PutLong(UBYTE *p, ULONG n)
 {
-#ifdef GZERROR
-	const char *error = GZERROR(StateFile, &nFileError);
-	if (nFileError == Z_ERRNO) {
-#ifdef HAVE_STRERROR
-		Log_print("The following general file I/O error occurred:");
-		Log_print(strerror(errno));
+	p[0] = (UBYTE) n;
+	p[1] = (UBYTE) (n >> 8);
+	p[2] = (UBYTE) (n >> 16);
+	p[3] = (UBYTE) (n >> 24);
+}
+
+static ULONG GetLong(const UBYTE *p)
+{
+	return p[0] | (p[1] << 8) | ((ULONG) p[2] << 16) | ((ULONG) p[3] << 24);
+}
+
+static size_t MemWrite(const void *buf, size_t len)
+{
+	if (MemOffset + len > MemSize) {
+#ifndef MEMCOMPR
+		if (!MemGrow)
+			return 0;
+		FileBufferSize = MemOffset + len > FileBufferSize * 2 ? MemOffset + len : FileBufferSize * 2;
+		FileBuffer = (UBYTE *) Util_realloc(FileBuffer, FileBufferSize);
+		MemBuffer = FileBuffer;
+		MemSize = FileBufferSize;
+#else
+		return 0;
+#endif
+	}
+	memcpy(MemBuffer + MemOffset, buf, len);
+	MemOffset += len;
+	return len;
+}
+
+static size_t StateWrite(const void *buf, size_t len)
+{
+	if (MemBuffer != NULL) {
+		if (DeltaMode)
+			DeltaStateLength += len;
+		return MemWrite(buf, len);
+	}
+#ifdef MEMCOMPR
+	return GZWRITE(StateFile, buf, len);
+#else
+	return 0;
+#endif
+}
+
+static size_t StateRead(void *buf, size_t len)
+{
+	if (MemBuffer != NULL) {
+		if (MemOffset + len > MemSize)
+			return 0;
+		memcpy(buf, MemBuffer + MemOffset, len);
+		MemOffset += len;
+		return len;
+	}
+#ifdef MEMCOMPR
+	return GZREAD(StateFile, buf, len);
+#else
+	return 0;
+#endif
+}
+
+static int StateClose(void)
+{
+	if (MemBuffer != NULL) {
+		MemBuffer = NULL;
+		return 0;
+	}
+#ifdef MEMCOMPR
+	return GZCLOSE(StateFile);
 #else
-		Log_print("A file I/O error occurred");
+	return 0;
 #endif
+}
+
+static void GetGZErrorText(void)
+{
+	if (MemBuffer != NULL) {
+		/* the caller sees it in the result */
+		nFileError = Z_BUF_ERROR;
 		return;
 	}
-	Log_print("ZLIB returned the following error: %s", error);
-#endif /* GZERROR */
 	Log_print("State file I/O failed.");
 }
 
@@ -154,7 +258,66 @@ void StateSav_SaveUBYTE(const UBYTE *data, int num)
 	   directly to the active bits if in a padded location. If not (unlikely)
 	   you'll have to redefine this to save appropriately for cross-platform
 	   compatibility */
-	if (GZWRITE(StateFile, data, num) == 0)
+	if (StateWrite(data, num) == 0)
+		GetGZErrorText();
+}
+
+void StateSav_SavePages(const UBYTE *data, int num, UBYTE *dirty)
+{
+	delta_block_t *block;
+	int known;
+	int pages = num >> 8;
+	int bitmap_len = (pages + 7) >> 3;
+	int i;
+
+	if (!DeltaMode) {
+		StateSav_SaveUBYTE(data, num);
+		return;
+	}
+	if (!StateFile || nFileError != Z_OK)
+		return;
+
+	if (DeltaBlock >= DeltaBlocksSize) {
+		DeltaBlocksSize = DeltaBlocksSize == 0 ? 16 : DeltaBlocksSize * 2;
+		DeltaBlocks = (delta_block_t *) Util_realloc(DeltaBlocks, DeltaBlocksSize * sizeof(delta_block_t));
+	}
+	block = &DeltaBlocks[DeltaBlock];
+	known = DeltaBlock < DeltaNumBlocks && dirty != NULL && block->dirty == dirty && block->num == num;
+
+	/* end the blob and write the block header */
+	if (MemOffset + 8 + bitmap_len > MemSize) {
+		GetGZErrorText();
+		return;
+	}
+	PutLong(MemBuffer + DeltaBlobStart, (ULONG) (MemOffset - DeltaBlobStart - 4));
+	PutLong(MemBuffer + MemOffset, known ? block->offset : 0);
+	PutLong(MemBuffer + MemOffset + 4, (ULONG) num);
+	MemOffset += 8;
+	memset(MemBuffer + MemOffset, 0, bitmap_len);
+	for (i = 0; i < pages; i++) {
+		if (!known || dirty[i]) {
+			MemBuffer[MemOffset + (i >> 3)] |= 1 << (i & 7);
+		}
+	}
+	MemOffset += bitmap_len;
+	for (i = 0; i < pages; i++) {
+		if ((!known || dirty[i]) && MemWrite(data + (i << 8), 256) == 0) {
+			GetGZErrorText();
+			return;
+		}
+	}
+	if (dirty != NULL)
+		memset(dirty, 0, pages);
+
+	block->dirty = dirty;
+	block->offset = DeltaStateLength;
+	block->num = num;
+	DeltaBlock++;
+	DeltaStateLength += num;
+
+	/* start the next blob */
+	DeltaBlobStart = MemOffset;
+	if (MemWrite("\0\0\0\0", 4) == 0)
 		GetGZErrorText();
 }
 
@@ -164,13 +327,19 @@ void StateSav_ReadUBYTE(UBYTE *data, int num)
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
-	if (GZREAD(StateFile, data, num) == 0)
+	if (StateRead(data, num) == 0)
 		GetGZErrorText();
 }
 
+/* Fields are converted in pieces of this many bytes and written or read with
+   one call each. */
+#define FIELD_BUFFER_SIZE 256
+
 /* Value is memory location of data, num is number of type to save */
 void StateSav_SaveUWORD(const UWORD *data, int num)
 {
+	UBYTE buf[FIELD_BUFFER_SIZE];
+
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
@@ -179,52 +348,46 @@ void StateSav_SaveUWORD(const UWORD *data, int num)
 	   LSB order. The shifts here and in the read routines will work for both
 	   LSB and MSB architectures. */
 	while (num > 0) {
-		UWORD temp;
-		UBYTE byte;
-
-		temp = *data++;
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
+		int n = num < FIELD_BUFFER_SIZE / 2 ? num : FIELD_BUFFER_SIZE / 2;
+		int i;
+		for (i = 0; i < n; i++) {
+			UWORD temp = *data++;
+			buf[2 * i] = temp & 0xff;
+			buf[2 * i + 1] = (temp >> 8) & 0xff;
 		}
-
-		temp >>= 8;
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
+		if (StateWrite(buf, 2 * n) == 0) {
 			GetGZErrorText();
 			break;
 		}
-		num--;
+		num -= n;
 	}
 }
 
 /* Value is memory location of data, num is number of type to save */
 void StateSav_ReadUWORD(UWORD *data, int num)
 {
+	UBYTE buf[FIELD_BUFFER_SIZE];
+
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
 	while (num > 0) {
-		UBYTE byte1, byte2;
-
-		if (GZREAD(StateFile, &byte1, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		if (GZREAD(StateFile, &byte2, 1) == 0) {
+		int n = num < FIELD_BUFFER_SIZE / 2 ? num : FIELD_BUFFER_SIZE / 2;
+		int i;
+		if (StateRead(buf, 2 * n) == 0) {
 			GetGZErrorText();
 			break;
 		}
-
-		*data++ = (byte2 << 8) | byte1;
-		num--;
+		for (i = 0; i < n; i++)
+			*data++ = (buf[2 * i + 1] << 8) | buf[2 * i];
+		num -= n;
 	}
 }
 
 void StateSav_SaveINT(const int *data, int num)
 {
+	UBYTE buf[FIELD_BUFFER_SIZE];
+
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
@@ -233,88 +396,55 @@ void StateSav_SaveINT(const int *data, int num)
 	   for each int; on read it will be extended out to its proper position for the
 	   native INT size */
 	while (num > 0) {
-		UBYTE signbit = 0;
-		unsigned int temp;
-		UBYTE byte;
-		int temp0;
-
-		temp0 = *data++;
-		if (temp0 < 0) {
-			temp0 = -temp0;
-			signbit = 0x80;
-		}
-		temp = (unsigned int) temp0;
-
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		temp >>= 8;
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
+		int n = num < FIELD_BUFFER_SIZE / 4 ? num : FIELD_BUFFER_SIZE / 4;
+		int i;
+		for (i = 0; i < n; i++) {
+			UBYTE signbit = 0;
+			unsigned int temp;
+			int temp0;
+
+			temp0 = *data++;
+			if (temp0 < 0) {
+				temp0 = -temp0;
+				signbit = 0x80;
+			}
+			temp = (unsigned int) temp0;
 
-		temp >>= 8;
-		byte = temp & 0xff;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
-			GetGZErrorText();
-			break;
+			buf[4 * i] = temp & 0xff;
+			buf[4 * i + 1] = (temp >> 8) & 0xff;
+			buf[4 * i + 2] = (temp >> 16) & 0xff;
+			buf[4 * i + 3] = ((temp >> 24) & 0x7f) | signbit;
 		}
-
-		temp >>= 8;
-		byte = (temp & 0x7f) | signbit;
-		if (GZWRITE(StateFile, &byte, 1) == 0) {
+		if (StateWrite(buf, 4 * n) == 0) {
 			GetGZErrorText();
 			break;
 		}
-
-		num--;
+		num -= n;
 	}
 }
 
 void StateSav_ReadINT(int *data, int num)
 {
+	UBYTE buf[FIELD_BUFFER_SIZE];
+
 	if (!StateFile || nFileError != Z_OK)
 		return;
 
 	while (num > 0) {
-		UBYTE signbit = 0;
-		int temp;
-		UBYTE byte1, byte2, byte3, byte4;
-
-		if (GZREAD(StateFile, &byte1, 1) == 0) {
+		int n = num < FIELD_BUFFER_SIZE / 4 ? num : FIELD_BUFFER_SIZE / 4;
+		int i;
+		if (StateRead(buf, 4 * n) == 0) {
 			GetGZErrorText();
 			break;
 		}
-
-		if (GZREAD(StateFile, &byte2, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		if (GZREAD(StateFile, &byte3, 1) == 0) {
-			GetGZErrorText();
-			break;
-		}
-
-		if (GZREAD(StateFile, &byte4, 1) == 0) {
-			GetGZErrorText();
-			break;
+		for (i = 0; i < n; i++) {
+			const UBYTE *p = buf + 4 * i;
+			int temp = ((p[3] & 0x7f) << 24) | (p[2] << 16) | (p[1] << 8) | p[0];
+			if (p[3] & 0x80)
+				temp = -temp;
+			*data++ = temp;
 		}
-
-		signbit = byte4 & 0x80;
-		byte4 &= 0x7f;
-
-		temp = (byte4 << 24) | (byte3 << 16) | (byte2 << 8) | byte1;
-		if (signbit)
-			temp = -temp;
-		*data++ = temp;
-
-		num--;
+		num -= n;
 	}
 }
 
@@ -352,25 +482,14 @@ void StateSav_ReadFNAME(char *filename)
 	filename[namelen] = 0;
 }
 
-int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose)
+/* Writes the state to StateFile or MemBuffer and closes it. */
+static int SaveState(UBYTE SaveVerbose)
 {
 	UBYTE StateVersion = SAVE_VERSION_NUMBER;
 
-	if (StateFile != NULL) {
-		GZCLOSE(StateFile);
-		StateFile = NULL;
-	}
-	nFileError = Z_OK;
-
-	StateFile = GZOPEN(filename, mode);
-	if (StateFile == NULL) {
-		Log_print("Could not open %s for state save.", filename);
+	if (StateWrite("ATARI800", 8) == 0) {
 		GetGZErrorText();
-		return FALSE;
-	}
-	if (GZWRITE(StateFile, "ATARI800", 8) == 0) {
-		GetGZErrorText();
-		GZCLOSE(StateFile);
+		StateClose();
 		StateFile = NULL;
 		return FALSE;
 	}
@@ -447,7 +566,7 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 #endif
 
 	STATESAV_TAG(size);
-	if (GZCLOSE(StateFile) != 0) {
+	if (StateClose() != 0) {
 		StateFile = NULL;
 		return FALSE;
 	}
@@ -459,50 +578,386 @@ int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVe
 	return TRUE;
 }
 
-int StateSav_ReadAtariState(const char *filename, const char *mode)
+#ifndef MEMCOMPR
+static const UBYTE zstd_magic[4] = { 0x28, 0xb5, 0x2f, 0xfd };
+
+static void GrowFileBuffer(size_t size)
 {
-	char header_string[8];
-	UBYTE StateVersion = 0;  /* The version of the save file */
-	UBYTE SaveVerbose = 0;   /* Verbose mode means save basic, OS if patched */
+	if (FileBufferSize < size) {
+		FileBuffer = (UBYTE *) Util_realloc(FileBuffer, size);
+		FileBufferSize = size;
+	}
+}
+
+static int WriteRaw(const char *filename, const UBYTE *data, size_t len)
+{
+	FILE *fp = fopen(filename, "wb");
+	int ok;
+	if (fp == NULL)
+		return FALSE;
+	ok = fwrite(data, 1, len, fp) == len;
+	if (fclose(fp) != 0)
+		ok = FALSE;
+	return ok;
+}
+
+/* Writes LEN bytes of FileBuffer to FILENAME in StateSav_format. */
+static int WriteFile(const char *filename, const char *mode, size_t len)
+{
+	switch (StateSav_format) {
+#ifdef HAVE_LIBZ
+	case StateSav_FORMAT_GZIP:
+		{
+			gzFile gz = gzopen(filename, mode);
+			int ok;
+			if (gz == NULL)
+				return FALSE;
+			ok = gzwrite(gz, FileBuffer, (unsigned int) len) == (int) len;
+			if (gzclose(gz) != Z_OK)
+				ok = FALSE;
+			return ok;
+		}
+#endif
+#ifdef HAVE_LIBZSTD
+	case StateSav_FORMAT_ZSTD:
+		{
+			size_t bound = ZSTD_compressBound(len);
+			UBYTE *out = (UBYTE *) Util_malloc(bound);
+			size_t n = ZSTD_compress(out, bound, FileBuffer, len, 1);
+			int ok = !ZSTD_isError(n) && WriteRaw(filename, out, n);
+			free(out);
+			return ok;
+		}
+#endif
+	default:
+		return WriteRaw(filename, FileBuffer, len);
+	}
+}
+
+/* Reads FILENAME into FileBuffer, decompressed, and returns its length, or
+   0 on failure. */
+static size_t ReadFile(const char *filename, const char *mode)
+{
+	UBYTE magic[4];
+	size_t len = 0;
+	FILE *fp = fopen(filename, "rb");
+	if (fp == NULL)
+		return 0;
+	if (fread(magic, 1, 4, fp) == 4 && memcmp(magic, zstd_magic, 4) == 0) {
+#ifdef HAVE_LIBZSTD
+		size_t file_len = (size_t) Util_flen(fp);
+		UBYTE *data = (UBYTE *) Util_malloc(file_len);
+		fseek(fp, 0, SEEK_SET);
+		/* both UNKNOWN and ERROR are above any real size */
+		if (fread(data, 1, file_len, fp) == file_len
+		 && ZSTD_getFrameContentSize(data, file_len) < ZSTD_CONTENTSIZE_ERROR) {
+			size_t n = (size_t) ZSTD_getFrameContentSize(data, file_len);
+			GrowFileBuffer(n);
+			if (ZSTD_decompress(FileBuffer, n, data, file_len) == n)
+				len = n;
+		}
+		free(data);
+#else
+		Log_print("Cannot read this state file because this version does not support zstd.");
+#endif
+		fclose(fp);
+		return len;
+	}
+#ifdef HAVE_LIBZ
+	/* gzread reads uncompressed files as they are */
+	fclose(fp);
+	{
+		gzFile gz = gzopen(filename, mode);
+		int n;
+		if (gz == NULL)
+			return 0;
+		do {
+			GrowFileBuffer(len + 0x10000);
+			n = gzread(gz, FileBuffer + len, (unsigned int) (FileBufferSize - len));
+			if (n > 0)
+				len += n;
+		} while (n > 0);
+		gzclose(gz);
+		return n < 0 ? 0 : len;
+	}
+#else
+	fseek(fp, 0, SEEK_SET);
+	for (;;) {
+		size_t n;
+		GrowFileBuffer(len + 0x10000);
+		n = fread(FileBuffer + len, 1, FileBufferSize - len, fp);
+		if (n == 0)
+			break;
+		len += n;
+	}
+	fclose(fp);
+	return len;
+#endif
+}
+#endif /* MEMCOMPR */
+
+int StateSav_Initialise(int *argc, char *argv[])
+{
+	int i;
+	int j;
+	for (i = j = 1; i < *argc; i++) {
+		int i_a = (i + 1 < *argc);		/* is argument available? */
+		int a_m = FALSE;			/* error, argument missing! */
+
+		if (strcmp(argv[i], "-stateformat") == 0) {
+			if (i_a) {
+				const char *name = argv[++i];
+				if (strcmp(name, "raw") == 0)
+					StateSav_format = StateSav_FORMAT_RAW;
+#ifdef HAVE_LIBZ
+				else if (strcmp(name, "gzip") == 0)
+					StateSav_format = StateSav_FORMAT_GZIP;
+#endif
+#ifdef HAVE_LIBZSTD
+				else if (strcmp(name, "zstd") == 0)
+					StateSav_format = StateSav_FORMAT_ZSTD;
+#endif
+				else {
+					Log_print("Invalid or unsupported state file format '%s'", name);
+					return FALSE;
+				}
+			}
+			else a_m = TRUE;
+		}
+		else {
+			if (strcmp(argv[i], "-help") == 0) {
+				Log_print("\t-stateformat raw|gzip|zstd");
+				Log_print("\t                 Compression of saved state files");
+			}
+			argv[j++] = argv[i];
+		}
+
+		if (a_m) {
+			Log_print("Missing argument for '%s'", argv[i]);
+			return FALSE;
+		}
+	}
+	*argc = j;
+
+	return TRUE;
+}
+
+int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose)
+{
+#ifndef MEMCOMPR
+	int result;
+#ifdef LIBATARI800
+	statesav_tags_t tags;
+	statesav_tags_t *saved_tags = LIBATARI800_StateSav_tags;
+#endif
+#endif
 
 	if (StateFile != NULL) {
-		GZCLOSE(StateFile);
+		StateClose();
 		StateFile = NULL;
 	}
 	nFileError = Z_OK;
 
+#ifdef MEMCOMPR
 	StateFile = GZOPEN(filename, mode);
 	if (StateFile == NULL) {
-		Log_print("Could not open %s for state read.", filename);
+		Log_print("Could not open %s for state save.", filename);
 		GetGZErrorText();
 		return FALSE;
 	}
+	return SaveState(SaveVerbose);
+#else
+#ifdef LIBATARI800
+	if (filename == NULL) {
+		/* libatari800_get_current_state */
+		MemBuffer = LIBATARI800_StateSav_buffer;
+		MemSize = STATESAV_MAX_SIZE;
+		MemOffset = 0;
+		StateFile = (gzFile) MemBuffer;
+		return SaveState(SaveVerbose);
+	}
+	LIBATARI800_StateSav_tags = &tags;
+#endif
+	/* the whole state is serialized first and written in one piece */
+	GrowFileBuffer(STATESAV_MAX_SIZE);
+	MemBuffer = FileBuffer;
+	MemSize = FileBufferSize;
+	MemOffset = 0;
+	MemGrow = TRUE;
+	StateFile = (gzFile) MemBuffer;
+	result = SaveState(SaveVerbose);
+	MemGrow = FALSE;
+#ifdef LIBATARI800
+	LIBATARI800_StateSav_tags = saved_tags;
+#endif
+	if (!result)
+		return FALSE;
+	if (!WriteFile(filename, mode, MemOffset)) {
+		Log_print("Could not write %s for state save.", filename);
+		return FALSE;
+	}
+	return TRUE;
+#endif /* MEMCOMPR */
+}
+
+size_t StateSav_SaveAtariStateMem(UBYTE *buffer, size_t size)
+{
+	int result;
+#ifdef LIBATARI800
+	/* offsets are only kept for libatari800_get_current_state */
+	statesav_tags_t tags;
+	statesav_tags_t *saved_tags = LIBATARI800_StateSav_tags;
+	LIBATARI800_StateSav_tags = &tags;
+#endif
+
+	if (StateFile != NULL) {
+		StateClose();
+		StateFile = NULL;
+	}
+	nFileError = Z_OK;
+
+	MemBuffer = buffer;
+	MemSize = size;
+	MemOffset = 0;
+	StateFile = (gzFile) buffer;
+	result = SaveState(0);
+#ifdef LIBATARI800
+	LIBATARI800_StateSav_tags = saved_tags;
+#endif
+	return result ? MemOffset : 0;
+}
+
+size_t StateSav_SaveAtariStateDelta(UBYTE *buffer, size_t size)
+{
+	int result;
+#ifdef LIBATARI800
+	statesav_tags_t tags;
+	statesav_tags_t *saved_tags = LIBATARI800_StateSav_tags;
+#endif
+
+	if (size < 4)
+		return 0;
+#ifdef LIBATARI800
+	LIBATARI800_StateSav_tags = &tags;
+#endif
+
+	if (StateFile != NULL) {
+		StateClose();
+		StateFile = NULL;
+	}
+	nFileError = Z_OK;
+
+	/* the first blob starts with its length */
+	MemBuffer = buffer;
+	MemSize = size;
+	MemOffset = 4;
+	StateFile = (gzFile) buffer;
+	DeltaMode = TRUE;
+	DeltaBlock = 0;
+	DeltaBlobStart = 0;
+	DeltaStateLength = 0;
+	result = SaveState(0);
+	DeltaMode = FALSE;
+#ifdef LIBATARI800
+	LIBATARI800_StateSav_tags = saved_tags;
+#endif
+	if (!result) {
+		/* some pages may have been cleared without being saved */
+		DeltaNumBlocks = 0;
+		return 0;
+	}
+	PutLong(buffer + DeltaBlobStart, (ULONG) (MemOffset - DeltaBlobStart - 4));
+	DeltaNumBlocks = DeltaBlock;
+	return MemOffset;
+}
 
-	if (GZREAD(StateFile, header_string, 8) == 0) {
+size_t StateSav_ApplyDelta(const UBYTE *state, size_t state_len, const UBYTE *delta, size_t delta_len, UBYTE *buffer, size_t size)
+{
+	const UBYTE *end = delta + delta_len;
+	size_t len = 0;
+	for (;;) {
+		size_t n;
+		size_t offset;
+		size_t pages;
+		size_t i;
+		const UBYTE *bitmap;
+
+		if (end - delta < 4)
+			return 0;
+		n = GetLong(delta);
+		delta += 4;
+		if ((size_t) (end - delta) < n || size - len < n)
+			return 0;
+		memcpy(buffer + len, delta, n);
+		delta += n;
+		len += n;
+		if (delta == end)
+			return len;
+
+		if (end - delta < 8)
+			return 0;
+		offset = GetLong(delta);
+		n = GetLong(delta + 4);
+		delta += 8;
+		pages = n >> 8;
+		bitmap = delta;
+		if ((size_t) (end - delta) < (pages + 7) >> 3 || size - len < n)
+			return 0;
+		delta += (pages + 7) >> 3;
+		for (i = 0; i < pages; i++) {
+			const UBYTE *page;
+			if (bitmap[i >> 3] & (1 << (i & 7))) {
+				if (end - delta < 256)
+					return 0;
+				page = delta;
+				delta += 256;
+			}
+			else {
+				if (state == NULL || offset > state_len || state_len - offset < n)
+					return 0;
+				page = state + offset + (i << 8);
+			}
+			memcpy(buffer + len + (i << 8), page, 256);
+		}
+		len += n;
+	}
+}
+
+/* Reads the state from StateFile or MemBuffer and closes it. */
+static int ReadState(void)
+{
+	char header_string[8];
+	UBYTE StateVersion = 0;  /* The version of the save file */
+	UBYTE SaveVerbose = 0;   /* Verbose mode means save basic, OS if patched */
+
+	/* the machine no longer matches the previous delta */
+	DeltaNumBlocks = 0;
+
+	if (StateRead(header_string, 8) == 0) {
 		GetGZErrorText();
-		GZCLOSE(StateFile);
+		StateClose();
 		StateFile = NULL;
 		return FALSE;
 	}
 	if (memcmp(header_string, "ATARI800", 8) != 0) {
 		Log_print("This is not an Atari800 state save file.");
-		GZCLOSE(StateFile);
+		StateClose();
 		StateFile = NULL;
 		return FALSE;
 	}
 
-	if (GZREAD(StateFile, &StateVersion, 1) == 0
-	 || GZREAD(StateFile, &SaveVerbose, 1) == 0) {
+	if (StateRead(&StateVersion, 1) == 0
+	 || StateRead(&SaveVerbose, 1) == 0) {
 		Log_print("Failed read from Atari state file.");
 		GetGZErrorText();
-		GZCLOSE(StateFile);
+		StateClose();
 		StateFile = NULL;
 		return FALSE;
 	}
 
 	if (StateVersion > SAVE_VERSION_NUMBER || StateVersion < 3) {
 		Log_print("Cannot read this state file because it is an incompatible version.");
-		GZCLOSE(StateFile);
+		StateClose();
 		StateFile = NULL;
 		return FALSE;
 	}
@@ -525,7 +980,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 		StateSav_ReadINT(&local_xep80_enabled,1);
 		if (local_xep80_enabled) {
 			Log_print("Cannot read this state file because this version does not support XEP80.");
-			GZCLOSE(StateFile);
+			StateClose();
 			StateFile = NULL;
 			return FALSE;
 		}
@@ -539,7 +994,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_mio_enabled,1);
 			if (local_mio_enabled) {
 				Log_print("Cannot read this state file because this version does not support MIO.");
-				GZCLOSE(StateFile);
+				StateClose();
 				StateFile = NULL;
 				return FALSE;
 			}
@@ -553,7 +1008,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_bb_enabled,1);
 			if (local_bb_enabled) {
 				Log_print("Cannot read this state file because this version does not support the Black Box.");
-				GZCLOSE(StateFile);
+				StateClose();
 				StateFile = NULL;
 				return FALSE;
 			}
@@ -567,7 +1022,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_xld_enabled,1);
 			if (local_xld_enabled) {
 				Log_print("Cannot read this state file because this version does not support the 1400XL/1450XLD.");
-				GZCLOSE(StateFile);
+				StateClose();
 				StateFile = NULL;
 				return FALSE;
 			}
@@ -584,7 +1039,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_slightsid_enabled,1);
 			if (local_slightsid_enabled) {
 				Log_print("Cannot read this state file because this version does not support the SlightSID.");
-				GZCLOSE(StateFile);
+				StateClose();
 				StateFile = NULL;
 				return FALSE;
 			}
@@ -598,7 +1053,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_evie_enabled,1);
 			if (local_evie_enabled) {
 				Log_print("Cannot read this state file because this version does not support the Evie.");
-				GZCLOSE(StateFile);
+				StateClose();
 				StateFile = NULL;
 				return FALSE;
 			}
@@ -612,7 +1067,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_sidari_enabled,1);
 			if (local_sidari_enabled) {
 				Log_print("Cannot read this state file because this version does not support the SIDari.");
-				GZCLOSE(StateFile);
+				StateClose();
 				StateFile = NULL;
 				return FALSE;
 			}
@@ -626,7 +1081,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_sonari_enabled,1);
 			if (local_sonari_enabled) {
 				Log_print("Cannot read this state file because this version does not support the SONari.");
-				GZCLOSE(StateFile);
+				StateClose();
 				StateFile = NULL;
 				return FALSE;
 			}
@@ -640,7 +1095,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_melody_enabled,1);
 			if (local_melody_enabled) {
 				Log_print("Cannot read this state file because this version does not support the Melody.");
-				GZCLOSE(StateFile);
+				StateClose();
 				StateFile = NULL;
 				return FALSE;
 			}
@@ -654,7 +1109,7 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 			StateSav_ReadINT(&local_yamari_enabled,1);
 			if (local_yamari_enabled) {
 				Log_print("Cannot read this state file because this version does not support the YAMari.");
-				GZCLOSE(StateFile);
+				StateClose();
 				StateFile = NULL;
 				return FALSE;
 			}
@@ -664,8 +1119,10 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 #ifdef DREAMCAST
 	DCStateRead();
 #endif
+	/* The state may have enabled or moved D5xx devices. */
+	CARTRIDGE_UpdateD5Map();
 
-	GZCLOSE(StateFile);
+	StateClose();
 	StateFile = NULL;
 
 	if (nFileError != Z_OK)
@@ -674,10 +1131,65 @@ int StateSav_ReadAtariState(const char *filename, const char *mode)
 	return TRUE;
 }
 
+int StateSav_ReadAtariState(const char *filename, const char *mode)
+{
+#ifndef MEMCOMPR
+	size_t len;
+#endif
 
-/* Common definitions for in-memory state save used for DREAMCAST and libatari800
- */
-#if defined(MEMCOMPR) || defined(LIBATARI800)
+	if (StateFile != NULL) {
+		StateClose();
+		StateFile = NULL;
+	}
+	nFileError = Z_OK;
+
+#ifdef MEMCOMPR
+	StateFile = GZOPEN(filename, mode);
+	if (StateFile == NULL) {
+		Log_print("Could not open %s for state read.", filename);
+		GetGZErrorText();
+		return FALSE;
+	}
+	return ReadState();
+#else
+#ifdef LIBATARI800
+	if (filename == NULL)
+		/* libatari800_restore_state */
+		return StateSav_ReadAtariStateMem(LIBATARI800_StateSav_buffer, STATESAV_MAX_SIZE);
+#endif
+	len = ReadFile(filename, mode);
+	if (len == 0) {
+		Log_print("Could not open %s for state read.", filename);
+		return FALSE;
+	}
+	return StateSav_ReadAtariStateMem(FileBuffer, len);
+#endif /* MEMCOMPR */
+}
+
+int StateSav_ReadAtariStateMem(const UBYTE *buffer, size_t size)
+{
+	if (StateFile != NULL) {
+		StateClose();
+		StateFile = NULL;
+	}
+	nFileError = Z_OK;
+
+	MemBuffer = (UBYTE *) buffer;
+	MemSize = size;
+	MemOffset = 0;
+	StateFile = (gzFile) MemBuffer;
+	return ReadState();
+}
+
+
+#ifdef LIBATARI800
+ULONG StateSav_Tell(void)
+{
+	return (ULONG) MemOffset;
+}
+#endif
+
+#ifdef MEMCOMPR
 static char * plainmembuf;
 static unsigned int plainmemoff;
 static unsigned int unclen;
@@ -688,7 +1200,6 @@ static unsigned int unclen;
  * - use bzip2 instead of zip: better compression ratio (the DC VMUs are small)
  * - write in DC specific file format to provide icon and description
  */
-#ifdef MEMCOMPR
 static char * comprmembuf;
 #define OM_READ  1
 #define OM_WRITE 2
@@ -776,31 +1287,6 @@ static int mem_close(gzFile stream)
 	free(plainmembuf);
 	return status;
 }
-#endif /* #ifdef MEMCOMPR */
-
-
-#ifdef LIBATARI800
-/* replacement for GZOPEN */
-static gzFile mem_open(const char *name, const char *mode)
-{
-	plainmembuf = (char *)LIBATARI800_StateSav_buffer;
-	plainmemoff = 0; /*HDR_LEN;*/
-	unclen = STATESAV_MAX_SIZE;
-	return (gzFile) plainmembuf;
-}
-
-/* replacement for GZCLOSE */
-static int mem_close(gzFile stream)
-{
-	return 0;
-}
-
-ULONG StateSav_Tell()
-{
-	return (ULONG)plainmemoff;
-}
-#endif /* #ifdef LIBATARI800 */
-
 
 /* replacement for GZREAD */
 static size_t mem_read(void *buf, size_t len, gzFile stream)
@@ -820,7 +1306,7 @@ static size_t mem_write(const void *buf, size_t len, gzFile stream)
 	return len;
 }
 
-#endif /* defined(MEMCOMPR) || defined(LIBATARI800) */
+#endif /* MEMCOMPR */
 
 /*
 vim:ts=4:sw=4:
@@ -2,15 +2,40 @@
 #define STATESAV_H_
 
 #include "config.h"
+#include <stddef.h>
 #include "atari.h"
 
+/* Compression of state files; reading recognizes all of them. */
+#define StateSav_FORMAT_RAW  0
+#define StateSav_FORMAT_GZIP 1
+#define StateSav_FORMAT_ZSTD 2
+extern int StateSav_format;
+
+int StateSav_Initialise(int *argc, char *argv[]);
+
 int StateSav_SaveAtariState(const char *filename, const char *mode, UBYTE SaveVerbose);
 int StateSav_ReadAtariState(const char *filename, const char *mode);
+/* Save to and read from a buffer of SIZE bytes. The save returns the length
+   of the state, or 0 if it doesn't fit. */
+size_t StateSav_SaveAtariStateMem(UBYTE *buffer, size_t size);
+int StateSav_ReadAtariStateMem(const UBYTE *buffer, size_t size);
+/* A delta is the state without the 256-byte pages of memory that haven't
+   changed since the previous delta; the first one, and the first after a
+   failed one or after a state is read, has all of them. StateSav_ApplyDelta
+   makes the state that DELTA stands for out of STATE, the one made from the
+   previous delta, in BUFFER, which must not overlap STATE. Both return the
+   length of what they write, or 0 on failure. */
+size_t StateSav_SaveAtariStateDelta(UBYTE *buffer, size_t size);
+size_t StateSav_ApplyDelta(const UBYTE *state, size_t state_len, const UBYTE *delta, size_t delta_len, UBYTE *buffer, size_t size);
 
 void StateSav_SaveUBYTE(const UBYTE *data, int num);
 void StateSav_SaveUWORD(const UWORD *data, int num);
 void StateSav_SaveINT(const int *data, int num);
 void StateSav_SaveFNAME(const char *filename);
+/* Saves NUM bytes, a multiple of 256. A delta only gets the pages whose
+   flags in DIRTY are set, and clears them; DIRTY is NULL for memory whose
+   changes aren't tracked. */
+void StateSav_SavePages(const UBYTE *data, int num, UBYTE *dirty);
 
 void StateSav_ReadUBYTE(UBYTE *data, int num);
 void StateSav_ReadUWORD(UWORD *data, int num);
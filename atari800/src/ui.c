@@ -1996,6 +1996,7 @@ static void AtariSettings(void)
 			break;
 		case 2:
 			RTIME_enabled = !RTIME_enabled;
+			CARTRIDGE_UpdateD5Map();
 			break;
 		case 3:
 			ESC_enable_sio_patch = !ESC_enable_sio_patch;
@@ -3803,7 +3804,7 @@ static int SoundSettings(void)
 {
 #ifdef SOUND_THIN_API
 	Sound_setup_t setup = Sound_desired;
-	static char freq_string[9]; /* "nnnnn Hz\0" */
+	static char freq_string[10]; /* "nnnnnn Hz\0" */
 	static char hw_buflen_string[15]; /* "auto (nnnn ms)\0" */
 #ifdef SYNCHRONIZED_SOUND
 	static char latency_string[8]; /* nnnn ms\0" */
@@ -3814,7 +3815,8 @@ static int SoundSettings(void)
 		11025,
 		22050,
 		44100,
-		48000
+		48000,
+		96000
 	};
 	static const UI_tMenuItem freq_menu_array[] = {
 		UI_MENU_ACTION(0, "8192 Hz"),
@@ -3822,7 +3824,8 @@ static int SoundSettings(void)
 		UI_MENU_ACTION(2, "22050 Hz"),
 		UI_MENU_ACTION(3, "44100 Hz"),
 		UI_MENU_ACTION(4, "48000 Hz"),
-		UI_MENU_ACTION(5, "custom"),
+		UI_MENU_ACTION(5, "96000 Hz"),
+		UI_MENU_ACTION(6, "custom"),
 		UI_MENU_END
 	};
 
@@ -3993,7 +3996,8 @@ static int SoundSettings(void)
 #ifdef SOUND_THIN_API
 		SetItemChecked(menu_array, 0, Sound_enabled);
 		snprintf(freq_string, sizeof(freq_string), "%i Hz", setup.freq);
-		menu_array[2].suffix = setup.sample_size == 2 ? "16 bit" : "8 bit";
+		menu_array[2].suffix = setup.sample_size == 4 ? (setup.float_samples ? "32 bit float" : "32 bit")
+		                       : setup.sample_size == 2 ? "16 bit" : "8 bit";
 		if (setup.buffer_ms == 0) {
 			if (Sound_enabled)
 				snprintf(hw_buflen_string, sizeof(hw_buflen_string), "auto (%u ms)", Sound_out.buffer_ms);
@@ -4113,13 +4117,13 @@ static int SoundSettings(void)
 			{
 				int option2;
 				int current;
-				for (current = 0; freq_menu_array[current].retval < 5; ++current) {
+				for (current = 0; freq_menu_array[current].retval < 6; ++current) {
 					/* Find the currently-chosen frequency. */
 					if (freq_values[freq_menu_array[current].retval] == setup.freq)
 						break;
 				}
 				option2 = UI_driver->fSelect(NULL, UI_SELECT_POPUP, current, freq_menu_array, NULL);
-				if (option2 == 5) {
+				if (option2 == 6) {
 					snprintf(freq_string, sizeof(freq_string), "%u", setup.freq); /* Remove " Hz" suffix */
 					if (UI_driver->fEditString("Enter sound frequency", freq_string, sizeof(freq_string)-3))
 						setup.freq = atoi(freq_string);
@@ -4129,7 +4133,13 @@ static int SoundSettings(void)
 			}
 			break;
 		case 2:
-			setup.sample_size = 3 - setup.sample_size; /* Toggle 1<->2 */
+			/* Cycle 8 bit -> 16 bit -> 32 bit -> 32 bit float */
+			if (setup.sample_size == 4 && !setup.float_samples)
+				setup.float_samples = TRUE;
+			else {
+				setup.sample_size = setup.sample_size == 1 ? 2 : setup.sample_size == 2 ? 4 : 1;
+				setup.float_samples = FALSE;
+			}
 			break;
 		case 3:
 			{
@@ -4378,6 +4388,7 @@ static int SoundSettings(void)
 				Sound_desired = setup;
 			else if (setup.freq        != Sound_desired.freq ||
 			         setup.sample_size != Sound_desired.sample_size ||
+			         setup.float_samples != Sound_desired.float_samples ||
 #ifdef STEREO_SOUND
 			         setup.channels    != Sound_desired.channels ||
 #endif
@@ -27,6 +27,7 @@
 #define COUNT_CYCLES
 
 #include "yamari.h"
+#include "cartridge.h"
 #include "pokeysnd.h"
 #include "atari.h"
 #include "antic.h"
@@ -214,6 +215,7 @@ void YAMARI_Init(unsigned long freq17, int playback_freq, int n_pokeys, int b16)
 	if (restore_opl3_state)
 		YMF262_read_state(YMF262_CHIP_YAMARI_INDEX, &opl3_state);
 	yamari_initialize(freq17, playback_freq, n_pokeys, b16, restore_opl3_state ? &opl3_state : NULL);
+	CARTRIDGE_UpdateD5Map();
 }
 
 void YAMARI_Exit(void)
@@ -303,6 +305,13 @@ void YAMARI_D5PutByte(UWORD addr, UBYTE byte)
 	}
 }
 
+/* Returns TRUE if the YAMari is enabled but its OPL3 can't be heard until
+   the next key-on. */
+int YAMARI_IsSilent(void)
+{
+	return YAMARI_enable && YMF262_is_silent(YMF262_CHIP_YAMARI_INDEX);
+}
+
 static UBYTE* opl3_generate_samples(UBYTE *sndbuffer, int samples)
 {
 	int ticks;
@@ -313,6 +322,10 @@ static UBYTE* opl3_generate_samples(UBYTE *sndbuffer, int samples)
 
 	if (YAMARI_enable) {
 		/*Log_print("opl3_generate_samples %d", buflen);*/
+		if (YAMARI_IsSilent()) {
+			YMF262_skip(YMF262_CHIP_YAMARI_INDEX, buflen);
+			return sndbuffer + buflen * (bit16 ? 2 : 1) * pokeys_count;
+		}
 		while (buflen > 0) {
 			count = 0;
 			ticks = buflen * opl3_ticks_per_sample;
@@ -393,6 +406,10 @@ static unsigned int opl3_generate_sync(UBYTE *buffer_begin, UBYTE *buffer_end, u
 		ticks = int_part;
 		/*Log_print("YAMari_GenerateSync");*/
 		/*Log_print("opl3_ticks=%d, num_ticks=%d", ticks, num_ticks);*/
+		if (YAMARI_IsSilent()) {
+			YMF262_skip(YMF262_CHIP_YAMARI_INDEX, samples_count);
+			return samples_count * sample_size;
+		}
 		if (ticks > 0) {
 			count = YMF262_calculate_sample(YMF262_CHIP_YAMARI_INDEX, ticks, opl3_buffer, samples_count);
 		}
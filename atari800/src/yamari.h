@@ -31,6 +31,7 @@ int YAMARI_InSlot(UWORD addr);
 int YAMARI_D5GetByte(UWORD addr, int no_side_effects);
 void YAMARI_D5PutByte(UWORD addr, UBYTE byte);
 void YAMARI_Process(void *sndbuffer, int sndn);
+int YAMARI_IsSilent(void);
 #ifdef SYNCHRONIZED_SOUND
 unsigned int YAMARI_GenerateSync(UBYTE *buffer_begin, UBYTE *buffer_end, unsigned int ticks, unsigned int sndn);
 #endif
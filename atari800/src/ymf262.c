@@ -23,6 +23,7 @@
 */
 
 #include <stdlib.h>
+#include <math.h>
 
 #include "opl.h"
 #include "ymf262.h"
@@ -84,6 +85,24 @@ int YMF262_calculate_sample(int opl3_index, int delta, SWORD *buf, int nr)
 	return nr;
 }
 
+int YMF262_is_silent(int opl3_index)
+{
+	int i;
+	if (!opl3)
+		return FALSE;
+	for (i = 0; i < MAXOPERATORS; i++)
+		if (op[i].op_state != OF_TYPE_OFF)
+			return FALSE;
+	return TRUE;
+}
+
+void YMF262_skip(int opl3_index, int nr)
+{
+	/* With all operators off adlib_getsample only moves the LFO tables. */
+	vibtab_pos = (Bit32u)fmod(vibtab_pos + (double)vibtab_add * nr, (double)VIBTAB_SIZE * FIXEDPT_LFO);
+	tremtab_pos = (Bit32u)fmod(tremtab_pos + (double)tremtab_add * nr, (double)TREMTAB_SIZE * FIXEDPT_LFO);
+}
+
 void YMF262_read_state(int opl3_index, YMF262_State *state)
 {
 	unsigned int i;
@@ -22,6 +22,12 @@ UBYTE YMF262_read(int opl3_index, double tick);
 void YMF262_write(int opl3_index, UWORD addr, UBYTE byte, double tick);
 void YMF262_reset(int opl3_index);
 int YMF262_calculate_sample(int opl3_index, int delta, SWORD *buf, int nr);
+/* Returns TRUE if all operators are off, so the output is exactly zero
+   until the next register write. Rendering may then be replaced with
+   YMF262_skip. */
+int YMF262_is_silent(int opl3_index);
+/* Advances the chip as if NR samples were produced. */
+void YMF262_skip(int opl3_index, int nr);
 void YMF262_read_state(int opl3_index, YMF262_State *state);
 void YMF262_write_state(int opl3_index, YMF262_State *state);
 
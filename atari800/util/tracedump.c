@@ -0,0 +1,183 @@
+/*
+ * tracedump.c - print a binary trace of atari800 (BTRACE command, -btrace)
+ *
+ * Copyright (c) 2026 Atari800 development team (see DOC/CREDITS)
+ *
+ * This file is part of the Atari800 emulator project which emulates
+ * the Atari 400, 800, 800XL, 130XE, and 5200 8-bit computers.
+ *
+ * Atari800 is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Atari800 is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Atari800; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+/* Prints the lines the monitor's TRACE command would have written.
+   Build with: cc -o tracedump tracedump.c
+   Usage: tracedump [-c] tracefile [outfile]
+   -c starts each line with the cycle number. The record layout is
+   described in src/cputrace.h. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define HEADER_SIZE 16
+
+/* copied from src/monitor.c */
+static const char instr6502[256][10] = {
+	"BRK", "ORA (1,X)", "CIM", "ASO (1,X)", "NOP 1", "ORA 1", "ASL 1", "ASO 1",
+	"PHP", "ORA #1", "ASL", "ANC #1", "NOP 2", "ORA 2", "ASL 2", "ASO 2",
+
+	"BPL 0", "ORA (1),Y", "CIM", "ASO (1),Y", "NOP 1,X", "ORA 1,X", "ASL 1,X", "ASO 1,X",
+	"CLC", "ORA 2,Y", "NOP !", "ASO 2,Y", "NOP 2,X", "ORA 2,X", "ASL 2,X", "ASO 2,X",
+
+	"JSR 2", "AND (1,X)", "CIM", "RLA (1,X)", "BIT 1", "AND 1", "ROL 1", "RLA 1",
+	"PLP", "AND #1", "ROL", "ANC #1", "BIT 2", "AND 2", "ROL 2", "RLA 2",
+
+	"BMI 0", "AND (1),Y", "CIM", "RLA (1),Y", "NOP 1,X", "AND 1,X", "ROL 1,X", "RLA 1,X",
+	"SEC", "AND 2,Y", "NOP !", "RLA 2,Y", "NOP 2,X", "AND 2,X", "ROL 2,X", "RLA 2,X",
+
+
+	"RTI", "EOR (1,X)", "CIM", "LSE (1,X)", "NOP 1", "EOR 1", "LSR 1", "LSE 1",
+	"PHA", "EOR #1", "LSR", "ALR #1", "JMP 2", "EOR 2", "LSR 2", "LSE 2",
+
+	"BVC 0", "EOR (1),Y", "CIM", "LSE (1),Y", "NOP 1,X", "EOR 1,X", "LSR 1,X", "LSE 1,X",
+	"CLI", "EOR 2,Y", "NOP !", "LSE 2,Y", "NOP 2,X", "EOR 2,X", "LSR 2,X", "LSE 2,X",
+
+	"RTS", "ADC (1,X)", "CIM", "RRA (1,X)", "NOP 1", "ADC 1", "ROR 1", "RRA 1",
+	"PLA", "ADC #1", "ROR", "ARR #1", "JMP (2)", "ADC 2", "ROR 2", "RRA 2",
+
+	"BVS 0", "ADC (1),Y", "CIM", "RRA (1),Y", "NOP 1,X", "ADC 1,X", "ROR 1,X", "RRA 1,X",
+	"SEI", "ADC 2,Y", "NOP !", "RRA 2,Y", "NOP 2,X", "ADC 2,X", "ROR 2,X", "RRA 2,X",
+
+
+	"NOP #1", "STA (1,X)", "NOP #1", "SAX (1,X)", "STY 1", "STA 1", "STX 1", "SAX 1",
+	"DEY", "NOP #1", "TXA", "ANE #1", "STY 2", "STA 2", "STX 2", "SAX 2",
+
+	"BCC 0", "STA (1),Y", "CIM", "SHA (1),Y", "STY 1,X", "STA 1,X", "STX 1,Y", "SAX 1,Y",
+	"TYA", "STA 2,Y", "TXS", "SHS 2,Y", "SHY 2,X", "STA 2,X", "SHX 2,Y", "SHA 2,Y",
+
+	"LDY #1", "LDA (1,X)", "LDX #1", "LAX (1,X)", "LDY 1", "LDA 1", "LDX 1", "LAX 1",
+	"TAY", "LDA #1", "TAX", "ANX #1", "LDY 2", "LDA 2", "LDX 2", "LAX 2",
+
+	"BCS 0", "LDA (1),Y", "CIM", "LAX (1),Y", "LDY 1,X", "LDA 1,X", "LDX 1,Y", "LAX 1,X",
+	"CLV", "LDA 2,Y", "TSX", "LAS 2,Y", "LDY 2,X", "LDA 2,X", "LDX 2,Y", "LAX 2,Y",
+
+
+	"CPY #1", "CMP (1,X)", "NOP #1", "DCM (1,X)", "CPY 1", "CMP 1", "DEC 1", "DCM 1",
+	"INY", "CMP #1", "DEX", "SBX #1", "CPY 2", "CMP 2", "DEC 2", "DCM 2",
+
+	"BNE 0", "CMP (1),Y", "ESCRTS #1", "DCM (1),Y", "NOP 1,X", "CMP 1,X", "DEC 1,X", "DCM 1,X",
+	"CLD", "CMP 2,Y", "NOP !", "DCM 2,Y", "NOP 2,X", "CMP 2,X", "DEC 2,X", "DCM 2,X",
+
+
+	"CPX #1", "SBC (1,X)", "NOP #1", "INS (1,X)", "CPX 1", "SBC 1", "INC 1", "INS 1",
+	"INX", "SBC #1", "NOP", "SBC #1 !", "CPX 2", "SBC 2", "INC 2", "INS 2",
+
+	"BEQ 0", "SBC (1),Y", "ESCAPE #1", "INS (1),Y", "NOP 1,X", "SBC 1,X", "INC 1,X", "INS 1,X",
+	"SED", "SBC 2,Y", "NOP !", "INS 2,Y", "NOP 2,X", "SBC 2,X", "INC 2,X", "INS 2,X"
+};
+
+/* Same output as show_instruction in src/monitor.c, without labels. */
+static void show_instruction(FILE *fp, unsigned int addr, const unsigned char *code)
+{
+	int insn = code[0];
+	const char *mnemonic = instr6502[insn];
+	const char *p;
+	for (p = mnemonic + 3; *p != '\0'; p++) {
+		if (*p == '1') {
+			fprintf(fp, "%04X: %02X %02X     %.*s$%02X%s\n",
+			        addr, insn, code[1], (int) (p - mnemonic), mnemonic, code[1], p + 1);
+			return;
+		}
+		if (*p == '2') {
+			fprintf(fp, "%04X: %02X %02X %02X  %.*s$%04X%s\n",
+			        addr, insn, code[1], code[2], (int) (p - mnemonic), mnemonic, code[1] + (code[2] << 8), p + 1);
+			return;
+		}
+		if (*p == '0') {
+			fprintf(fp, "%04X: %02X %02X     %.4s$%04X\n",
+			        addr, insn, code[1], mnemonic, (addr + 2 + (signed char) code[1]) & 0xffff);
+			return;
+		}
+	}
+	fprintf(fp, "%04X: %02X        %s\n", addr, insn, mnemonic);
+}
+
+int main(int argc, char *argv[])
+{
+	FILE *in;
+	FILE *out = stdout;
+	unsigned char header[HEADER_SIZE];
+	unsigned char *rec;
+	int record_size;
+	int cycles = 0;
+	int i = 1;
+	unsigned long long clock = 0;
+	unsigned long last = 0;
+
+	if (i < argc && strcmp(argv[i], "-c") == 0) {
+		cycles = 1;
+		i++;
+	}
+	if (i >= argc || i + 2 < argc) {
+		fprintf(stderr, "Usage: %s [-c] tracefile [outfile]\n", argv[0]);
+		return 1;
+	}
+	in = fopen(argv[i], "rb");
+	if (in == NULL) {
+		perror(argv[i]);
+		return 1;
+	}
+	if (fread(header, 1, HEADER_SIZE, in) != HEADER_SIZE || memcmp(header, "A8BTRACE", 8) != 0) {
+		fprintf(stderr, "%s: not an atari800 binary trace\n", argv[i]);
+		return 1;
+	}
+	if (header[8] + (header[9] << 8) != 1) {
+		fprintf(stderr, "%s: unsupported version %d\n", argv[i], header[8] + (header[9] << 8));
+		return 1;
+	}
+	record_size = header[10] + (header[11] << 8);
+	if (record_size < 16) {
+		fprintf(stderr, "%s: bad record size %d\n", argv[i], record_size);
+		return 1;
+	}
+	if (i + 1 < argc) {
+		out = fopen(argv[i + 1], "w");
+		if (out == NULL) {
+			perror(argv[i + 1]);
+			return 1;
+		}
+	}
+	rec = (unsigned char *) malloc(record_size);
+	while (fread(rec, 1, record_size, in) == (size_t) record_size) {
+		unsigned int p = rec[9];
+		if (cycles) {
+			/* the records have the low 24 bits of the cycle counter */
+			unsigned long low = rec[13] + (rec[14] << 8) + ((unsigned long) rec[15] << 16);
+			clock += (low - last) & 0xffffff;
+			last = low;
+			fprintf(out, "%10llu ", clock);
+		}
+		fprintf(out, "%3d %3d A=%02X X=%02X Y=%02X S=%02X P=%c%c*-%c%c%c%c PC=",
+			rec[2] + (rec[3] << 8), rec[4], rec[5], rec[6], rec[7], rec[8],
+			(p & 0x80) ? 'N' : '-', (p & 0x40) ? 'V' : '-', (p & 0x08) ? 'D' : '-',
+			(p & 0x04) ? 'I' : '-', (p & 0x02) ? 'Z' : '-', (p & 0x01) ? 'C' : '-');
+		show_instruction(out, rec[0] + (rec[1] << 8), rec + 10);
+	}
+	free(rec);
+	fclose(in);
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
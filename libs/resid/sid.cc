@@ -559,6 +559,25 @@ bool SID::set_sampling_parameters(double clock_freq, sampling_method method,
 }
 
 
+// ----------------------------------------------------------------------------
+// Clear the sampling state left by previous output, keeping the sampling
+// parameters and the FIR tables. Output then starts as after
+// set_sampling_parameters.
+// ----------------------------------------------------------------------------
+void SID::reset_sampling()
+{
+  sample_offset = 0;
+  sample_prev = 0;
+
+  if (sample) {
+    for (int j = 0; j < RINGSIZE*2; j++) {
+      sample[j] = 0;
+    }
+  }
+  sample_index = 0;
+}
+
+
 // ----------------------------------------------------------------------------
 // Adjustment of SID sampling frequency.
 //